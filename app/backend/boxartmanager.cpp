@@ -1,22 +1,69 @@
 #include "boxartmanager.h"
 #include "../path.h"
 
+#include <QBuffer>
+#include <QGuiApplication>
 #include <QImageReader>
 #include <QImageWriter>
+#include <QSaveFile>
+#include <QTimer>
+#include <QtMath>
+
+// Size of an app tile in AppView.qml
+#define THUMBNAIL_WIDTH 200
+#define THUMBNAIL_HEIGHT 267
+
+// Enough for several hundred tiles at 2x scale
+#define THUMBNAIL_CACHE_SIZE_KB (128 * 1024)
+
+#define THUMBNAIL_JPEG_QUALITY 90
+
+// GFE struggles with lots of concurrent requests, but Sunshine doesn't
+#define MAX_FETCHES_PER_HOST_GFE 2
+#define MAX_FETCHES_PER_HOST 4
+
+#define FETCH_ATTEMPTS 2
+
+// Apps without box art are retried after this, doubling up to the maximum
+#define FAILED_FETCH_BACKOFF_MS (30 * 1000)
+#define FAILED_FETCH_BACKOFF_MAX_MS (60 * 60 * 1000)
+
+QCache<QString, QImage> BoxArtManager::s_ThumbnailCache(THUMBNAIL_CACHE_SIZE_KB);
+QMutex BoxArtManager::s_ThumbnailCacheLock;
+BoxArtFetchScheduler* BoxArtFetchScheduler::s_Scheduler;
+
+// Must be called on the UI thread
+static int getThumbnailScale()
+{
+    return qBound(1, qCeil(qApp->devicePixelRatio()), 3);
+}
+
+static bool isPlaceholderSize(const QSize& size)
+{
+    // AppView.qml detects host placeholder images by their dimensions,
+    // so we must not scale them. These are the GFE 2.0 and GFE 3.0
+    // placeholder sizes.
+    return size == QSize(130, 180) || size == QSize(628, 888);
+}
 
 BoxArtManager::BoxArtManager(QObject *parent) :
     QObject(parent),
-    m_BoxArtDir(Path::getBoxArtCacheDir()),
-    m_ThreadPool(this)
-{
-    // 4 is a good balance between fast loading for large
-    // app grids and not crushing GFE with tons of requests
-    // and causing UI jank from constantly stalling to decode
-    // new images.
-    m_ThreadPool.setMaxThreadCount(4);
+    m_BoxArtDir(Path::getBoxArtCacheDir())
+{
     if (!m_BoxArtDir.exists()) {
         m_BoxArtDir.mkpath(".");
     }
+
+    connect(BoxArtFetchScheduler::get(), &BoxArtFetchScheduler::fetchCompleted,
+            this, &BoxArtManager::handleBoxArtFetchCompleted);
+}
+
+BoxArtManager::~BoxArtManager()
+{
+    // Cancel fetches that nobody else is waiting for
+    for (const PendingLoad& pendingLoad : m_PendingLoads) {
+        BoxArtFetchScheduler::get()->cancel(pendingLoad.computer->uuid, pendingLoad.app.id);
+    }
 }
 
 QString
@@ -32,100 +79,545 @@ BoxArtManager::getFilePathForBoxArt(NvComputer* computer, int appId)
     // Change to this computer's box art cache folder
     dir.cd(computer->uuid);
 
-    // Try to open the cached file
+    // Try to open the cached file. This may not actually be a PNG
+    // if the host sent us another format, but we read it by content.
     return dir.filePath(QString::number(appId) + ".png");
 }
 
-class NetworkBoxArtLoadTask : public QObject, public QRunnable
+QString
+BoxArtManager::getFilePathForThumbnail(QString uuid, int appId, int scale)
+{
+    return QDir(Path::getBoxArtCacheDir()).filePath(uuid + "/" + QString::number(appId) + "@" + QString::number(scale) + "x.thumb");
+}
+
+QString
+BoxArtManager::getThumbnailCacheKey(QString uuid, int appId, int scale)
+{
+    // This is also the image provider ID for this thumbnail
+    return uuid + "/" + QString::number(appId) + "/" + QString::number(scale);
+}
+
+QUrl
+BoxArtManager::getThumbnailUrl(QString uuid, int appId)
+{
+    return QUrl("image://boxart/" + getThumbnailCacheKey(uuid, appId, getThumbnailScale()));
+}
+
+QUrl BoxArtManager::getBoxArt(NvComputer* computer, int appId)
+{
+    // Try to open the cached file if it exists and contains data
+    QFile cacheFile(getFilePathForBoxArt(computer, appId));
+    if (cacheFile.exists() && cacheFile.size() > 0) {
+        // The image provider will create the thumbnail if it doesn't exist yet
+        return getThumbnailUrl(computer->uuid, appId);
+    }
+
+    // Return the placeholder until the real image is fetched
+    return QUrl("qrc:/res/no_app_image.png");
+}
+
+void BoxArtManager::requestBoxArtLoad(NvComputer* computer, NvApp& app)
+{
+    QFile cacheFile(getFilePathForBoxArt(computer, app.id));
+    if (cacheFile.exists() && cacheFile.size() > 0) {
+        return;
+    }
+
+    // If we get here, we need to fetch asynchronously. We'll notify
+    // the caller later when the real image is ready. Each tile asking
+    // for the same app holds a reference, so the fetch is only cancelled
+    // once all of them are gone.
+    QString key = computer->uuid + "/" + QString::number(app.id);
+    auto it = m_PendingLoads.find(key);
+    if (it != m_PendingLoads.end()) {
+        it->refs++;
+    }
+    else if (BoxArtFetchScheduler::get()->fetch(computer, app.id, getThumbnailScale())) {
+        m_PendingLoads.insert(key, PendingLoad { computer, app, 1 });
+    }
+}
+
+QUrl BoxArtManager::loadBoxArtFile(NvComputer* computer, NvApp& app)
+{
+    requestBoxArtLoad(computer, app);
+
+    QUrl image = getBoxArt(computer, app.id);
+    if (image.scheme() == "image") {
+        return QUrl::fromLocalFile(getFilePathForBoxArt(computer, app.id));
+    }
+
+    return image;
+}
+
+void BoxArtManager::cancelBoxArtLoad(NvComputer* computer, int appId)
+{
+    auto it = m_PendingLoads.find(computer->uuid + "/" + QString::number(appId));
+    if (it == m_PendingLoads.end() || --it->refs > 0) {
+        // Already complete or another tile is still waiting for it
+        return;
+    }
+
+    m_PendingLoads.erase(it);
+    BoxArtFetchScheduler::get()->cancel(computer->uuid, appId);
+}
+
+void BoxArtManager::deleteBoxArt(NvComputer* computer)
+{
+    QDir dir(Path::getBoxArtCacheDir());
+
+    // Delete everything in this computer's box art directory
+    if (dir.cd(computer->uuid)) {
+        dir.removeRecursively();
+    }
+
+    // Drop any thumbnails we have in memory too
+    QMutexLocker locker(&s_ThumbnailCacheLock);
+    for (const QString& key : s_ThumbnailCache.keys()) {
+        if (key.startsWith(computer->uuid + "/")) {
+            s_ThumbnailCache.remove(key);
+        }
+    }
+}
+
+void BoxArtManager::handleBoxArtFetchCompleted(QString uuid, int appId, bool success)
+{
+    auto it = m_PendingLoads.find(uuid + "/" + QString::number(appId));
+    if (it == m_PendingLoads.end()) {
+        // Someone else requested this one
+        return;
+    }
+
+    NvComputer* computer = it->computer;
+    NvApp app = it->app;
+    m_PendingLoads.erase(it);
+
+    if (success) {
+        emit boxArtLoadComplete(computer, app, getThumbnailUrl(uuid, appId));
+    }
+}
+
+bool BoxArtManager::storeBoxArt(QString uuid, int appId, QByteArray data, int scale)
+{
+    // Make sure this is an image we can read. We store it exactly
+    // as the host sent it rather than decoding and re-encoding it.
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    if (data.isEmpty() || !reader.canRead()) {
+        return false;
+    }
+
+    QDir dir(Path::getBoxArtCacheDir());
+    if (!dir.exists(uuid)) {
+        dir.mkpath(uuid);
+    }
+
+    // Thumbnails of any previous image are now stale
+    for (int i = 1; i <= 3; i++) {
+        QFile::remove(getFilePathForThumbnail(uuid, appId, i));
+
+        QMutexLocker locker(&s_ThumbnailCacheLock);
+        s_ThumbnailCache.remove(getThumbnailCacheKey(uuid, appId, i));
+    }
+
+    // This may not actually be a PNG, but we read it by content. QSaveFile
+    // only replaces the cached file once the whole image has been written.
+    QSaveFile cacheFile(dir.filePath(uuid + "/" + QString::number(appId) + ".png"));
+    if (!cacheFile.open(QIODevice::WriteOnly) || cacheFile.write(data) != data.size() || !cacheFile.commit()) {
+        return false;
+    }
+
+    // Create the thumbnail now while we're already on a worker thread
+    loadThumbnail(uuid, appId, scale);
+    return true;
+}
+
+QImage BoxArtManager::loadThumbnail(QString uuid, int appId, int scale)
+{
+    QString key = getThumbnailCacheKey(uuid, appId, scale);
+
+    {
+        QMutexLocker locker(&s_ThumbnailCacheLock);
+        QImage* cachedImage = s_ThumbnailCache.object(key);
+        if (cachedImage != nullptr) {
+            return *cachedImage;
+        }
+    }
+
+    QString thumbnailPath = getFilePathForThumbnail(uuid, appId, scale);
+    QImageReader thumbnailReader(thumbnailPath);
+    thumbnailReader.setDecideFormatFromContent(true);
+    QImage thumbnail = thumbnailReader.read();
+
+    if (thumbnail.isNull()) {
+        // Create the thumbnail from the full size box art
+        QImageReader reader(QDir(Path::getBoxArtCacheDir()).filePath(uuid + "/" + QString::number(appId) + ".png"));
+        reader.setDecideFormatFromContent(true);
+
+        QSize originalSize = reader.size();
+        QSize maxSize(THUMBNAIL_WIDTH * scale, THUMBNAIL_HEIGHT * scale);
+        if (originalSize.isValid() && !isPlaceholderSize(originalSize) &&
+                (originalSize.width() > maxSize.width() || originalSize.height() > maxSize.height())) {
+            // This lets the JPEG decoder skip work by decoding at a reduced size
+            reader.setScaledSize(originalSize.scaled(maxSize, Qt::KeepAspectRatio));
+        }
+
+        thumbnail = reader.read();
+        if (thumbnail.isNull()) {
+            return QImage();
+        }
+
+        // JPEG decodes much faster than PNG, but it can't store transparency.
+        // The thumbnail is only put in place once it's completely written,
+        // so a crash can't leave a truncated file in the cache.
+        bool hasAlpha = thumbnail.hasAlphaChannel();
+        QSaveFile thumbnailFile(thumbnailPath);
+        if (thumbnailFile.open(QIODevice::WriteOnly)) {
+            QImageWriter writer(&thumbnailFile, hasAlpha ? "png" : "jpg");
+            if (!hasAlpha) {
+                writer.setQuality(THUMBNAIL_JPEG_QUALITY);
+            }
+            if (writer.write(thumbnail)) {
+                thumbnailFile.commit();
+            }
+            else {
+                thumbnailFile.cancelWriting();
+            }
+        }
+    }
+
+    QMutexLocker locker(&s_ThumbnailCacheLock);
+    s_ThumbnailCache.insert(key, new QImage(thumbnail), qMax(1, thumbnail.bytesPerLine() * thumbnail.height() / 1024));
+    return thumbnail;
+}
+
+class BoxArtImageResponse : public QQuickImageResponse
+{
+public:
+    QQuickTextureFactory* textureFactory() const override
+    {
+        return QQuickTextureFactory::textureFactoryForImage(m_Image);
+    }
+
+    void handleImageLoaded(const QImage& image)
+    {
+        m_Image = image;
+        emit finished();
+    }
+
+private:
+    QImage m_Image;
+};
+
+// QML may delete the response while this is still queued or running, so
+// the image is delivered through a queued signal. Qt drops it if the
+// response is already gone.
+class BoxArtImageLoadTask : public QObject, public QRunnable
 {
     Q_OBJECT
 
 public:
-    NetworkBoxArtLoadTask(BoxArtManager* boxArtManager, NvComputer* computer, NvApp& app)
-        : m_Bam(boxArtManager),
-          m_Computer(computer),
-          m_App(app)
+    BoxArtImageLoadTask(const QString& id)
+        : m_Id(id)
     {
-        connect(this, &NetworkBoxArtLoadTask::boxArtFetchCompleted,
-                boxArtManager, &BoxArtManager::handleBoxArtLoadComplete);
+
     }
 
 signals:
-    void boxArtFetchCompleted(NvComputer* computer, NvApp app, QUrl image);
+    void imageLoaded(const QImage& image);
 
 private:
     void run()
     {
-        QUrl image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
-        if (image.isEmpty()) {
-            // Give it another shot if it fails once
-            image = m_Bam->loadBoxArtFromNetwork(m_Computer, m_App.id);
+        QImage image;
+
+        // The ID is <uuid>/<appId>/<scale>
+        QStringList parts = m_Id.split('/');
+        if (parts.size() == 3) {
+            image = BoxArtManager::loadThumbnail(parts[0], parts[1].toInt(), parts[2].toInt());
+        }
+
+        if (image.isNull()) {
+            image = QImage(":/res/no_app_image.png");
         }
-        emit boxArtFetchCompleted(m_Computer, m_App, image);
+
+        emit imageLoaded(image);
     }
 
-    BoxArtManager* m_Bam;
-    NvComputer* m_Computer;
-    NvApp m_App;
+    QString m_Id;
 };
 
-QUrl BoxArtManager::loadBoxArt(NvComputer* computer, NvApp& app)
+BoxArtImageProvider::BoxArtImageProvider()
 {
-    // Try to open the cached file if it exists and contains data
-    QFile cacheFile(getFilePathForBoxArt(computer, app.id));
-    if (cacheFile.exists() && cacheFile.size() > 0) {
-        return QUrl::fromLocalFile(cacheFile.fileName());
-    }
+    m_ThreadPool.setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
+}
+
+QQuickImageResponse* BoxArtImageProvider::requestImageResponse(const QString& id, const QSize&)
+{
+    BoxArtImageResponse* response = new BoxArtImageResponse();
+    BoxArtImageLoadTask* loadTask = new BoxArtImageLoadTask(id);
 
-    // If we get here, we need to fetch asynchronously.
-    // Kick off a worker on our thread pool to do just that.
-    NetworkBoxArtLoadTask* netLoadTask = new NetworkBoxArtLoadTask(this, computer, app);
-    m_ThreadPool.start(netLoadTask);
+    connect(loadTask, &BoxArtImageLoadTask::imageLoaded,
+            response, &BoxArtImageResponse::handleImageLoaded,
+            Qt::QueuedConnection);
+    m_ThreadPool.start(loadTask);
 
-    // Return the placeholder then we can notify the caller
-    // later when the real image is ready.
-    return QUrl("qrc:/res/no_app_image.png");
+    return response;
 }
 
-void BoxArtManager::deleteBoxArt(NvComputer* computer)
+class BoxArtStoreTask : public QObject, public QRunnable
 {
-    QDir dir(Path::getBoxArtCacheDir());
+    Q_OBJECT
 
-    // Delete everything in this computer's box art directory
-    if (dir.cd(computer->uuid)) {
-        dir.removeRecursively();
+public:
+    BoxArtStoreTask(QString uuid, int appId, QByteArray data, int scale)
+        : m_Uuid(uuid),
+          m_AppId(appId),
+          m_Data(data),
+          m_Scale(scale)
+    {
+
+    }
+
+signals:
+    void storeCompleted(QString uuid, int appId, bool success);
+
+private:
+    void run()
+    {
+        bool success = BoxArtManager::storeBoxArt(m_Uuid, m_AppId, m_Data, m_Scale);
+        emit storeCompleted(m_Uuid, m_AppId, success);
     }
+
+    QString m_Uuid;
+    int m_AppId;
+    QByteArray m_Data;
+    int m_Scale;
+};
+
+BoxArtFetchScheduler::BoxArtFetchScheduler()
+    : m_NextRequestId(0)
+{
+    m_Clock.start();
 }
 
-void BoxArtManager::handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image)
+BoxArtFetchScheduler* BoxArtFetchScheduler::get()
 {
-    if (!image.isEmpty()) {
-        emit boxArtLoadComplete(computer, app, image);
+    // This is only used on the main thread
+    if (s_Scheduler == nullptr) {
+        s_Scheduler = new BoxArtFetchScheduler();
     }
+
+    return s_Scheduler;
 }
 
-QUrl BoxArtManager::loadBoxArtFromNetwork(NvComputer* computer, int appId)
+QString BoxArtFetchScheduler::getRequestKey(const QString& uuid, int appId)
 {
-    NvHTTP http(computer);
+    return uuid + "/" + QString::number(appId);
+}
+
+bool BoxArtFetchScheduler::fetch(NvComputer* computer, int appId, int scale)
+{
+    QString key = getRequestKey(computer->uuid, appId);
+
+    auto failure = m_Failures.constFind(key);
+    if (failure != m_Failures.constEnd() && m_Clock.elapsed() < failure->retryTime) {
+        return false;
+    }
+
+    HostState* host = m_Hosts.value(computer->uuid);
+    if (host == nullptr) {
+        host = new HostState();
+        host->http = nullptr;
+        host->inFlight = 0;
+        m_Hosts.insert(computer->uuid, host);
+    }
+
+    // Pick up any address changes from polling
+    {
+        QReadLocker lock(&computer->lock);
+
+        host->address = computer->activeAddress;
+        host->httpsPort = computer->activeHttpsPort;
+        host->serverCert = computer->serverCert;
+    }
+    host->connectionReuse = computer->supportsConnectionReuse();
 
-    QString cachePath = getFilePathForBoxArt(computer, appId);
-    QImage image;
-    try {
-        image = http.getBoxArt(appId);
-    } catch (...) {}
+    FetchRequest* request = m_Requests.value(key);
+    if (request != nullptr) {
+        request->refs++;
 
-    // Cache the box art on disk if it loaded
-    if (!image.isNull()) {
-        if (image.save(cachePath)) {
-            return QUrl::fromLocalFile(cachePath);
+        // Move it to the front of the line if it's still waiting
+        if (host->queue.removeOne(request)) {
+            host->queue.append(request);
         }
-        else {
-            // A failed save() may leave a zero byte file. Make sure that's removed.
-            QFile(cachePath).remove();
+        return true;
+    }
+
+    request = new FetchRequest();
+    request->id = ++m_NextRequestId;
+    request->uuid = computer->uuid;
+    request->appId = appId;
+    request->scale = scale;
+    request->refs = 1;
+    request->attempts = 0;
+    request->started = false;
+    m_Requests.insert(key, request);
+
+    host->queue.append(request);
+    dispatch(computer->uuid);
+    return true;
+}
+
+void BoxArtFetchScheduler::cancel(const QString& uuid, int appId)
+{
+    QString key = getRequestKey(uuid, appId);
+    FetchRequest* request = m_Requests.value(key);
+    if (request == nullptr || --request->refs > 0) {
+        return;
+    }
+
+    m_Requests.remove(key);
+
+    HostState* host = m_Hosts.value(uuid);
+    Q_ASSERT(host != nullptr);
+
+    if (request->started) {
+        // We've already removed the request, so the response will be dropped
+        host->inFlight--;
+        if (request->reply) {
+            request->reply->abort();
         }
     }
+    else {
+        host->queue.removeOne(request);
+    }
+    delete request;
+
+    dispatch(uuid);
+}
+
+void BoxArtFetchScheduler::dispatch(const QString& uuid)
+{
+    HostState* host = m_Hosts.value(uuid);
+    if (host == nullptr) {
+        return;
+    }
+
+    int maxFetches = host->connectionReuse ? MAX_FETCHES_PER_HOST : MAX_FETCHES_PER_HOST_GFE;
+
+    // Newest requests are at the end of the queue
+    while (host->inFlight < maxFetches && !host->queue.isEmpty()) {
+        startFetch(host, host->queue.takeLast());
+    }
+
+    // Drop our state for hosts with nothing left to do
+    if (host->inFlight == 0 && host->queue.isEmpty()) {
+        m_Hosts.remove(uuid);
+        delete host->http;
+        delete host;
+    }
+}
+
+void BoxArtFetchScheduler::startFetch(HostState* host, FetchRequest* request)
+{
+    QString key = getRequestKey(request->uuid, request->appId);
+    quint64 requestId = request->id;
+
+    host->inFlight++;
+    request->attempts++;
+    request->started = true;
+
+    if (host->address.isNull()) {
+        // The host was offline when this was requested. Complete it later
+        // since we may be in the middle of dispatching this host's queue.
+        QTimer::singleShot(0, this, [this, key, requestId] {
+            handleFetchResponse(key, requestId, QByteArray(),
+                                std::make_exception_ptr(QtNetworkReplyException(QNetworkReply::HostNotFoundError,
+                                                                                "Host is offline")));
+        });
+        return;
+    }
+
+    // Keep one NvHTTP object per host
+    if (host->http == nullptr) {
+        host->http = new NvHTTP(host->address, host->httpsPort, host->serverCert);
+    }
+    else {
+        host->http->setAddress(host->address);
+        host->http->setHttpsPort(host->httpsPort);
+        host->http->setServerCert(host->serverCert);
+    }
+    host->http->setConnectionReuse(host->connectionReuse);
+
+    request->reply = host->http->getBoxArtDataAsync(request->appId,
+                                                    [this, key, requestId](const QByteArray& data, std::exception_ptr error) {
+        handleFetchResponse(key, requestId, data, error);
+    });
+}
+
+void BoxArtFetchScheduler::handleFetchResponse(QString key, quint64 requestId, const QByteArray& data, std::exception_ptr error)
+{
+    FetchRequest* request = m_Requests.value(key);
+    if (request == nullptr || request->id != requestId) {
+        // This request was cancelled
+        return;
+    }
+
+    QString uuid = request->uuid;
+    HostState* host = m_Hosts.value(uuid);
+    Q_ASSERT(host != nullptr);
+
+    host->inFlight--;
+    request->started = false;
+    request->reply = nullptr;
+
+    if (error && request->attempts < FETCH_ATTEMPTS) {
+        // Give it another shot if it fails once
+        host->queue.append(request);
+        dispatch(uuid);
+        return;
+    }
+
+    m_Requests.remove(key);
+
+    if (error) {
+        recordFailure(key);
+        emit fetchCompleted(uuid, request->appId, false);
+    }
+    else {
+        // Decoding and disk I/O happen off the main thread
+        BoxArtStoreTask* storeTask = new BoxArtStoreTask(uuid, request->appId, data, request->scale);
+        connect(storeTask, &BoxArtStoreTask::storeCompleted,
+                this, &BoxArtFetchScheduler::handleStoreCompleted);
+        m_StorePool.start(storeTask);
+    }
+
+    delete request;
+    dispatch(uuid);
+}
+
+void BoxArtFetchScheduler::handleStoreCompleted(QString uuid, int appId, bool success)
+{
+    QString key = getRequestKey(uuid, appId);
+
+    if (success) {
+        m_Failures.remove(key);
+    }
+    else {
+        // The host didn't give us an image we can use
+        recordFailure(key);
+    }
+
+    emit fetchCompleted(uuid, appId, success);
+}
+
+void BoxArtFetchScheduler::recordFailure(const QString& key)
+{
+    FailureRecord& failure = m_Failures[key];
 
-    return QUrl();
+    int backoffMs = FAILED_FETCH_BACKOFF_MS << qMin(failure.failures, 7);
+    failure.failures++;
+    failure.retryTime = m_Clock.elapsed() + qMin(backoffMs, FAILED_FETCH_BACKOFF_MAX_MS);
 }
 
 #include "boxartmanager.moc"
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "computermanager.h"
+#include <QCache>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QImage>
+#include <QMutex>
+#include <QPointer>
+#include <QQuickAsyncImageProvider>
 #include <QThreadPool>
 #include <QRunnable>
 
@@ -10,18 +15,47 @@ class BoxArtManager : public QObject
 {
     Q_OBJECT
 
-    friend class NetworkBoxArtLoadTask;
-
 public:
     explicit BoxArtManager(QObject *parent = nullptr);
 
+    virtual ~BoxArtManager();
+
+    // Returns the cached box art or a placeholder. This never fetches.
     QUrl
-    loadBoxArt(NvComputer* computer, NvApp& app);
+    getBoxArt(NvComputer* computer, int appId);
+
+    // Starts fetching the box art if it isn't cached yet. Each call must
+    // be paired with cancelBoxArtLoad() once the caller stops waiting.
+    void
+    requestBoxArtLoad(NvComputer* computer, NvApp& app);
+
+    // Like getBoxArt() after requesting a load, but a cached image is
+    // returned as a file URL of the full size box art for consumers
+    // outside of QML
+    QUrl
+    loadBoxArtFile(NvComputer* computer, NvApp& app);
+
+    // Called when the tile for this app is no longer shown
+    void
+    cancelBoxArtLoad(NvComputer* computer, int appId);
 
     static
     void
     deleteBoxArt(NvComputer* computer);
 
+    // Returns a thumbnail sized for the app grid at the given scale factor,
+    // creating it from the full size box art if needed. This may block on
+    // disk I/O and image decoding, so it must not be called on the UI thread.
+    static
+    QImage
+    loadThumbnail(QString uuid, int appId, int scale);
+
+    // Writes box art fetched from the host to the disk cache and creates
+    // its thumbnail. Returns false if the data isn't a valid image.
+    static
+    bool
+    storeBoxArt(QString uuid, int appId, QByteArray data, int scale);
+
 signals:
     void
     boxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
@@ -30,15 +64,129 @@ public slots:
 
 private slots:
     void
-    handleBoxArtLoadComplete(NvComputer* computer, NvApp app, QUrl image);
+    handleBoxArtFetchCompleted(QString uuid, int appId, bool success);
 
 private:
-    QUrl
-    loadBoxArtFromNetwork(NvComputer* computer, int appId);
+    struct PendingLoad {
+        NvComputer* computer;
+        NvApp app;
+
+        // Number of tiles waiting on this load
+        int refs;
+    };
 
     QString
     getFilePathForBoxArt(NvComputer* computer, int appId);
 
+    static
+    QString
+    getFilePathForThumbnail(QString uuid, int appId, int scale);
+
+    static
+    QUrl
+    getThumbnailUrl(QString uuid, int appId);
+
+    static
+    QString
+    getThumbnailCacheKey(QString uuid, int appId, int scale);
+
     QDir m_BoxArtDir;
+    QHash<QString, PendingLoad> m_PendingLoads;
+
+    // Decoded thumbnails shared by all AppModels
+    static QCache<QString, QImage> s_ThumbnailCache;
+    static QMutex s_ThumbnailCacheLock;
+};
+
+// Fetches box art for all BoxArtManagers using the asynchronous NvHTTP API.
+// Each host gets a limited number of concurrent requests over a reused
+// connection where the host supports it. The most recently requested
+// tiles are fetched first, since they're the ones the user just scrolled
+// to, and requests are cancelled when their tiles go away. Apps that fail
+// to fetch are not retried until an increasing backoff period elapses.
+//
+// Hosts are tracked by UUID with a copy of their connection details from
+// the last fetch() call, so a host deleted while its requests are queued
+// is never dereferenced.
+class BoxArtFetchScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    static BoxArtFetchScheduler* get();
+
+    // Returns false if this app is backing off after failed fetches
+    bool fetch(NvComputer* computer, int appId, int scale);
+
+    // Each fetch() call must be balanced by a cancel() call
+    // unless fetchCompleted() has been emitted.
+    void cancel(const QString& uuid, int appId);
+
+signals:
+    void fetchCompleted(QString uuid, int appId, bool success);
+
+private slots:
+    void handleStoreCompleted(QString uuid, int appId, bool success);
+
+private:
+    struct FetchRequest {
+        quint64 id;
+        QString uuid;
+        int appId;
+        int scale;
+        int refs;
+        int attempts;
+        bool started;
+        QPointer<QNetworkReply> reply;
+    };
+
+    struct HostState {
+        NvHTTP* http;
+        NvAddress address;
+        uint16_t httpsPort;
+        QSslCertificate serverCert;
+        bool connectionReuse;
+        QList<FetchRequest*> queue;
+        int inFlight;
+    };
+
+    struct FailureRecord {
+        int failures;
+        qint64 retryTime;
+    };
+
+    BoxArtFetchScheduler();
+
+    void dispatch(const QString& uuid);
+
+    void startFetch(HostState* host, FetchRequest* request);
+
+    void handleFetchResponse(QString key, quint64 requestId, const QByteArray& data, std::exception_ptr error);
+
+    void recordFailure(const QString& key);
+
+    static QString getRequestKey(const QString& uuid, int appId);
+
+    QHash<QString, FetchRequest*> m_Requests;
+    QHash<QString, HostState*> m_Hosts;
+    QHash<QString, FailureRecord> m_Failures;
+    QElapsedTimer m_Clock;
+    QThreadPool m_StorePool;
+    quint64 m_NextRequestId;
+
+    static BoxArtFetchScheduler* s_Scheduler;
+};
+
+// Serves box art thumbnails to QML from image://boxart/<uuid>/<appId>/<scale>
+// URLs. Thumbnails are decoded and scaled on a thread pool, so scrolling
+// through a large app grid doesn't stall the UI thread.
+class BoxArtImageProvider : public QQuickAsyncImageProvider
+{
+public:
+    BoxArtImageProvider();
+
+    QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+
+private:
     QThreadPool m_ThreadPool;
 };
@@ -2,10 +2,13 @@
 #include "boxartmanager.h"
 #include "nvhttp.h"
 #include "nvpairingmanager.h"
+#include "../startuptracer.h"
 
 #include <Limelight.h>
 #include <QtEndian>
 
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QThread>
 #include <QThreadPool>
 #include <QCoreApplication>
@@ -15,134 +18,107 @@
 #define SER_HOSTS "hosts"
 #define SER_HOSTS_BACKUP "hostsbackup"
 
-class PcMonitorThread : public QThread
-{
-    Q_OBJECT
+#define SER_MDNSCACHE "mdnscache"
+#define SER_MDNSHOSTNAME "hostname"
+#define SER_MDNSPORT "port"
+#define SER_MDNSADDRESSES "addresses"
+#define SER_MDNSEXPIRATION "expiration"
 
-#define TRIES_BEFORE_OFFLINING 2
-#define POLLS_PER_APPLIST_FETCH 10
-
-public:
-    PcMonitorThread(NvComputer* computer)
-        : m_Computer(computer)
-    {
-        setObjectName("Polling thread for " + computer->name);
-    }
+// DHCP leases on home networks usually last at least this long
+#define MDNS_ADDRESS_CACHE_TTL_SECS (24 * 60 * 60)
 
-private:
-    bool tryPollComputer(NvAddress address, bool& changed)
-    {
-        NvHTTP http(address, 0, m_Computer->serverCert);
+MdnsAddressCache::MdnsAddressCache()
+{
+    QSettings settings;
+    qint64 now = QDateTime::currentSecsSinceEpoch();
 
-        QString serverInfo;
-        try {
-            serverInfo = http.getServerInfo(NvHTTP::NvLogLevel::NVLL_NONE, true);
-        } catch (...) {
-            return false;
-        }
+    int entries = settings.beginReadArray(SER_MDNSCACHE);
+    for (int i = 0; i < entries; i++) {
+        settings.setArrayIndex(i);
 
-        NvComputer newState(http, serverInfo);
+        Entry entry;
+        entry.port = settings.value(SER_MDNSPORT).toUInt();
+        entry.addresses = settings.value(SER_MDNSADDRESSES).toStringList();
+        entry.expirationTime = settings.value(SER_MDNSEXPIRATION).toLongLong();
 
-        // Ensure the machine that responded is the one we intended to contact
-        if (m_Computer->uuid != newState.uuid) {
-            qInfo() << "Found unexpected PC" << newState.name << "looking for" << m_Computer->name;
-            return false;
+        if (entry.expirationTime > now && entry.port != 0 && !entry.addresses.isEmpty()) {
+            m_Entries.insert(settings.value(SER_MDNSHOSTNAME).toString(), entry);
         }
-
-        changed = m_Computer->update(newState);
-        return true;
     }
+    settings.endArray();
+}
 
-    bool updateAppList(bool& changed)
-    {
-        NvHTTP http(m_Computer);
+QStringList MdnsAddressCache::toSortedStringList(const QVector<QHostAddress>& addresses)
+{
+    QStringList list;
+    for (const QHostAddress& address : addresses) {
+        list.append(address.toString());
+    }
+    list.sort();
+    return list;
+}
 
-        QVector<NvApp> appList;
+QVector<MdnsAddressCache::Host> MdnsAddressCache::getHosts() const
+{
+    QVector<Host> hosts;
+    qint64 now = QDateTime::currentSecsSinceEpoch();
 
-        try {
-            appList = http.getAppList();
-            if (appList.isEmpty()) {
-                return false;
-            }
-        } catch (...) {
-            return false;
+    for (auto it = m_Entries.constBegin(); it != m_Entries.constEnd(); ++it) {
+        if (it->expirationTime <= now) {
+            continue;
         }
 
-        QWriteLocker lock(&m_Computer->lock);
-        changed = m_Computer->updateAppList(appList);
-        return true;
+        Host host;
+        host.hostname = it.key();
+        host.port = it->port;
+        for (const QString& address : it->addresses) {
+            host.addresses.append(QHostAddress(address));
+        }
+        hosts.append(host);
     }
 
-    void run() override
-    {
-        // Always fetch the applist the first time
-        int pollsSinceLastAppListFetch = POLLS_PER_APPLIST_FETCH;
-        while (!isInterruptionRequested()) {
-            bool stateChanged = false;
-            bool online = false;
-            bool wasOnline = m_Computer->state == NvComputer::CS_ONLINE;
-            for (int i = 0; i < (wasOnline ? TRIES_BEFORE_OFFLINING : 1) && !online; i++) {
-                for (auto& address : m_Computer->uniqueAddresses()) {
-                    if (isInterruptionRequested()) {
-                        return;
-                    }
+    return hosts;
+}
 
-                    if (tryPollComputer(address, stateChanged)) {
-                        if (!wasOnline) {
-                            qInfo() << m_Computer->name << "is now online at" << m_Computer->activeAddress.toString();
-                        }
-                        online = true;
-                        break;
-                    }
-                }
-            }
+bool MdnsAddressCache::update(const QString& hostname, uint16_t port, const QVector<QHostAddress>& addresses)
+{
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    QStringList addressList = toSortedStringList(addresses);
 
-            // Check if we failed after all retry attempts
-            // Note: we don't need to acquire the read lock here,
-            // because we're on the writing thread.
-            if (!online && m_Computer->state != NvComputer::CS_OFFLINE) {
-                qInfo() << m_Computer->name << "is now offline";
-                m_Computer->state = NvComputer::CS_OFFLINE;
-                stateChanged = true;
-            }
+    auto it = m_Entries.find(hostname);
+    bool changed = it == m_Entries.end() || it->expirationTime <= now ||
+            it->port != port || it->addresses != addressList;
 
-            // Grab the applist if it's empty or it's been long enough that we need to refresh
-            pollsSinceLastAppListFetch++;
-            if (m_Computer->state == NvComputer::CS_ONLINE &&
-                    m_Computer->pairState == NvComputer::PS_PAIRED &&
-                    (m_Computer->appList.isEmpty() || pollsSinceLastAppListFetch >= POLLS_PER_APPLIST_FETCH)) {
-                // Notify prior to the app list poll since it may take a while, and we don't
-                // want to delay onlining of a machine, especially if we already have a cached list.
-                if (stateChanged) {
-                    emit computerStateChanged(m_Computer);
-                    stateChanged = false;
-                }
+    Entry& entry = m_Entries[hostname];
+    entry.port = port;
+    entry.addresses = addressList;
+    entry.expirationTime = now + MDNS_ADDRESS_CACHE_TTL_SECS;
+    save();
 
-                if (updateAppList(stateChanged)) {
-                    pollsSinceLastAppListFetch = 0;
-                }
-            }
-
-            if (stateChanged) {
-                // Tell anyone listening that we've changed state
-                emit computerStateChanged(m_Computer);
-            }
+    return changed;
+}
 
-            // Wait a bit to poll again, but do it in 100 ms chunks
-            // so we can be interrupted reasonably quickly.
-            // FIXME: QWaitCondition would be better.
-            for (int i = 0; i < 30 && !isInterruptionRequested(); i++) {
-                QThread::msleep(100);
-            }
+void MdnsAddressCache::save() const
+{
+    QSettings settings;
+    qint64 now = QDateTime::currentSecsSinceEpoch();
+    int i = 0;
+
+    settings.remove(SER_MDNSCACHE);
+    settings.beginWriteArray(SER_MDNSCACHE);
+    for (auto it = m_Entries.constBegin(); it != m_Entries.constEnd(); ++it) {
+        if (it->expirationTime <= now) {
+            continue;
         }
-    }
-
-signals:
-   void computerStateChanged(NvComputer* computer);
 
-private:
-    NvComputer* m_Computer;
-};
+        settings.setArrayIndex(i++);
+        settings.setValue(SER_MDNSHOSTNAME, it.key());
+        settings.setValue(SER_MDNSPORT, it->port);
+        settings.setValue(SER_MDNSADDRESSES, it->addresses);
+        settings.setValue(SER_MDNSEXPIRATION, it->expirationTime);
+    }
+    settings.endArray();
+}
 
 ComputerManager::ComputerManager(StreamingPreferences* prefs)
     : m_Prefs(prefs),
@@ -151,29 +127,54 @@ ComputerManager::ComputerManager(StreamingPreferences* prefs)
       m_CompatFetcher(nullptr),
       m_NeedsDelayedFlush(false)
 {
-    QSettings settings;
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+
+    STARTUP_TRACE_BEGIN("ComputerManager load");
+
+    QVector<NvComputer*> hosts;
+    if (!m_HostStore.load(hosts)) {
+        QSettings settings;
+
+        // If there's a hosts backup copy, we must have failed to commit
+        // a previous update before exiting. Restore the backup now.
+        int hostCount = settings.beginReadArray(SER_HOSTS_BACKUP);
+        if (hostCount == 0) {
+            // If there's no host backup, read from the primary location.
+            settings.endArray();
+            hostCount = settings.beginReadArray(SER_HOSTS);
+        }
 
-    // If there's a hosts backup copy, we must have failed to commit
-    // a previous update before exiting. Restore the backup now.
-    int hosts = settings.beginReadArray(SER_HOSTS_BACKUP);
-    if (hosts == 0) {
-        // If there's no host backup, read from the primary location.
+        // Migrate hosts from QSettings into the host database. We leave
+        // the old copy alone in case the user goes back to an older version.
+        for (int i = 0; i < hostCount; i++) {
+            settings.setArrayIndex(i);
+            NvComputer* computer = new NvComputer(settings);
+            m_HostStore.putHost(*computer);
+            hosts.append(computer);
+        }
         settings.endArray();
-        hosts = settings.beginReadArray(SER_HOSTS);
+
+        m_HostStore.compact();
+        qInfo() << "Migrated" << hosts.count() << "hosts from QSettings";
     }
 
-    // Inflate our hosts from QSettings
-    for (int i = 0; i < hosts; i++) {
-        settings.setArrayIndex(i);
-        NvComputer* computer = new NvComputer(settings);
+    for (NvComputer* computer : hosts) {
         m_KnownHosts[computer->uuid] = computer;
         m_LastSerializedHosts[computer->uuid] = *computer;
     }
-    settings.endArray();
+
+    STARTUP_TRACE_END("ComputerManager load");
+    qInfo() << "Loaded" << hosts.count() << "hosts in" << loadTimer.elapsed() << "ms";
 
     // Fetch latest compatibility data asynchronously
     m_CompatFetcher.start();
 
+    // Polling for all hosts is multiplexed onto a single thread
+    m_PollScheduler = new ComputerPollScheduler();
+    connect(m_PollScheduler, &ComputerPollScheduler::computerStateChanged,
+            this, &ComputerManager::handleComputerStateChanged);
+
     // Start the delayed flush thread to handle saveHosts() calls
     m_DelayedFlushThread = new DelayedFlushThread(this);
     m_DelayedFlushThread->start();
@@ -216,15 +217,9 @@ ComputerManager::~ComputerManager()
     delete m_MdnsBrowser;
     m_MdnsBrowser = nullptr;
 
-    // Interrupt polling
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
-
-    // Delete all polling entries (and associated threads)
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        delete entry;
-    }
+    // Stop the polling thread
+    delete m_PollScheduler;
+    m_PollScheduler = nullptr;
 
     // Destroy all NvComputer objects now that polling is halted
     for (NvComputer* computer : m_KnownHosts) {
@@ -234,6 +229,9 @@ ComputerManager::~ComputerManager()
 
 void DelayedFlushThread::run() {
     for (;;) {
+        QVector<NvComputer> changedHosts;
+        QStringList removedHosts;
+
         // Wait for a delayed flush request or an interruption
         {
             QMutexLocker locker(&m_ComputerManager->m_DelayedFlushMutex);
@@ -252,47 +250,47 @@ void DelayedFlushThread::run() {
             // Reset the delayed flush flag to ensure any racing saveHosts() call will set it again
             m_ComputerManager->m_NeedsDelayedFlush = false;
 
-            // Update the last serialized hosts map under the delayed flush mutex
-            m_ComputerManager->m_LastSerializedHosts.clear();
+            // Find the hosts that changed since the last flush and update
+            // the last serialized hosts map under the delayed flush mutex
+            QReadLocker lock(&m_ComputerManager->m_Lock);
             for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
                 // Copy the current state of the NvComputer to allow us to check later if we need
                 // to serialize it again when attribute updates occur.
                 QReadLocker computerLock(&computer->lock);
-                m_ComputerManager->m_LastSerializedHosts[computer->uuid] = *computer;
+                auto it = m_ComputerManager->m_LastSerializedHosts.find(computer->uuid);
+                if (it == m_ComputerManager->m_LastSerializedHosts.end() || !it->isEqualSerialized(*computer)) {
+                    m_ComputerManager->m_LastSerializedHosts[computer->uuid] = *computer;
+                    changedHosts.append(*computer);
+                }
+            }
+
+            for (auto it = m_ComputerManager->m_LastSerializedHosts.begin(); it != m_ComputerManager->m_LastSerializedHosts.end();) {
+                if (!m_ComputerManager->m_KnownHosts.contains(it.key())) {
+                    removedHosts.append(it.key());
+                    it = m_ComputerManager->m_LastSerializedHosts.erase(it);
+                }
+                else {
+                    ++it;
+                }
             }
         }
 
-        // Perform the flush
+        // Only write the records for hosts that changed
         {
-            QSettings settings;
+            QElapsedTimer flushTimer;
+            flushTimer.start();
 
-            // First, write to the backup location
-            settings.beginWriteArray(SER_HOSTS_BACKUP);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, false);
-                }
+            for (const NvComputer& computer : changedHosts) {
+                m_ComputerManager->m_HostStore.putHost(computer);
             }
-            settings.endArray();
-
-            // Next, write to the primary location
-            settings.remove(SER_HOSTS);
-            settings.beginWriteArray(SER_HOSTS);
-            {
-                QReadLocker lock(&m_ComputerManager->m_Lock);
-                int i = 0;
-                for (const NvComputer* computer : m_ComputerManager->m_KnownHosts) {
-                    settings.setArrayIndex(i++);
-                    computer->serialize(settings, true);
-                }
+            for (const QString& uuid : removedHosts) {
+                m_ComputerManager->m_HostStore.removeHost(uuid);
             }
-            settings.endArray();
+            m_ComputerManager->m_HostStore.commit();
 
-            // Finally, delete the backup copy
-            settings.remove(SER_HOSTS_BACKUP);
+            qInfo() << "Saved" << changedHosts.count() << "changed and"
+                    << removedHosts.count() << "removed hosts in"
+                    << flushTimer.elapsed() << "ms";
         }
     }
 }
@@ -301,14 +299,13 @@ void ComputerManager::saveHosts()
 {
     Q_ASSERT(m_DelayedFlushThread != nullptr && m_DelayedFlushThread->isRunning());
 
-    // Punt to a worker thread because QSettings on macOS can take ages (> 500 ms)
-    // to persist our host list to disk (especially when a host has a bunch of apps).
+    // Punt to a worker thread to keep disk I/O off the main thread
     QMutexLocker locker(&m_DelayedFlushMutex);
     m_NeedsDelayedFlush = true;
     m_DelayedFlushCondition.wakeOne();
 }
 
-QHostAddress ComputerManager::getBestGlobalAddressV6(QVector<QHostAddress> &addresses)
+QHostAddress ComputerManager::getBestGlobalAddressV6(const QVector<QHostAddress> &addresses)
 {
     for (const QHostAddress& address : addresses) {
         if (address.protocol() == QAbstractSocket::IPv6Protocol) {
@@ -353,14 +350,23 @@ void ComputerManager::startPolling()
     }
 
     if (m_Prefs->enableMdns) {
+        // Start talking to hosts we resolved recently right away rather than
+        // waiting for the browser to find them again. They're revalidated
+        // when they resolve, and only added again if their addresses changed.
+        for (const MdnsAddressCache::Host& host : m_MdnsAddressCache.getHosts()) {
+            qInfo() << "Using cached addresses for mDNS host:" << host.hostname;
+            addMdnsHost(host.port, host.addresses);
+        }
+
         // Start an MDNS query for GameStream hosts
         m_MdnsServer.reset(new QMdnsEngine::Server());
-        m_MdnsBrowser = new QMdnsEngine::Browser(m_MdnsServer.data(), "_nvstream._tcp.local.");
+        m_MdnsCache.reset(new QMdnsEngine::Cache());
+        m_MdnsBrowser = new QMdnsEngine::Browser(m_MdnsServer.data(), "_nvstream._tcp.local.", m_MdnsCache.data());
         connect(m_MdnsBrowser, &QMdnsEngine::Browser::serviceAdded,
                 this, [this](const QMdnsEngine::Service& service) {
             qInfo() << "Discovered mDNS host:" << service.hostname();
 
-            MdnsPendingComputer* pendingComputer = new MdnsPendingComputer(m_MdnsServer, service);
+            MdnsPendingComputer* pendingComputer = new MdnsPendingComputer(m_MdnsServer, m_MdnsCache, service);
             connect(pendingComputer, &MdnsPendingComputer::resolvedHost,
                     this, &ComputerManager::handleMdnsServiceResolved);
             m_PendingResolution.append(pendingComputer);
@@ -370,7 +376,7 @@ void ComputerManager::startPolling()
         qWarning() << "mDNS is disabled by user preference";
     }
 
-    // Start polling threads for each known host
+    // Start polling each known host
     QMapIterator<QString, NvComputer*> i(m_KnownHosts);
     while (i.hasNext()) {
         i.next();
@@ -385,26 +391,22 @@ void ComputerManager::startPollingComputer(NvComputer* computer)
         return;
     }
 
-    ComputerPollingEntry* pollingEntry;
+    m_PollScheduler->startPolling(computer);
+}
 
-    if (!m_PollEntries.contains(computer->uuid)) {
-        pollingEntry = m_PollEntries[computer->uuid] = new ComputerPollingEntry();
-    }
-    else {
-        pollingEntry = m_PollEntries[computer->uuid];
+void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
+                                                QVector<QHostAddress>& addresses)
+{
+    // Don't add the host again if we already did using the same cached addresses
+    if (m_MdnsAddressCache.update(computer->hostname(), computer->port(), addresses)) {
+        addMdnsHost(computer->port(), addresses);
     }
 
-    if (!pollingEntry->isActive()) {
-        PcMonitorThread* thread = new PcMonitorThread(computer);
-        connect(thread, &PcMonitorThread::computerStateChanged,
-                this, &ComputerManager::handleComputerStateChanged);
-        pollingEntry->setActiveThread(thread);
-        thread->start();
-    }
+    m_PendingResolution.removeOne(computer);
+    computer->deleteLater();
 }
 
-void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
-                                                QVector<QHostAddress>& addresses)
+void ComputerManager::addMdnsHost(uint16_t port, const QVector<QHostAddress>& addresses)
 {
     QHostAddress v6Global = getBestGlobalAddressV6(addresses);
     bool added = false;
@@ -416,7 +418,7 @@ void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
             // address may not be reachable (if the user hasn't installed the IPv6 helper yet
             // or if this host lacks outbound IPv6 capability). We want to add IPv6 even if
             // it's not currently reachable.
-            addNewHost(NvAddress(address, computer->port()), true, NvAddress(v6Global, computer->port()));
+            addNewHost(NvAddress(address, port), true, NvAddress(v6Global, port));
             added = true;
             break;
         }
@@ -430,15 +432,12 @@ void ComputerManager::handleMdnsServiceResolved(MdnsPendingComputer* computer,
                 if (address.isInSubnet(QHostAddress("fe80::"), 10) ||
                         address.isInSubnet(QHostAddress("fec0::"), 10) ||
                         address.isInSubnet(QHostAddress("fc00::"), 7)) {
-                    addNewHost(NvAddress(address, computer->port()), true, NvAddress(v6Global, computer->port()));
+                    addNewHost(NvAddress(address, port), true, NvAddress(v6Global, port));
                     break;
                 }
             }
         }
     }
-
-    m_PendingResolution.removeOne(computer);
-    computer->deleteLater();
 }
 
 void ComputerManager::saveHost(NvComputer *computer)
@@ -488,23 +487,19 @@ public:
 
     void run()
     {
-        ComputerPollingEntry* pollingEntry;
-
         // Only do the minimum amount of work while holding the writer lock.
         // We must release it before calling saveHosts().
         {
             QWriteLocker lock(&m_ComputerManager->m_Lock);
 
-            pollingEntry = m_ComputerManager->m_PollEntries.take(m_Computer->uuid);
-
             m_ComputerManager->m_KnownHosts.remove(m_Computer->uuid);
         }
 
         // Persist the new host list with this computer deleted
         m_ComputerManager->saveHosts();
 
-        // Delete the polling entry first. This will stop all polling threads too.
-        delete pollingEntry;
+        // Stop polling first. This waits until the scheduler is done with the computer.
+        m_ComputerManager->m_PollScheduler->removeComputer(m_Computer);
 
         // Delete cached box art
         BoxArtManager::deleteBoxArt(m_Computer);
@@ -549,11 +544,9 @@ void ComputerManager::handleAboutToQuit()
 {
     QReadLocker lock(&m_Lock);
 
-    // Interrupt polling threads immediately, so they
-    // avoid making additional requests while quitting
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
+    // Stop polling immediately, so we avoid
+    // making additional requests while quitting
+    m_PollScheduler->stopPolling();
 }
 
 class PendingPairingTask : public QObject, public QRunnable
@@ -700,12 +693,11 @@ void ComputerManager::stopPollingAsync()
     // Delete the browser and server to stop discovery and refresh polling
     delete m_MdnsBrowser;
     m_MdnsBrowser = nullptr;
+    m_MdnsCache.reset();
     m_MdnsServer.reset();
 
-    // Interrupt all threads, but don't wait for them to terminate
-    for (ComputerPollingEntry* entry : m_PollEntries) {
-        entry->interrupt();
-    }
+    // Stop polling, but don't wait for requests in flight to complete
+    m_PollScheduler->stopPolling();
 }
 
 void ComputerManager::addNewHostManually(QString address)
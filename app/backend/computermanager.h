@@ -1,6 +1,8 @@
 #pragma once
 
 #include "nvcomputer.h"
+#include "computerpollscheduler.h"
+#include "hoststore.h"
 #include "settings/streamingpreferences.h"
 #include "settings/compatfetcher.h"
 
@@ -18,6 +20,12 @@
 #include <QMutex>
 #include <QWaitCondition>
 
+// How long to wait for more addresses after a host's first address resolves
+#define MDNS_RESOLVE_SETTLE_MS 250
+
+// How long to wait for a host to resolve before retrying
+#define MDNS_RESOLVE_TIMEOUT_MS 2000
+
 class ComputerManager;
 
 class DelayedFlushThread : public QThread
@@ -43,12 +51,24 @@ class MdnsPendingComputer : public QObject
 
 public:
     explicit MdnsPendingComputer(const QSharedPointer<QMdnsEngine::Server> server,
+                                 const QSharedPointer<QMdnsEngine::Cache> cache,
                                  const QMdnsEngine::Service& service)
         : m_Hostname(service.hostname()),
           m_Port(service.port()),
           m_ServerWeak(server),
+          m_CacheWeak(cache),
           m_Resolver(nullptr)
     {
+        m_SettleTimer.setSingleShot(true);
+        m_SettleTimer.setInterval(MDNS_RESOLVE_SETTLE_MS);
+        connect(&m_SettleTimer, &QTimer::timeout,
+                this, &MdnsPendingComputer::handleResolvedTimeout);
+
+        m_TimeoutTimer.setSingleShot(true);
+        m_TimeoutTimer.setInterval(MDNS_RESOLVE_TIMEOUT_MS);
+        connect(&m_TimeoutTimer, &QTimer::timeout,
+                this, &MdnsPendingComputer::handleResolvedTimeout);
+
         // Start resolving
         resolve();
     }
@@ -84,14 +104,30 @@ private slots:
         }
         else {
             Q_ASSERT(!m_Addresses.isEmpty());
+
+            // Only report the host once
+            m_SettleTimer.stop();
+            m_TimeoutTimer.stop();
+            cleanup();
+
             emit resolvedHost(this, m_Addresses);
         }
     }
 
     void handleResolvedAddress(const QHostAddress& address)
     {
+        if (m_Addresses.contains(address)) {
+            return;
+        }
+
         qInfo() << "Resolved" << hostname() << "to" << address;
         m_Addresses.push_back(address);
+
+        // Other records for this host usually arrive in the same response,
+        // so we don't need to wait for the full timeout to collect them.
+        if (!m_SettleTimer.isActive()) {
+            m_SettleTimer.start();
+        }
     }
 
 signals:
@@ -104,9 +140,10 @@ private:
         delete m_Resolver;
         m_Resolver = nullptr;
 
-        // Now delete our strong reference that we held on behalf of m_Resolver.
-        // The server may be destroyed after we make this call.
+        // Now delete our strong references that we held on behalf of m_Resolver.
+        // The server and cache may be destroyed after we make this call.
         m_Server.reset();
+        m_Cache.reset();
     }
 
     void resolve()
@@ -114,98 +151,67 @@ private:
         // Clean up any existing resolver object and server references
         cleanup();
 
-        // Re-acquire a strong reference if the server still exists.
+        // Re-acquire strong references if the server and cache still exist.
         m_Server = m_ServerWeak.toStrongRef();
-        if (!m_Server) {
+        m_Cache = m_CacheWeak.toStrongRef();
+        if (!m_Server || !m_Cache) {
             return;
         }
 
-        m_Resolver = new QMdnsEngine::Resolver(m_Server.data(), m_Hostname);
+        // The cache is shared with the browser and other pending computers, so
+        // addresses that came along with other responses are resolved right away.
+        // All resolvers also share the server's socket, so they run concurrently.
+        m_Resolver = new QMdnsEngine::Resolver(m_Server.data(), m_Hostname, m_Cache.data());
         connect(m_Resolver, &QMdnsEngine::Resolver::resolved,
                 this, &MdnsPendingComputer::handleResolvedAddress);
-        QTimer::singleShot(2000, this, &MdnsPendingComputer::handleResolvedTimeout);
+        m_TimeoutTimer.start();
     }
 
     QByteArray m_Hostname;
     uint16_t m_Port;
     QWeakPointer<QMdnsEngine::Server> m_ServerWeak;
     QSharedPointer<QMdnsEngine::Server> m_Server;
+    QWeakPointer<QMdnsEngine::Cache> m_CacheWeak;
+    QSharedPointer<QMdnsEngine::Cache> m_Cache;
+    QTimer m_SettleTimer;
+    QTimer m_TimeoutTimer;
     QMdnsEngine::Resolver* m_Resolver;
     QVector<QHostAddress> m_Addresses;
     int m_Retries = 10;
 };
 
-class ComputerPollingEntry
+// Remembers the addresses that mDNS hostnames resolved to, so hosts can be
+// added right away on the next launch while mDNS revalidates them.
+// This is only used on the main thread.
+class MdnsAddressCache
 {
 public:
-    ComputerPollingEntry()
-        : m_ActiveThread(nullptr)
-    {
+    struct Host {
+        QString hostname;
+        uint16_t port;
+        QVector<QHostAddress> addresses;
+    };
 
-    }
-
-    virtual ~ComputerPollingEntry()
-    {
-        interrupt();
+    MdnsAddressCache();
 
-        // interrupt() should have taken care of this
-        Q_ASSERT(m_ActiveThread == nullptr);
+    // Returns the hosts with unexpired entries
+    QVector<Host> getHosts() const;
 
-        for (QThread* thread : m_InactiveList) {
-            thread->wait();
-            delete thread;
-        }
-    }
-
-    bool isActive()
-    {
-        cleanInactiveList();
-
-        return m_ActiveThread != nullptr;
-    }
-
-    void setActiveThread(QThread* thread)
-    {
-        cleanInactiveList();
-
-        Q_ASSERT(!isActive());
-        m_ActiveThread = thread;
-    }
-
-    void interrupt()
-    {
-        cleanInactiveList();
-
-        if (m_ActiveThread != nullptr) {
-            // Interrupt the active thread
-            m_ActiveThread->requestInterruption();
-
-            // Place it on the inactive list awaiting death
-            m_InactiveList.append(m_ActiveThread);
-
-            m_ActiveThread = nullptr;
-        }
-    }
+    // Returns false if the port and addresses match the unexpired cached entry
+    bool update(const QString& hostname, uint16_t port, const QVector<QHostAddress>& addresses);
 
 private:
-    void cleanInactiveList()
-    {
-        QMutableListIterator<QThread*> i(m_InactiveList);
+    struct Entry {
+        uint16_t port;
+        QStringList addresses;
+        qint64 expirationTime;
+    };
 
-        // Reap any threads that have finished
-        while (i.hasNext()) {
-            i.next();
+    void save() const;
 
-            QThread* thread = i.value();
-            if (thread->isFinished()) {
-                delete thread;
-                i.remove();
-            }
-        }
-    }
+    static QStringList toSortedStringList(const QVector<QHostAddress>& addresses);
 
-    QThread* m_ActiveThread;
-    QList<QThread*> m_InactiveList;
+    QHash<QString, Entry> m_Entries;
 };
 
 class ComputerManager : public QObject
@@ -262,11 +268,13 @@ private slots:
     void handleMdnsServiceResolved(MdnsPendingComputer* computer, QVector<QHostAddress>& addresses);
 
 private:
+    void addMdnsHost(uint16_t port, const QVector<QHostAddress>& addresses);
+
     void saveHosts();
 
     void saveHost(NvComputer* computer);
 
-    QHostAddress getBestGlobalAddressV6(QVector<QHostAddress>& addresses);
+    QHostAddress getBestGlobalAddressV6(const QVector<QHostAddress>& addresses);
 
     void startPollingComputer(NvComputer* computer);
 
@@ -274,9 +282,12 @@ private:
     int m_PollingRef;
     QReadWriteLock m_Lock;
     QMap<QString, NvComputer*> m_KnownHosts;
-    QMap<QString, ComputerPollingEntry*> m_PollEntries;
+    ComputerPollScheduler* m_PollScheduler;
     QHash<QString, NvComputer> m_LastSerializedHosts; // Protected by m_DelayedFlushMutex
+    HostStore m_HostStore; // Only used by the delayed flush thread after construction
     QSharedPointer<QMdnsEngine::Server> m_MdnsServer;
+    QSharedPointer<QMdnsEngine::Cache> m_MdnsCache;
+    MdnsAddressCache m_MdnsAddressCache;
     QMdnsEngine::Browser* m_MdnsBrowser;
     QVector<MdnsPendingComputer*> m_PendingResolution;
     CompatFetcher m_CompatFetcher;
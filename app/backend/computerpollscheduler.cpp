@@ -0,0 +1,467 @@
+#include "computerpollscheduler.h"
+#include "nvhttp.h"
+
+#include <QDebug>
+
+#include <algorithm>
+
+#define TRIES_BEFORE_OFFLINING 2
+#define MAX_CONCURRENT_POLLS 8
+
+// Poll quickly for a few polls after a host changes state, since
+// it's likely still booting, starting a game, or quitting a game.
+#define FAST_POLLS_AFTER_CHANGE 3
+#define POLL_INTERVAL_FAST_MS 1000
+
+#define POLL_INTERVAL_ONLINE_MS 3000
+
+// Offline hosts back off exponentially from the online interval up to this
+#define POLL_INTERVAL_OFFLINE_MAX_MS 15000
+
+#define APPLIST_REFRESH_INTERVAL_MS 30000
+
+ComputerPollScheduler::ComputerPollScheduler()
+    : m_NextPollId(0),
+      m_PollsInFlight(0),
+      m_AppListFetches(0),
+      m_AppListNotModified(0),
+      m_AppListUnchanged(0)
+{
+    m_Thread.setObjectName("CM Poll Scheduler Thread");
+
+    m_Timer = new QTimer(this);
+    m_Timer->setSingleShot(true);
+    connect(m_Timer, &QTimer::timeout, this, &ComputerPollScheduler::dispatchPolls);
+
+    connect(this, &ComputerPollScheduler::pollingStartRequested,
+            this, &ComputerPollScheduler::handleStartPolling, Qt::QueuedConnection);
+    connect(this, &ComputerPollScheduler::pollingStopRequested,
+            this, &ComputerPollScheduler::handleStopPolling, Qt::QueuedConnection);
+    connect(this, &ComputerPollScheduler::computerRemovalRequested,
+            this, &ComputerPollScheduler::handleRemoveComputer, Qt::BlockingQueuedConnection);
+    connect(this, &ComputerPollScheduler::shutdownRequested,
+            this, &ComputerPollScheduler::handleShutdown, Qt::BlockingQueuedConnection);
+
+    m_Clock.start();
+
+    // All polling happens on our own thread, so slow NvComputer
+    // updates never stall the UI.
+    moveToThread(&m_Thread);
+    m_Thread.start();
+}
+
+ComputerPollScheduler::~ComputerPollScheduler()
+{
+    // Our NvHTTP objects belong to the polling thread, so they must be deleted there
+    emit shutdownRequested();
+
+    m_Thread.quit();
+    m_Thread.wait();
+}
+
+void ComputerPollScheduler::startPolling(NvComputer* computer)
+{
+    emit pollingStartRequested(computer);
+}
+
+void ComputerPollScheduler::stopPolling()
+{
+    emit pollingStopRequested();
+}
+
+void ComputerPollScheduler::removeComputer(NvComputer* computer)
+{
+    // This would deadlock if called on the polling thread
+    Q_ASSERT(QThread::currentThread() != &m_Thread);
+
+    emit computerRemovalRequested(computer);
+}
+
+void ComputerPollScheduler::handleStartPolling(NvComputer* computer)
+{
+    PollEntry* entry = m_Entries.value(computer);
+
+    if (entry == nullptr) {
+        entry = new PollEntry();
+        entry->computer = computer;
+        entry->active = false;
+        entry->inFlight = false;
+        entry->pollId = 0;
+        m_Entries.insert(computer, entry);
+    }
+
+    if (!entry->active) {
+        entry->active = true;
+
+        // Poll right away and always fetch the app list the first time
+        entry->nextPollTime = m_Clock.elapsed();
+        entry->lastAppListFetchTime = -1;
+        entry->stablePolls = 0;
+    }
+
+    dispatchPolls();
+}
+
+void ComputerPollScheduler::handleStopPolling()
+{
+    for (PollEntry* entry : m_Entries) {
+        entry->active = false;
+
+        // Cancel any serverinfo request in flight. The poll finishes
+        // when its callback sees that polling has stopped.
+        if (entry->serverInfoRequest) {
+            entry->serverInfoRequest->abort();
+        }
+    }
+
+    m_Timer->stop();
+
+    if (m_AppListFetches > 0) {
+        qInfo().nospace() << "App list sync: " << m_AppListFetches << " fetches, "
+                          << m_AppListNotModified << " not modified, "
+                          << m_AppListUnchanged << " unchanged";
+    }
+}
+
+void ComputerPollScheduler::handleRemoveComputer(NvComputer* computer)
+{
+    PollEntry* entry = m_Entries.take(computer);
+    if (entry == nullptr) {
+        return;
+    }
+
+    // Any response to a request in flight will be dropped when
+    // findEntry() fails to find this poll.
+    if (entry->inFlight) {
+        m_PollsInFlight--;
+        scheduleDispatch();
+    }
+
+    deleteEntry(entry);
+}
+
+void ComputerPollScheduler::handleShutdown()
+{
+    m_Timer->stop();
+
+    // Clear the entries first, so callbacks of the requests aborted
+    // by deleteEntry() don't find them.
+    QHash<NvComputer*, PollEntry*> entries;
+    entries.swap(m_Entries);
+    for (PollEntry* entry : entries) {
+        deleteEntry(entry);
+    }
+    m_PollsInFlight = 0;
+}
+
+void ComputerPollScheduler::deleteEntry(PollEntry* entry)
+{
+    if (entry->serverInfoRequest) {
+        entry->serverInfoRequest->abort();
+    }
+
+    qDeleteAll(entry->httpClients);
+    delete entry;
+}
+
+void ComputerPollScheduler::scheduleDispatch()
+{
+    // Dispatch from the event loop rather than recursing
+    // into dispatchPolls() from a poll completion.
+    QMetaObject::invokeMethod(this, "dispatchPolls", Qt::QueuedConnection);
+}
+
+void ComputerPollScheduler::dispatchPolls()
+{
+    qint64 now = m_Clock.elapsed();
+    qint64 nextPollTime = -1;
+    QVector<PollEntry*> duePolls;
+
+    for (PollEntry* entry : m_Entries) {
+        if (!entry->active || entry->inFlight) {
+            continue;
+        }
+
+        if (entry->nextPollTime <= now) {
+            duePolls.append(entry);
+        }
+        else if (nextPollTime < 0 || entry->nextPollTime < nextPollTime) {
+            nextPollTime = entry->nextPollTime;
+        }
+    }
+
+    // Start the most overdue polls first. Any that don't fit under the
+    // concurrency limit will be dispatched when a poll completes.
+    std::sort(duePolls.begin(), duePolls.end(), [](const PollEntry* entry1, const PollEntry* entry2) {
+        return entry1->nextPollTime < entry2->nextPollTime;
+    });
+    for (PollEntry* entry : duePolls) {
+        if (m_PollsInFlight >= MAX_CONCURRENT_POLLS) {
+            break;
+        }
+
+        beginPoll(entry);
+    }
+
+    if (nextPollTime >= 0) {
+        m_Timer->start((int)(nextPollTime - now));
+    }
+    else {
+        m_Timer->stop();
+    }
+}
+
+void ComputerPollScheduler::beginPoll(PollEntry* entry)
+{
+    Q_ASSERT(!entry->inFlight);
+
+    entry->inFlight = true;
+    m_PollsInFlight++;
+
+    // Responses to previous polls are ignored once the ID changes
+    entry->pollId = ++m_NextPollId;
+
+    // This poll is stable unless we see a change below
+    entry->stablePolls++;
+
+    entry->wasOnline = entry->computer->state == NvComputer::CS_ONLINE;
+    entry->triesLeft = entry->wasOnline ? TRIES_BEFORE_OFFLINING : 1;
+    entry->addresses = entry->computer->uniqueAddresses();
+    entry->addressIndex = 0;
+    entry->stateChanged = false;
+
+    pollNextAddress(entry);
+}
+
+void ComputerPollScheduler::pollNextAddress(PollEntry* entry)
+{
+    // Don't start any new requests if polling was stopped
+    if (!entry->active) {
+        finishPoll(entry);
+        return;
+    }
+
+    if (entry->addressIndex >= entry->addresses.count()) {
+        if (--entry->triesLeft > 0 && !entry->addresses.isEmpty()) {
+            // Try all addresses again
+            entry->addressIndex = 0;
+        }
+        else {
+            finishServerInfoPolling(entry, false);
+            return;
+        }
+    }
+
+    NvHTTP* http = getHttpForAddress(entry, entry->addresses[entry->addressIndex]);
+    bool reuseConnection = entry->computer->supportsConnectionReuse();
+
+    http->setConnectionReuse(reuseConnection);
+    http->setServerCert(entry->computer->serverCert);
+    if (!reuseConnection) {
+        // Rediscover the HTTPS port over HTTP on each poll
+        http->setHttpsPort(0);
+    }
+
+    NvComputer* computer = entry->computer;
+    quint64 pollId = entry->pollId;
+    entry->serverInfoRequest = http->getServerInfoAsync(NvHTTP::NvLogLevel::NVLL_NONE, true,
+                                                        [this, computer, pollId, http](const QString& serverInfo, std::exception_ptr error) {
+        // The computer may have been removed while this request was in flight
+        PollEntry* entry = findEntry(computer, pollId);
+        if (entry == nullptr) {
+            return;
+        }
+
+        entry->serverInfoRequest.reset();
+
+        if (error) {
+            // The HTTPS port may have changed
+            http->setHttpsPort(0);
+
+            entry->addressIndex++;
+            pollNextAddress(entry);
+            return;
+        }
+
+        handleServerInfo(entry, http, serverInfo);
+    });
+}
+
+void ComputerPollScheduler::handleServerInfo(PollEntry* entry, NvHTTP* http, QString serverInfo)
+{
+    NvComputer newState(*http, serverInfo);
+
+    // Ensure the machine that responded is the one we intended to contact
+    if (entry->computer->uuid != newState.uuid) {
+        qInfo() << "Found unexpected PC" << newState.name << "looking for" << entry->computer->name;
+
+        entry->addressIndex++;
+        pollNextAddress(entry);
+        return;
+    }
+
+    if (entry->computer->update(newState)) {
+        entry->stateChanged = true;
+        entry->stablePolls = 0;
+    }
+
+    if (!entry->wasOnline) {
+        qInfo() << entry->computer->name << "is now online at" << entry->computer->activeAddress.toString();
+    }
+
+    finishServerInfoPolling(entry, true);
+}
+
+void ComputerPollScheduler::finishServerInfoPolling(PollEntry* entry, bool online)
+{
+    NvComputer* computer = entry->computer;
+
+    // Check if we failed after all retry attempts
+    // Note: we don't need to acquire the read lock here,
+    // because we're on the writing thread.
+    if (!online && computer->state != NvComputer::CS_OFFLINE) {
+        qInfo() << computer->name << "is now offline";
+        computer->state = NvComputer::CS_OFFLINE;
+        entry->stateChanged = true;
+        entry->stablePolls = 0;
+    }
+
+    // Grab the applist if it's empty or it's been long enough that we need to refresh
+    qint64 now = m_Clock.elapsed();
+    if (entry->active &&
+            computer->state == NvComputer::CS_ONLINE &&
+            computer->pairState == NvComputer::PS_PAIRED &&
+            (computer->appList.isEmpty() ||
+             entry->lastAppListFetchTime < 0 ||
+             now - entry->lastAppListFetchTime >= APPLIST_REFRESH_INTERVAL_MS)) {
+        // Notify prior to the app list poll since it may take a while, and we don't
+        // want to delay onlining of a machine, especially if we already have a cached list.
+        if (entry->stateChanged) {
+            emit computerStateChanged(computer);
+            entry->stateChanged = false;
+        }
+
+        NvHTTP* http = getHttpForAddress(entry, computer->activeAddress);
+        http->setConnectionReuse(entry->computer->supportsConnectionReuse());
+        http->setServerCert(computer->serverCert);
+        http->setHttpsPort(computer->activeHttpsPort);
+
+        // We can't skip the app list if we don't have one
+        if (computer->appList.isEmpty()) {
+            entry->appListFingerprint = NvAppListFingerprint();
+        }
+
+        quint64 pollId = entry->pollId;
+        http->getAppListIfChangedAsync(entry->appListFingerprint,
+                                       [this, computer, pollId](NvHTTP::AppListSyncResult result,
+                                                                const QVector<NvApp>& appList,
+                                                                const NvAppListFingerprint& fingerprint,
+                                                                std::exception_ptr error) {
+            PollEntry* entry = findEntry(computer, pollId);
+            if (entry == nullptr) {
+                return;
+            }
+
+            if (!error) {
+                handleAppList(entry, result, appList, fingerprint);
+            }
+
+            finishPoll(entry);
+        });
+        return;
+    }
+
+    finishPoll(entry);
+}
+
+void ComputerPollScheduler::handleAppList(PollEntry* entry,
+                                          NvHTTP::AppListSyncResult result,
+                                          const QVector<NvApp>& appList,
+                                          const NvAppListFingerprint& fingerprint)
+{
+    m_AppListFetches++;
+
+    switch (result) {
+    case NvHTTP::AppListSyncResult::NotModified:
+        m_AppListNotModified++;
+        entry->lastAppListFetchTime = m_Clock.elapsed();
+        return;
+
+    case NvHTTP::AppListSyncResult::Unchanged:
+        m_AppListUnchanged++;
+        entry->appListFingerprint = fingerprint;
+        entry->lastAppListFetchTime = m_Clock.elapsed();
+        return;
+
+    case NvHTTP::AppListSyncResult::Changed:
+        if (appList.isEmpty()) {
+            // Retry on the next poll
+            return;
+        }
+        break;
+    }
+
+    entry->appListFingerprint = fingerprint;
+    entry->lastAppListFetchTime = m_Clock.elapsed();
+
+    QWriteLocker lock(&entry->computer->lock);
+    if (entry->computer->updateAppList(appList)) {
+        entry->stateChanged = true;
+    }
+}
+
+void ComputerPollScheduler::finishPoll(PollEntry* entry)
+{
+    if (entry->stateChanged) {
+        // Tell anyone listening that we've changed state
+        emit computerStateChanged(entry->computer);
+    }
+
+    entry->inFlight = false;
+    entry->nextPollTime = m_Clock.elapsed() + getPollInterval(entry);
+    m_PollsInFlight--;
+
+    scheduleDispatch();
+}
+
+int ComputerPollScheduler::getPollInterval(PollEntry* entry)
+{
+    NvComputer* computer = entry->computer;
+
+    if (computer->pendingQuit || entry->stablePolls < FAST_POLLS_AFTER_CHANGE) {
+        return POLL_INTERVAL_FAST_MS;
+    }
+    else if (computer->state == NvComputer::CS_ONLINE) {
+        return POLL_INTERVAL_ONLINE_MS;
+    }
+    else {
+        // Back off while the host stays offline
+        int backoffShift = qMin(entry->stablePolls - FAST_POLLS_AFTER_CHANGE, 4);
+        return qMin(POLL_INTERVAL_ONLINE_MS << backoffShift, POLL_INTERVAL_OFFLINE_MAX_MS);
+    }
+}
+
+ComputerPollScheduler::PollEntry* ComputerPollScheduler::findEntry(NvComputer* computer, quint64 pollId)
+{
+    PollEntry* entry = m_Entries.value(computer);
+    if (entry == nullptr || entry->pollId != pollId || !entry->inFlight) {
+        return nullptr;
+    }
+
+    return entry;
+}
+
+NvHTTP* ComputerPollScheduler::getHttpForAddress(PollEntry* entry, const NvAddress& address)
+{
+    // Each address gets its own NvHTTP object, so kept-alive
+    // connections survive when we poll more than one address.
+    for (NvHTTP* http : entry->httpClients) {
+        if (http->address() == address) {
+            return http;
+        }
+    }
+
+    NvHTTP* http = new NvHTTP(address, 0, entry->computer->serverCert);
+    entry->httpClients.append(http);
+    return http;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "nvcomputer.h"
+#include "nvhttp.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+
+// Polls all known hosts from a single thread using the asynchronous
+// NvHTTP API. Each host is polled on its own adaptive interval: quickly
+// while its state is changing, at the normal rate while it's stable and
+// online, and with increasing backoff while it stays offline. At most
+// MAX_CONCURRENT_POLLS polls are in flight at once.
+//
+// The public methods may be called from any thread.
+class ComputerPollScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    ComputerPollScheduler();
+
+    virtual ~ComputerPollScheduler();
+
+    // Starts polling immediately if this computer isn't being polled already
+    void startPolling(NvComputer* computer);
+
+    // Stops polling all computers without waiting for requests in flight
+    void stopPolling();
+
+    // Blocks until the scheduler no longer references this computer
+    void removeComputer(NvComputer* computer);
+
+signals:
+    void computerStateChanged(NvComputer* computer);
+
+    // Internal requests to marshal calls onto the polling thread
+    void pollingStartRequested(NvComputer* computer);
+    void pollingStopRequested();
+    void computerRemovalRequested(NvComputer* computer);
+    void shutdownRequested();
+
+private slots:
+    void handleStartPolling(NvComputer* computer);
+
+    void handleStopPolling();
+
+    void handleRemoveComputer(NvComputer* computer);
+
+    void handleShutdown();
+
+    void dispatchPolls();
+
+private:
+    struct PollEntry {
+        NvComputer* computer;
+        QVector<NvHTTP*> httpClients;
+
+        bool active;
+        bool inFlight;
+        quint64 pollId;
+        qint64 nextPollTime;
+        qint64 lastAppListFetchTime;
+        NvAppListFingerprint appListFingerprint;
+
+        // Number of consecutive polls that didn't change anything
+        int stablePolls;
+
+        // State for the poll in progress
+        NvRequestHandle serverInfoRequest;
+        QVector<NvAddress> addresses;
+        int addressIndex;
+        int triesLeft;
+        bool wasOnline;
+        bool stateChanged;
+    };
+
+    void beginPoll(PollEntry* entry);
+
+    void pollNextAddress(PollEntry* entry);
+
+    void handleServerInfo(PollEntry* entry, NvHTTP* http, QString serverInfo);
+
+    void finishServerInfoPolling(PollEntry* entry, bool online);
+
+    void handleAppList(PollEntry* entry,
+                       NvHTTP::AppListSyncResult result,
+                       const QVector<NvApp>& appList,
+                       const NvAppListFingerprint& fingerprint);
+
+    void finishPoll(PollEntry* entry);
+
+    void scheduleDispatch();
+
+    int getPollInterval(PollEntry* entry);
+
+    PollEntry* findEntry(NvComputer* computer, quint64 pollId);
+
+    NvHTTP* getHttpForAddress(PollEntry* entry, const NvAddress& address);
+
+    void deleteEntry(PollEntry* entry);
+
+    QThread m_Thread;
+    QTimer* m_Timer;
+    QElapsedTimer m_Clock;
+    QHash<NvComputer*, PollEntry*> m_Entries;
+    quint64 m_NextPollId;
+    int m_PollsInFlight;
+
+    // Counters for how often app list parsing is skipped
+    int m_AppListFetches;
+    int m_AppListNotModified;
+    int m_AppListUnchanged;
+};
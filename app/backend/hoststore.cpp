@@ -0,0 +1,332 @@
+#include "hoststore.h"
+#include "../path.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#define SNAPSHOT_FILE_NAME "hosts.db"
+#define JOURNAL_FILE_NAME "hosts.journal"
+
+#define SNAPSHOT_MAGIC 0x4D4C4853 // 'MLHS'
+#define JOURNAL_MAGIC 0x4D4C484A // 'MLHJ'
+#define STORE_FORMAT_VERSION 1
+#define STREAM_VERSION QDataStream::Qt_5_9
+
+// Length and checksum preceding each journal record
+#define JOURNAL_RECORD_HEADER_SIZE 6
+
+// The journal is compacted once it's larger than the snapshot or this size
+#define MIN_JOURNAL_COMPACTION_SIZE (256 * 1024)
+
+HostStore::HostStore()
+    : m_JournalSize(0),
+      m_SnapshotSize(0)
+{
+    QDir dataDir(Path::getDataDir());
+
+    m_SnapshotPath = dataDir.absoluteFilePath(SNAPSHOT_FILE_NAME);
+    m_JournalPath = dataDir.absoluteFilePath(JOURNAL_FILE_NAME);
+    m_JournalFile.setFileName(m_JournalPath);
+}
+
+HostStore::~HostStore()
+{
+    commit();
+}
+
+quint16 HostStore::checksum(const QByteArray& data)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return qChecksum(data);
+#else
+    return qChecksum(data.constData(), data.size());
+#endif
+}
+
+bool HostStore::load(QVector<NvComputer*>& hosts)
+{
+    if (!QFile::exists(m_SnapshotPath) && !QFile::exists(m_JournalPath)) {
+        return false;
+    }
+
+    bool snapshotValid = loadSnapshot();
+    int replayedRecords = replayJournal();
+
+    if (!snapshotValid && replayedRecords == 0 && QFile::exists(m_SnapshotPath)) {
+        // The snapshot is corrupt and the journal doesn't hold anything to
+        // recover from it, so let the caller migrate from QSettings again
+        // rather than starting with no hosts.
+        qWarning() << "Host database is unusable; falling back to migration";
+        m_Records.clear();
+        return false;
+    }
+
+    for (const QByteArray& record : m_Records) {
+        QDataStream stream(record);
+        stream.setVersion(STREAM_VERSION);
+
+        NvComputer* computer = new NvComputer(stream);
+        if (stream.status() != QDataStream::Ok || computer->uuid.isEmpty()) {
+            qWarning() << "Skipping unreadable host record";
+            delete computer;
+            continue;
+        }
+
+        hosts.append(computer);
+    }
+
+    // Fold a large journal into the snapshot before we start appending to it
+    if (m_JournalSize > qMax((qint64)MIN_JOURNAL_COMPACTION_SIZE, m_SnapshotSize)) {
+        compact();
+    }
+
+    return true;
+}
+
+bool HostStore::loadSnapshot()
+{
+    QFile file(m_SnapshotPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    m_SnapshotSize = file.size();
+
+    QDataStream stream(&file);
+    stream.setVersion(STREAM_VERSION);
+
+    quint32 magic, version, count;
+    stream >> magic >> version >> count;
+    if (stream.status() != QDataStream::Ok || magic != SNAPSHOT_MAGIC || version != STORE_FORMAT_VERSION) {
+        qWarning() << "Ignoring unrecognized host database:" << m_SnapshotPath;
+        return false;
+    }
+
+    for (quint32 i = 0; i < count; i++) {
+        QString uuid;
+        QByteArray record;
+
+        stream >> uuid >> record;
+        if (stream.status() != QDataStream::Ok) {
+            // The snapshot is written atomically, so this shouldn't happen
+            qWarning() << "Host database is truncated:" << m_SnapshotPath;
+            return false;
+        }
+
+        m_Records[uuid] = record;
+    }
+
+    return true;
+}
+
+int HostStore::replayJournal()
+{
+    QFile file(m_JournalPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    QByteArray journal = file.readAll();
+    file.close();
+
+    QDataStream stream(journal);
+    stream.setVersion(STREAM_VERSION);
+
+    quint32 magic, version;
+    stream >> magic >> version;
+    if (stream.status() != QDataStream::Ok || magic != JOURNAL_MAGIC || version != STORE_FORMAT_VERSION) {
+        qWarning() << "Ignoring unrecognized host journal:" << m_JournalPath;
+        QFile::remove(m_JournalPath);
+        return 0;
+    }
+
+    int offset = (int)stream.device()->pos();
+    int replayedRecords = 0;
+
+    while (offset + JOURNAL_RECORD_HEADER_SIZE <= journal.size()) {
+        quint32 length;
+        quint16 recordChecksum;
+        stream >> length >> recordChecksum;
+
+        if (length > (quint32)(journal.size() - offset - JOURNAL_RECORD_HEADER_SIZE)) {
+            // We were interrupted while appending this record
+            break;
+        }
+
+        QByteArray payload = journal.mid(offset + JOURNAL_RECORD_HEADER_SIZE, length);
+        if (checksum(payload) != recordChecksum) {
+            break;
+        }
+
+        QDataStream payloadStream(payload);
+        payloadStream.setVersion(STREAM_VERSION);
+
+        quint8 type;
+        QString uuid;
+        QByteArray data;
+        payloadStream >> type >> uuid >> data;
+        if (payloadStream.status() != QDataStream::Ok) {
+            break;
+        }
+
+        switch (type) {
+        case RT_PUT:
+            m_Records[uuid] = data;
+            break;
+        case RT_REMOVE:
+            m_Records.remove(uuid);
+            break;
+        default:
+            qWarning() << "Skipping unknown host journal record:" << type;
+            break;
+        }
+
+        offset += JOURNAL_RECORD_HEADER_SIZE + length;
+        stream.skipRawData(length);
+        replayedRecords++;
+    }
+
+    if (offset != journal.size()) {
+        // Drop the partial record so new records are appended after the last good one
+        qWarning() << "Discarding" << journal.size() - offset << "bytes of incomplete host journal records";
+        QFile::resize(m_JournalPath, offset);
+    }
+
+    m_JournalSize = offset;
+
+    qInfo() << "Replayed" << replayedRecords << "host journal records";
+    return replayedRecords;
+}
+
+void HostStore::putHost(const NvComputer& computer)
+{
+    QByteArray record;
+    {
+        QDataStream stream(&record, QIODevice::WriteOnly);
+        stream.setVersion(STREAM_VERSION);
+        computer.serialize(stream);
+    }
+
+    // Don't journal records that haven't changed
+    auto it = m_Records.find(computer.uuid);
+    if (it != m_Records.end() && *it == record) {
+        return;
+    }
+
+    m_Records[computer.uuid] = record;
+    appendJournalRecord(RT_PUT, computer.uuid, record);
+}
+
+void HostStore::removeHost(const QString& uuid)
+{
+    if (m_Records.remove(uuid) != 0) {
+        appendJournalRecord(RT_REMOVE, uuid, QByteArray());
+    }
+}
+
+void HostStore::appendJournalRecord(RecordType type, const QString& uuid, const QByteArray& data)
+{
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(STREAM_VERSION);
+        stream << (quint8)type << uuid << data;
+    }
+
+    QDataStream stream(&m_PendingJournal, QIODevice::WriteOnly | QIODevice::Append);
+    stream.setVersion(STREAM_VERSION);
+    stream << (quint32)payload.size() << checksum(payload);
+    stream.writeRawData(payload.constData(), payload.size());
+}
+
+bool HostStore::commit()
+{
+    if (m_PendingJournal.isEmpty()) {
+        return true;
+    }
+
+    // Compact instead if the journal would grow too large
+    if (m_JournalSize + m_PendingJournal.size() > qMax((qint64)MIN_JOURNAL_COMPACTION_SIZE, m_SnapshotSize)) {
+        return compact();
+    }
+
+    if (!m_JournalFile.isOpen()) {
+        QDir().mkpath(Path::getDataDir());
+
+        if (!m_JournalFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            qWarning() << "Failed to open host journal:" << m_JournalFile.errorString();
+            return false;
+        }
+
+        if (m_JournalFile.size() == 0) {
+            QDataStream stream(&m_JournalFile);
+            stream.setVersion(STREAM_VERSION);
+            stream << (quint32)JOURNAL_MAGIC << (quint32)STORE_FORMAT_VERSION;
+        }
+
+        m_JournalSize = m_JournalFile.size();
+    }
+
+    if (m_JournalFile.write(m_PendingJournal) != m_PendingJournal.size() || !m_JournalFile.flush()) {
+        qWarning() << "Failed to write host journal:" << m_JournalFile.errorString();
+
+        // Rewrite everything rather than leave a hole in the journal
+        m_JournalFile.close();
+        return compact();
+    }
+
+    m_JournalSize += m_PendingJournal.size();
+    m_PendingJournal.clear();
+    return true;
+}
+
+bool HostStore::compact()
+{
+    QDir().mkpath(Path::getDataDir());
+
+    // QSaveFile replaces the old snapshot atomically, so we can't be
+    // left without a valid snapshot if we're interrupted.
+    QSaveFile file(m_SnapshotPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open host database:" << file.errorString();
+        return false;
+    }
+
+    {
+        QDataStream stream(&file);
+        stream.setVersion(STREAM_VERSION);
+
+        stream << (quint32)SNAPSHOT_MAGIC << (quint32)STORE_FORMAT_VERSION << (quint32)m_Records.count();
+        for (auto it = m_Records.constBegin(); it != m_Records.constEnd(); ++it) {
+            stream << it.key() << it.value();
+        }
+    }
+
+    if (!file.commit()) {
+        qWarning() << "Failed to write host database:" << file.errorString();
+        return false;
+    }
+
+    m_SnapshotSize = QFileInfo(m_SnapshotPath).size();
+
+    // Everything in the journal is now in the snapshot. Replaying the old
+    // journal if we're interrupted before truncating it is harmless since
+    // it holds full records that were applied in order.
+    m_PendingJournal.clear();
+    m_JournalFile.close();
+    if (!m_JournalFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Failed to reset host journal:" << m_JournalFile.errorString();
+        return false;
+    }
+
+    QDataStream stream(&m_JournalFile);
+    stream.setVersion(STREAM_VERSION);
+    stream << (quint32)JOURNAL_MAGIC << (quint32)STORE_FORMAT_VERSION;
+    m_JournalFile.flush();
+    m_JournalSize = m_JournalFile.size();
+
+    qInfo() << "Compacted host database with" << m_Records.count() << "hosts";
+    return true;
+}
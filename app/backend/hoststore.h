@@ -0,0 +1,64 @@
+#pragma once
+
+#include "nvcomputer.h"
+
+#include <QFile>
+#include <QHash>
+
+// Persists known hosts in a binary database made of a snapshot file holding
+// one record per host and an append-only journal of changes to it. Saving
+// a change to one host only appends that host's record to the journal, so
+// the cost doesn't scale with the number of hosts or the size of their app
+// lists. The journal is folded back into the snapshot once it grows large.
+//
+// HostStore is not thread-safe. ComputerManager only uses it from the
+// delayed flush thread after loading it at startup.
+class HostStore
+{
+public:
+    HostStore();
+
+    ~HostStore();
+
+    // Returns false if there's no host database yet
+    bool load(QVector<NvComputer*>& hosts);
+
+    // Caller is responsible for synchronizing read access to the host
+    void putHost(const NvComputer& computer);
+
+    void removeHost(const QString& uuid);
+
+    // Writes the changes since the last commit to disk
+    bool commit();
+
+    // Rewrites the snapshot with the current host records and empties the journal
+    bool compact();
+
+private:
+    enum RecordType : quint8
+    {
+        RT_PUT = 1,
+        RT_REMOVE = 2,
+    };
+
+    bool loadSnapshot();
+
+    // Returns the number of journal records replayed
+    int replayJournal();
+
+    void appendJournalRecord(RecordType type, const QString& uuid, const QByteArray& data);
+
+    static quint16 checksum(const QByteArray& data);
+
+    QString m_SnapshotPath;
+    QString m_JournalPath;
+    QFile m_JournalFile;
+
+    // Serialized records for all hosts, keyed by UUID
+    QHash<QString, QByteArray> m_Records;
+
+    // Journal records waiting to be committed
+    QByteArray m_PendingJournal;
+    qint64 m_JournalSize;
+    qint64 m_SnapshotSize;
+};
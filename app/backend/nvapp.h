@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QDataStream>
 #include <QSettings>
 
 class NvApp
@@ -7,6 +8,7 @@ class NvApp
 public:
     NvApp() {}
     explicit NvApp(QSettings& settings);
+    explicit NvApp(QDataStream& stream);
 
     bool operator==(const NvApp& other) const
     {
@@ -29,7 +31,7 @@ public:
     }
 
     void
-    serialize(QSettings& settings) const;
+    serialize(QDataStream& stream) const;
 
     int id = 0;
     QString name;
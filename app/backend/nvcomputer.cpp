@@ -23,6 +23,9 @@
 #define SER_CUSTOMNAME "customname"
 #define SER_NVIDIASOFTWARE "nvidiasw"
 
+// Bump this when changing the binary host record format
+#define HOST_RECORD_VERSION 1
+
 NvComputer::NvComputer(QSettings& settings)
 {
     this->name = settings.value(SER_NAME).toString();
@@ -51,6 +54,44 @@ NvComputer::NvComputer(QSettings& settings)
     settings.endArray();
     sortAppList();
 
+    initializeEphemeralTraits();
+}
+
+NvComputer::NvComputer(QDataStream& stream)
+{
+    quint8 version;
+    QString localAddr, remoteAddr, ipv6Addr, manualAddr;
+    quint16 localPort, remotePort, ipv6Port, manualPort;
+    QByteArray serverCertPem;
+    quint32 appCount;
+
+    stream >> version;
+    if (version != HOST_RECORD_VERSION) {
+        stream.setStatus(QDataStream::ReadCorruptData);
+        return;
+    }
+
+    stream >> this->name >> this->hasCustomName >> this->uuid >> this->macAddress
+           >> localAddr >> localPort >> remoteAddr >> remotePort
+           >> ipv6Addr >> ipv6Port >> manualAddr >> manualPort
+           >> serverCertPem >> this->isNvidiaServerSoftware >> appCount;
+
+    this->localAddress = NvAddress(localAddr, localPort);
+    this->remoteAddress = NvAddress(remoteAddr, remotePort);
+    this->ipv6Address = NvAddress(ipv6Addr, ipv6Port);
+    this->manualAddress = NvAddress(manualAddr, manualPort);
+    this->serverCert = QSslCertificate(serverCertPem);
+
+    for (quint32 i = 0; i < appCount && stream.status() == QDataStream::Ok; i++) {
+        this->appList.append(NvApp(stream));
+    }
+    sortAppList();
+
+    initializeEphemeralTraits();
+}
+
+void NvComputer::initializeEphemeralTraits()
+{
     this->currentGameId = 0;
     this->pairState = PS_UNKNOWN;
     this->state = CS_UNKNOWN;
@@ -74,34 +115,19 @@ void NvComputer::setRemoteAddress(QHostAddress address)
     this->remoteAddress = NvAddress(address, this->externalPort);
 }
 
-void NvComputer::serialize(QSettings& settings, bool serializeApps) const
+void NvComputer::serialize(QDataStream& stream) const
 {
-    QReadLocker lock(&this->lock);
-
-    settings.setValue(SER_NAME, name);
-    settings.setValue(SER_CUSTOMNAME, hasCustomName);
-    settings.setValue(SER_UUID, uuid);
-    settings.setValue(SER_MAC, macAddress);
-    settings.setValue(SER_LOCALADDR, localAddress.address());
-    settings.setValue(SER_LOCALPORT, localAddress.port());
-    settings.setValue(SER_REMOTEADDR, remoteAddress.address());
-    settings.setValue(SER_REMOTEPORT, remoteAddress.port());
-    settings.setValue(SER_IPV6ADDR, ipv6Address.address());
-    settings.setValue(SER_IPV6PORT, ipv6Address.port());
-    settings.setValue(SER_MANUALADDR, manualAddress.address());
-    settings.setValue(SER_MANUALPORT, manualAddress.port());
-    settings.setValue(SER_SRVCERT, serverCert.toPem());
-    settings.setValue(SER_NVIDIASOFTWARE, isNvidiaServerSoftware);
-
-    // Avoid deleting an existing applist if we couldn't get one
-    if (!appList.isEmpty() && serializeApps) {
-        settings.remove(SER_APPLIST);
-        settings.beginWriteArray(SER_APPLIST);
-        for (int i = 0; i < appList.count(); i++) {
-            settings.setArrayIndex(i);
-            appList[i].serialize(settings);
-        }
-        settings.endArray();
+    stream << (quint8)HOST_RECORD_VERSION
+           << name << hasCustomName << uuid << macAddress
+           << localAddress.address() << localAddress.port()
+           << remoteAddress.address() << remoteAddress.port()
+           << ipv6Address.address() << ipv6Address.port()
+           << manualAddress.address() << manualAddress.port()
+           << serverCert.toPem() << isNvidiaServerSoftware
+           << (quint32)appList.count();
+
+    for (const NvApp& app : appList) {
+        app.serialize(stream);
     }
 }
 
@@ -129,16 +155,19 @@ void NvComputer::sortAppList()
 
 NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
 {
+    // Parse the response once rather than scanning it again for each field
+    NvXmlFields serverInfoFields(serverInfo);
+
     this->serverCert = http.serverCert();
 
     this->hasCustomName = false;
-    this->name = NvHTTP::getXmlString(serverInfo, "hostname");
+    this->name = serverInfoFields.value("hostname");
     if (this->name.isEmpty()) {
         this->name = "UNKNOWN";
     }
 
-    this->uuid = NvHTTP::getXmlString(serverInfo, "uniqueid");
-    QString newMacString = NvHTTP::getXmlString(serverInfo, "mac");
+    this->uuid = serverInfoFields.value("uniqueid");
+    QString newMacString = serverInfoFields.value("mac");
     if (newMacString != "00:00:00:00:00:00") {
         QStringList macOctets = newMacString.split(':');
         for (const QString& macOctet : macOctets) {
@@ -146,7 +175,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
         }
     }
 
-    QString codecSupport = NvHTTP::getXmlString(serverInfo, "ServerCodecModeSupport");
+    QString codecSupport = serverInfoFields.value("ServerCodecModeSupport");
     if (!codecSupport.isEmpty()) {
         this->serverCodecModeSupport = codecSupport.toInt();
     }
@@ -155,7 +184,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
         this->serverCodecModeSupport = SCM_H264;
     }
 
-    QString maxLumaPixelsHEVC = NvHTTP::getXmlString(serverInfo, "MaxLumaPixelsHEVC");
+    QString maxLumaPixelsHEVC = serverInfoFields.value("MaxLumaPixelsHEVC");
     if (!maxLumaPixelsHEVC.isEmpty()) {
         this->maxLumaPixelsHEVC = maxLumaPixelsHEVC.toInt();
     }
@@ -163,7 +192,7 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
         this->maxLumaPixelsHEVC = 0;
     }
 
-    this->displayModes = NvHTTP::getDisplayModeList(serverInfo);
+    this->displayModes = serverInfoFields.displayModes();
     std::stable_sort(this->displayModes.begin(), this->displayModes.end(),
                      [](const NvDisplayMode& mode1, const NvDisplayMode& mode2) {
         return (uint64_t)mode1.width * mode1.height * mode1.refreshRate <
@@ -171,24 +200,24 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
     });
 
     // We can get an IPv4 loopback address if we're using the GS IPv6 Forwarder
-    this->localAddress = NvAddress(NvHTTP::getXmlString(serverInfo, "LocalIP"), http.httpPort());
+    this->localAddress = NvAddress(serverInfoFields.value("LocalIP"), http.httpPort());
     if (this->localAddress.address().startsWith("127.")) {
         this->localAddress = NvAddress();
     }
 
-    QString httpsPort = NvHTTP::getXmlString(serverInfo, "HttpsPort");
+    QString httpsPort = serverInfoFields.value("HttpsPort");
     if (httpsPort.isEmpty() || (this->activeHttpsPort = httpsPort.toUShort()) == 0) {
         this->activeHttpsPort = DEFAULT_HTTPS_PORT;
     }
 
     // This is an extension which is not present in GFE. It is present for Sunshine to be able
     // to support dynamic HTTP WAN ports without requiring the user to manually enter the port.
-    QString remotePortStr = NvHTTP::getXmlString(serverInfo, "ExternalPort");
+    QString remotePortStr = serverInfoFields.value("ExternalPort");
     if (remotePortStr.isEmpty() || (this->externalPort = remotePortStr.toUShort()) == 0) {
         this->externalPort = http.httpPort();
     }
 
-    QString remoteAddress = NvHTTP::getXmlString(serverInfo, "ExternalIP");
+    QString remoteAddress = serverInfoFields.value("ExternalIP");
     if (!remoteAddress.isEmpty()) {
         this->remoteAddress = NvAddress(remoteAddress, this->externalPort);
     }
@@ -199,14 +228,14 @@ NvComputer::NvComputer(NvHTTP& http, QString serverInfo)
     // Real Nvidia host software (GeForce Experience and RTX Experience) both use the 'Mjolnir'
     // codename in the state field and no version of Sunshine does. We can use this to bypass
     // some assumptions about Nvidia hardware that don't apply to Sunshine hosts.
-    this->isNvidiaServerSoftware = NvHTTP::getXmlString(serverInfo, "state").contains("MJOLNIR");
+    this->isNvidiaServerSoftware = serverInfoFields.value("state").contains("MJOLNIR");
 
-    this->pairState = NvHTTP::getXmlString(serverInfo, "PairStatus") == "1" ?
+    this->pairState = serverInfoFields.value("PairStatus") == "1" ?
                 PS_PAIRED : PS_NOT_PAIRED;
-    this->currentGameId = NvHTTP::getCurrentGame(serverInfo);
-    this->appVersion = NvHTTP::getXmlString(serverInfo, "appversion");
-    this->gfeVersion = NvHTTP::getXmlString(serverInfo, "GfeVersion");
-    this->gpuModel = NvHTTP::getXmlString(serverInfo, "gputype");
+    this->currentGameId = NvHTTP::getCurrentGame(serverInfoFields);
+    this->appVersion = serverInfoFields.value("appversion");
+    this->gfeVersion = serverInfoFields.value("GfeVersion");
+    this->gpuModel = serverInfoFields.value("gputype");
     this->activeAddress = http.address();
     this->state = NvComputer::CS_ONLINE;
     this->pendingQuit = false;
@@ -352,6 +381,18 @@ bool NvComputer::wake() const
     return success;
 }
 
+bool NvComputer::supportsConnectionReuse() const
+{
+    // Allow connection reuse to be forced on or off for testing
+    if (qEnvironmentVariableIsSet("NVHTTP_CONNECTION_REUSE")) {
+        return qEnvironmentVariableIntValue("NVHTTP_CONNECTION_REUSE") != 0;
+    }
+
+    // GFE doesn't tolerate reused connections, but Sunshine does
+    QReadLocker readLocker(&lock);
+    return !isNvidiaServerSoftware;
+}
+
 NvComputer::ReachabilityType NvComputer::getActiveAddressReachability() const
 {
     NvAddress copyOfActiveAddress;
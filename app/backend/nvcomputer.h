@@ -20,13 +20,15 @@ public:
 
 class NvComputer
 {
-    friend class PcMonitorThread;
+    friend class ComputerPollScheduler;
     friend class ComputerManager;
     friend class PendingQuitTask;
 
 private:
     void sortAppList();
 
+    void initializeEphemeralTraits();
+
     bool updateAppList(QVector<NvApp> newAppList);
 
     bool pendingQuit;
@@ -42,8 +44,12 @@ public:
 
     explicit NvComputer(NvHTTP& http, QString serverInfo);
 
+    // Used to migrate hosts saved by older versions
     explicit NvComputer(QSettings& settings);
 
+    // Check the stream status afterwards to detect corrupt records
+    explicit NvComputer(QDataStream& stream);
+
     void
     setRemoteAddress(QHostAddress);
 
@@ -63,11 +69,16 @@ public:
     ReachabilityType
     getActiveAddressReachability() const;
 
+    // Whether NvHTTP may keep connections to this host alive between requests
+    bool
+    supportsConnectionReuse() const;
+
     QVector<NvAddress>
     uniqueAddresses() const;
 
+    // Caller is responsible for synchronizing read access to this host
     void
-    serialize(QSettings& settings, bool serializeApps) const;
+    serialize(QDataStream& stream) const;
 
     // Caller is responsible for synchronizing read access to both hosts
     bool
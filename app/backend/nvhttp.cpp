@@ -8,9 +8,13 @@
 #include <QTimer>
 #include <QXmlStreamReader>
 #include <QSslKey>
-#include <QImageReader>
+#include <QImage>
+#include <QCoreApplication>
 #include <QtEndian>
 #include <QNetworkProxy>
+#include <QPointer>
+#include <QThreadStorage>
+#include <QCryptographicHash>
 
 #define FAST_FAIL_TIMEOUT_MS 2000
 #define REQUEST_TIMEOUT_MS 5000
@@ -18,20 +22,46 @@
 #define RESUME_TIMEOUT_MS 30000
 #define QUIT_TIMEOUT_MS 30000
 
+#define TIMED_OUT_PROPERTY "NvHttpTimedOut"
+
+// Runs an asynchronous NvHTTP operation to completion on a nested event loop
+template <typename T>
+static T waitForCompletion(std::function<void(std::function<void(const T&, std::exception_ptr)>)> startFunc)
+{
+    QEventLoop loop;
+    bool completed = false;
+    T result;
+    std::exception_ptr error;
+
+    startFunc([&](const T& value, std::exception_ptr valueError) {
+        result = value;
+        error = valueError;
+        completed = true;
+        loop.quit();
+    });
+
+    // The callback always runs eventually, because requests are
+    // aborted on timeout and when the application quits.
+    while (!completed) {
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return result;
+}
+
 NvHTTP::NvHTTP(NvAddress address, uint16_t httpsPort, QSslCertificate serverCert) :
-    m_ServerCert(serverCert)
+    m_ServerCert(serverCert),
+    m_ConnectionReuse(false)
 {
     m_BaseUrlHttp.setScheme("http");
     m_BaseUrlHttps.setScheme("https");
 
     setAddress(address);
     setHttpsPort(httpsPort);
-
-    // Never use a proxy server
-    QNetworkProxy noProxy(QNetworkProxy::NoProxy);
-    m_Nam.setProxy(noProxy);
-
-    connect(&m_Nam, &QNetworkAccessManager::sslErrors, this, &NvHTTP::handleSslErrors);
 }
 
 NvHTTP::NvHTTP(NvComputer* computer) :
@@ -45,6 +75,31 @@ void NvHTTP::setServerCert(QSslCertificate serverCert)
     m_ServerCert = serverCert;
 }
 
+void NvHTTP::setConnectionReuse(bool enabled)
+{
+    m_ConnectionReuse = enabled;
+}
+
+QNetworkAccessManager* NvHTTP::getNetworkAccessManager()
+{
+    // QNetworkAccessManager must only be used on the thread that created it,
+    // so all NvHTTP objects on a given thread share one. QThreadStorage will
+    // delete it when the thread exits.
+    static QThreadStorage<QNetworkAccessManager*> s_Nams;
+
+    if (!s_Nams.hasLocalData()) {
+        QNetworkAccessManager* nam = new QNetworkAccessManager();
+
+        // Never use a proxy server
+        QNetworkProxy noProxy(QNetworkProxy::NoProxy);
+        nam->setProxy(noProxy);
+
+        s_Nams.setLocalData(nam);
+    }
+
+    return s_Nams.localData();
+}
+
 void NvHTTP::setAddress(NvAddress address)
 {
     Q_ASSERT(!address.isNull());
@@ -105,14 +160,20 @@ NvHTTP::parseQuad(QString quad)
 
 int
 NvHTTP::getCurrentGame(QString serverInfo)
+{
+    return getCurrentGame(NvXmlFields(serverInfo));
+}
+
+int
+NvHTTP::getCurrentGame(const NvXmlFields& serverInfo)
 {
     // GFE 2.8 started keeping currentgame set to the last game played. As a result, it no longer
     // has the semantics that its name would indicate. To contain the effects of this change as much
     // as possible, we'll force the current game to zero if the server isn't in a streaming session.
-    QString serverState = getXmlString(serverInfo, "state");
+    QString serverState = serverInfo.value("state");
     if (serverState != nullptr && serverState.endsWith("_SERVER_BUSY"))
     {
-        return getXmlString(serverInfo, "currentgame").toInt();
+        return serverInfo.value("currentgame").toInt();
     }
     else
     {
@@ -123,67 +184,155 @@ NvHTTP::getCurrentGame(QString serverInfo)
 QString
 NvHTTP::getServerInfo(NvLogLevel logLevel, bool fastFail)
 {
-    QString serverInfo;
+    return waitForCompletion<QString>([&](ServerInfoCallback callback) {
+        getServerInfoAsync(logLevel, fastFail, callback);
+    });
+}
+
+NvRequestHandle
+NvHTTP::getServerInfoAsync(NvLogLevel logLevel, bool fastFail, ServerInfoCallback callback)
+{
+    NvRequestHandle request(new NvPendingRequest());
+
+    getServerInfoAsync(request, logLevel, fastFail, callback);
+    return request;
+}
+
+void
+NvHTTP::getServerInfoAsync(NvRequestHandle request, NvLogLevel logLevel, bool fastFail, ServerInfoCallback callback)
+{
+    int timeoutMs = fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS;
+    QPointer<NvHTTP> self(this);
+
+    // Don't start another round trip if the caller gave up on this request
+    if (request->isAborted())
+    {
+        callback(QString(), std::make_exception_ptr(QtNetworkReplyException(QNetworkReply::OperationCanceledError, "Request cancelled")));
+        return;
+    }
 
     // Check if we have a pinned cert and HTTPS port for this host yet
     if (!m_ServerCert.isNull() && httpsPort() != 0)
     {
-        try
+        // Always try HTTPS first, since it properly reports
+        // pairing status (and a few other attributes).
+        request->m_Reply = openConnectionAsync(m_BaseUrlHttps,
+                                               "serverinfo",
+                                               nullptr,
+                                               timeoutMs,
+                                               logLevel,
+                                               [self, request, timeoutMs, logLevel, callback](const QByteArray& data, std::exception_ptr error)
         {
-            // Always try HTTPS first, since it properly reports
-            // pairing status (and a few other attributes).
-            serverInfo = openConnectionToString(m_BaseUrlHttps,
-                                                "serverinfo",
-                                                nullptr,
-                                                fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                                logLevel);
-            // Throws if the request failed
-            verifyResponseStatus(serverInfo);
-        }
-        catch (const GfeHttpResponseException& e)
-        {
-            if (e.getStatusCode() == 401)
+            QString serverInfo = QString::fromUtf8(data);
+
+            try
             {
-                // Certificate validation error, fallback to HTTP
-                serverInfo = openConnectionToString(m_BaseUrlHttp,
-                                                    "serverinfo",
-                                                    nullptr,
-                                                    fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                                    logLevel);
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+
+                // Throws if the request failed
                 verifyResponseStatus(serverInfo);
             }
-            else
+            catch (const GfeHttpResponseException& e)
             {
-                // Rethrow real errors
-                throw e;
+                if (e.getStatusCode() == 401 && self && !request->isAborted())
+                {
+                    // Certificate validation error, fallback to HTTP
+                    request->m_Reply = self->openConnectionAsync(self->m_BaseUrlHttp,
+                                                                 "serverinfo",
+                                                                 nullptr,
+                                                                 timeoutMs,
+                                                                 logLevel,
+                                                                 [callback](const QByteArray& data, std::exception_ptr error)
+                    {
+                        QString serverInfo = QString::fromUtf8(data);
+
+                        try
+                        {
+                            if (error)
+                            {
+                                std::rethrow_exception(error);
+                            }
+
+                            verifyResponseStatus(serverInfo);
+                        }
+                        catch (...)
+                        {
+                            callback(QString(), std::current_exception());
+                            return;
+                        }
+
+                        callback(serverInfo, nullptr);
+                    });
+                }
+                else
+                {
+                    // Pass along real errors
+                    callback(QString(), std::current_exception());
+                }
+                return;
             }
-        }
+            catch (...)
+            {
+                callback(QString(), std::current_exception());
+                return;
+            }
+
+            callback(serverInfo, nullptr);
+        });
     }
     else
     {
         // Only use HTTP prior to pairing or fetching HTTPS port
-        serverInfo = openConnectionToString(m_BaseUrlHttp,
-                                            "serverinfo",
-                                            nullptr,
-                                            fastFail ? FAST_FAIL_TIMEOUT_MS : REQUEST_TIMEOUT_MS,
-                                            logLevel);
-        verifyResponseStatus(serverInfo);
-
-        // Populate the HTTPS port
-        uint16_t httpsPort = getXmlString(serverInfo, "HttpsPort").toUShort();
-        if (httpsPort == 0) {
-            httpsPort = DEFAULT_HTTPS_PORT;
-        }
-        setHttpsPort(httpsPort);
+        request->m_Reply = openConnectionAsync(m_BaseUrlHttp,
+                                               "serverinfo",
+                                               nullptr,
+                                               timeoutMs,
+                                               logLevel,
+                                               [self, request, logLevel, fastFail, callback](const QByteArray& data, std::exception_ptr error)
+        {
+            QString serverInfo = QString::fromUtf8(data);
 
-        // If we just needed to determine the HTTPS port, we'll try again over
-        // HTTPS now that we have the port number
-        if (!m_ServerCert.isNull()) {
-            return getServerInfo(logLevel, fastFail);
-        }
-    }
+            try
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+
+                verifyResponseStatus(serverInfo);
+            }
+            catch (...)
+            {
+                callback(QString(), std::current_exception());
+                return;
+            }
 
-    return serverInfo;
+            if (!self)
+            {
+                callback(serverInfo, nullptr);
+                return;
+            }
+
+            // Populate the HTTPS port
+            uint16_t httpsPort = getXmlString(serverInfo, "HttpsPort").toUShort();
+            if (httpsPort == 0) {
+                httpsPort = DEFAULT_HTTPS_PORT;
+            }
+            self->setHttpsPort(httpsPort);
+
+            // If we just needed to determine the HTTPS port, we'll try again over
+            // HTTPS now that we have the port number
+            if (!self->m_ServerCert.isNull()) {
+                self->getServerInfoAsync(request, logLevel, fastFail, callback);
+                return;
+            }
+
+            callback(serverInfo, nullptr);
+        });
+    }
 }
 
 void
@@ -261,40 +410,96 @@ NvHTTP::quitApp()
 QVector<NvDisplayMode>
 NvHTTP::getDisplayModeList(QString serverInfo)
 {
-    QXmlStreamReader xmlReader(serverInfo);
-    QVector<NvDisplayMode> modes;
+    return NvXmlFields(serverInfo).displayModes();
+}
 
-    while (!xmlReader.atEnd()) {
-        while (xmlReader.readNextStartElement()) {
-            auto name = xmlReader.name();
-            if (name == QString("DisplayMode")) {
-                modes.append(NvDisplayMode());
-            }
-            else if (name == QString("Width")) {
-                modes.last().width = xmlReader.readElementText().toInt();
-            }
-            else if (name == QString("Height")) {
-                modes.last().height = xmlReader.readElementText().toInt();
-            }
-            else if (name == QString("RefreshRate")) {
-                modes.last().refreshRate = xmlReader.readElementText().toInt();
+QVector<NvApp>
+NvHTTP::getAppList()
+{
+    return waitForCompletion<QVector<NvApp>>([&](AppListCallback callback) {
+        getAppListAsync(callback);
+    });
+}
+
+QNetworkReply*
+NvHTTP::getAppListAsync(AppListCallback callback)
+{
+    return openConnectionAsync(m_BaseUrlHttps,
+                               "applist",
+                               nullptr,
+                               REQUEST_TIMEOUT_MS,
+                               NvLogLevel::NVLL_ERROR,
+                               [callback](const QByteArray& data, std::exception_ptr error)
+    {
+        QVector<NvApp> apps;
+
+        try {
+            if (error) {
+                std::rethrow_exception(error);
             }
+
+            QString appxml = QString::fromUtf8(data);
+            verifyResponseStatus(appxml);
+            apps = parseAppList(appxml);
+        } catch (...) {
+            callback(QVector<NvApp>(), std::current_exception());
+            return;
         }
-    }
 
-    return modes;
+        callback(apps, nullptr);
+    });
 }
 
-QVector<NvApp>
-NvHTTP::getAppList()
+QNetworkReply*
+NvHTTP::getAppListIfChangedAsync(NvAppListFingerprint fingerprint, AppListSyncCallback callback)
 {
-    QString appxml = openConnectionToString(m_BaseUrlHttps,
-                                            "applist",
-                                            nullptr,
-                                            REQUEST_TIMEOUT_MS,
-                                            NvLogLevel::NVLL_ERROR);
-    verifyResponseStatus(appxml);
+    return sendRequestAsync(m_BaseUrlHttps,
+                            "applist",
+                            nullptr,
+                            REQUEST_TIMEOUT_MS,
+                            NvLogLevel::NVLL_ERROR,
+                            fingerprint.etag,
+                            [fingerprint, callback](QNetworkReply* reply, std::exception_ptr error)
+    {
+        if (error) {
+            callback(AppListSyncResult::Unchanged, QVector<NvApp>(), fingerprint, error);
+            return;
+        }
+
+        // The host honored our If-None-Match header
+        if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304) {
+            callback(AppListSyncResult::NotModified, QVector<NvApp>(), fingerprint, nullptr);
+            return;
+        }
+
+        QByteArray data = reply->readAll();
+        NvAppListFingerprint newFingerprint;
+        newFingerprint.etag = reply->rawHeader("ETag");
+        newFingerprint.hash = QCryptographicHash::hash(data, QCryptographicHash::Sha256);
 
+        // Skip parsing entirely if the response is identical to last time
+        if (!fingerprint.hash.isEmpty() && newFingerprint.hash == fingerprint.hash) {
+            callback(AppListSyncResult::Unchanged, QVector<NvApp>(), newFingerprint, nullptr);
+            return;
+        }
+
+        QVector<NvApp> apps;
+        try {
+            QString appxml = QString::fromUtf8(data);
+            verifyResponseStatus(appxml);
+            apps = parseAppList(appxml);
+        } catch (...) {
+            callback(AppListSyncResult::Unchanged, QVector<NvApp>(), fingerprint, std::current_exception());
+            return;
+        }
+
+        callback(AppListSyncResult::Changed, apps, newFingerprint, nullptr);
+    });
+}
+
+QVector<NvApp>
+NvHTTP::parseAppList(QString appxml)
+{
     QXmlStreamReader xmlReader(appxml);
     QVector<NvApp> apps;
     while (!xmlReader.atEnd()) {
@@ -368,16 +573,43 @@ NvHTTP::verifyResponseStatus(QString xml)
 QImage
 NvHTTP::getBoxArt(int appId)
 {
-    QNetworkReply* reply = openConnection(m_BaseUrlHttps,
-                                          "appasset",
-                                          "appid="+QString::number(appId)+
-                                          "&AssetType=2&AssetIdx=0",
-                                          REQUEST_TIMEOUT_MS,
-                                          NvLogLevel::NVLL_VERBOSE);
-    QImage image = QImageReader(reply).read();
-    delete reply;
+    return waitForCompletion<QImage>([&](BoxArtCallback callback) {
+        getBoxArtAsync(appId, callback);
+    });
+}
+
+QNetworkReply*
+NvHTTP::getBoxArtAsync(int appId, BoxArtCallback callback)
+{
+    return getBoxArtDataAsync(appId, [callback](const QByteArray& data, std::exception_ptr error)
+    {
+        if (error) {
+            callback(QImage(), error);
+            return;
+        }
+
+        callback(QImage::fromData(data), nullptr);
+    });
+}
+
+QByteArray
+NvHTTP::getBoxArtData(int appId)
+{
+    return waitForCompletion<QByteArray>([&](ResponseCallback callback) {
+        getBoxArtDataAsync(appId, callback);
+    });
+}
 
-    return image;
+QNetworkReply*
+NvHTTP::getBoxArtDataAsync(int appId, ResponseCallback callback)
+{
+    return openConnectionAsync(m_BaseUrlHttps,
+                               "appasset",
+                               "appid="+QString::number(appId)+
+                               "&AssetType=2&AssetIdx=0",
+                               REQUEST_TIMEOUT_MS,
+                               NvLogLevel::NVLL_VERBOSE,
+                               callback);
 }
 
 QByteArray
@@ -393,6 +625,86 @@ NvHTTP::getXmlStringFromHex(QString xml,
     return QByteArray::fromHex(str.toLatin1());
 }
 
+NvXmlFields::NvXmlFields(const QString& xml)
+{
+    QXmlStreamReader xmlReader(xml);
+    QString text;
+    bool inLeafElement = false;
+    bool inDisplayMode = false;
+
+    while (!xmlReader.atEnd())
+    {
+        switch (xmlReader.readNext())
+        {
+        case QXmlStreamReader::StartElement:
+            if (xmlReader.name() == QString("DisplayMode"))
+            {
+                m_DisplayModes.append(NvDisplayMode());
+                inDisplayMode = true;
+            }
+
+            // Assume this is a leaf until we see a child element
+            inLeafElement = true;
+            text.clear();
+            break;
+
+        case QXmlStreamReader::Characters:
+            if (inLeafElement)
+            {
+                text += xmlReader.text();
+            }
+            break;
+
+        case QXmlStreamReader::EndElement:
+        {
+            QString name = xmlReader.name().toString();
+
+            if (inLeafElement)
+            {
+                if (!m_Fields.contains(name))
+                {
+                    m_Fields.insert(name, text);
+                }
+
+                if (inDisplayMode)
+                {
+                    if (name == "Width") {
+                        m_DisplayModes.last().width = text.toInt();
+                    }
+                    else if (name == "Height") {
+                        m_DisplayModes.last().height = text.toInt();
+                    }
+                    else if (name == "RefreshRate") {
+                        m_DisplayModes.last().refreshRate = text.toInt();
+                    }
+                }
+            }
+            else if (name == "DisplayMode")
+            {
+                inDisplayMode = false;
+            }
+
+            inLeafElement = false;
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+}
+
+QByteArray NvXmlFields::hexValue(const QString& tagName) const
+{
+    QString str = value(tagName);
+    if (str == nullptr)
+    {
+        return nullptr;
+    }
+
+    return QByteArray::fromHex(str.toLatin1());
+}
+
 QString
 NvHTTP::getXmlString(QString xml,
                      QString tagName)
@@ -415,18 +727,18 @@ NvHTTP::getXmlString(QString xml,
     return nullptr;
 }
 
-void NvHTTP::handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors)
+void NvHTTP::handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors, const QSslCertificate& serverCert)
 {
     bool ignoreErrors = true;
 
-    if (m_ServerCert.isNull()) {
+    if (serverCert.isNull()) {
         // We should never make an HTTPS request without a cert
-        Q_ASSERT(!m_ServerCert.isNull());
+        Q_ASSERT(!serverCert.isNull());
         return;
     }
 
     for (const QSslError& error : errors) {
-        if (m_ServerCert != error.certificate()) {
+        if (serverCert != error.certificate()) {
             ignoreErrors = false;
             break;
         }
@@ -444,29 +756,43 @@ NvHTTP::openConnectionToString(QUrl baseUrl,
                                int timeoutMs,
                                NvLogLevel logLevel)
 {
-    QNetworkReply* reply = openConnection(baseUrl, command, arguments, timeoutMs, logLevel);
-    QString ret;
-
-    QTextStream stream(reply);
-
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    stream.setEncoding(QStringConverter::Utf8);
-#else
-    stream.setCodec("UTF-8");
-#endif
-
-    ret = stream.readAll();
-    delete reply;
-
-    return ret;
+    return QString::fromUtf8(openConnection(baseUrl, command, arguments, timeoutMs, logLevel));
 }
 
-QNetworkReply*
+QByteArray
 NvHTTP::openConnection(QUrl baseUrl,
                        QString command,
                        QString arguments,
                        int timeoutMs,
                        NvLogLevel logLevel)
+{
+    return waitForCompletion<QByteArray>([&](ResponseCallback callback) {
+        openConnectionAsync(baseUrl, command, arguments, timeoutMs, logLevel, callback);
+    });
+}
+
+QNetworkReply*
+NvHTTP::openConnectionAsync(QUrl baseUrl,
+                            QString command,
+                            QString arguments,
+                            int timeoutMs,
+                            NvLogLevel logLevel,
+                            ResponseCallback callback)
+{
+    return sendRequestAsync(baseUrl, command, arguments, timeoutMs, logLevel, QByteArray(),
+                            [callback](QNetworkReply* reply, std::exception_ptr error) {
+        callback(error ? QByteArray() : reply->readAll(), error);
+    });
+}
+
+QNetworkReply*
+NvHTTP::sendRequestAsync(QUrl baseUrl,
+                         QString command,
+                         QString arguments,
+                         int timeoutMs,
+                         NvLogLevel logLevel,
+                         QByteArray ifNoneMatch,
+                         ReplyCallback callback)
 {
     // Port must be set
     Q_ASSERT(baseUrl.port(0) != 0);
@@ -485,73 +811,128 @@ NvHTTP::openConnection(QUrl baseUrl,
     QNetworkRequest request(url);
 
     // Add our client certificate
-    request.setSslConfiguration(IdentityManager::get()->getSslConfig());
+    QSslConfiguration sslConfig = IdentityManager::get()->getSslConfig();
+
+    if (!m_ConnectionReuse) {
+        // GFE will puke if we reuse connections or cached sessions, so make
+        // sure each request performs a full handshake on a new connection.
+        // We can't clear the access cache like we used to, because the
+        // QNetworkAccessManager is shared with other in-flight requests.
+        request.setRawHeader("Connection", "close");
+        sslConfig.setSslOption(QSsl::SslOptionDisableSessionSharing, true);
+    }
+
+    request.setSslConfiguration(sslConfig);
+
+    if (!ifNoneMatch.isEmpty()) {
+        // Allow the host to tell us the resource hasn't changed
+        request.setRawHeader("If-None-Match", ifNoneMatch);
+    }
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     // Disable HTTP/2 (GFE 3.22 doesn't like it) and Qt 6 enables it by default
     request.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
 #endif
 
+    if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
+        qInfo() << "Executing request:" << url.toString();
+    }
+
+    return startRequest(request, m_ServerCert, command, timeoutMs, logLevel, m_ConnectionReuse, callback);
+}
+
+QNetworkReply*
+NvHTTP::startRequest(QNetworkRequest request,
+                     QSslCertificate serverCert,
+                     QString command,
+                     int timeoutMs,
+                     NvLogLevel logLevel,
+                     bool retryOnClose,
+                     ReplyCallback callback)
+{
+    QUrl url = request.url();
+    QNetworkAccessManager* nam = getNetworkAccessManager();
+
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0) && QT_VERSION < QT_VERSION_CHECK(5, 15, 1) && !defined(QT_NO_BEARERMANAGEMENT)
     // HACK: Set network accessibility to work around QTBUG-80947 (introduced in Qt 5.14.0 and fixed in Qt 5.15.1)
     QT_WARNING_PUSH
     QT_WARNING_DISABLE_DEPRECATED
-    m_Nam.setNetworkAccessible(QNetworkAccessManager::Accessible);
+    nam->setNetworkAccessible(QNetworkAccessManager::Accessible);
     QT_WARNING_POP
 #endif
 
-    QNetworkReply* reply = m_Nam.get(request);
+    QNetworkReply* reply = nam->get(request);
 
-    // Run the request with a timeout if requested
-    QEventLoop loop;
-    connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, &loop, &QEventLoop::quit);
+    // Only accept the certificate we have pinned for this host
+    connect(reply, &QNetworkReply::sslErrors, reply, [reply, serverCert](const QList<QSslError>& errors) {
+        handleSslErrors(reply, errors, serverCert);
+    });
+
+    // Abort the request if it times out
     if (timeoutMs) {
-        QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
-    }
-    if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
-        qInfo() << "Executing request:" << url.toString();
+        QTimer* timer = new QTimer(reply);
+        timer->setSingleShot(true);
+        connect(timer, &QTimer::timeout, reply, [reply, url, logLevel]() {
+            if (logLevel >= NvLogLevel::NVLL_ERROR) {
+                qWarning() << "Aborting timed out request for" << url.toString();
+            }
+            reply->setProperty(TIMED_OUT_PROPERTY, true);
+            reply->abort();
+        });
+        timer->start(timeoutMs);
     }
-    loop.exec(QEventLoop::ExcludeUserInputEvents);
 
-    // Abort the request if it timed out
-    if (!reply->isFinished())
-    {
-        if (logLevel >= NvLogLevel::NVLL_ERROR) {
-            qWarning() << "Aborting timed out request for" << url.toString();
-        }
-        reply->abort();
-    }
+    // Abort any requests in progress when we're quitting
+    connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, reply, &QNetworkReply::abort);
 
-    // We must clear out cached authentication and connections or
-    // GFE will puke next time
-    m_Nam.clearAccessCache();
+    connect(reply, &QNetworkReply::finished, reply, [reply, request, serverCert, command, timeoutMs, logLevel, retryOnClose, callback]() {
+        std::exception_ptr error;
 
-    // Handle error
-    if (reply->error() != QNetworkReply::NoError)
-    {
-        if (logLevel >= NvLogLevel::NVLL_ERROR) {
-            qWarning() << command << "request failed with error:" << reply->error();
-        }
+        // The host may have closed a kept-alive connection while it was idle.
+        // Retry once on a connection of its own rather than clearing the
+        // access cache, which would drop the other hosts' connections too.
+        // NB: The retry isn't aborted through the original reply, but
+        // aborted callers ignore its result.
+        if (retryOnClose && reply->error() == QNetworkReply::RemoteHostClosedError) {
+            if (logLevel >= NvLogLevel::NVLL_VERBOSE) {
+                qInfo() << command << "request failed on a kept-alive connection; retrying";
+            }
 
-        if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
-            // This will trigger falling back to HTTP for the serverinfo query
-            // then pairing again to get the updated certificate.
-            GfeHttpResponseException exception(401, "Server certificate mismatch");
-            delete reply;
-            throw exception;
-        }
-        else if (reply->error() == QNetworkReply::OperationCanceledError) {
-            QtNetworkReplyException exception(QNetworkReply::TimeoutError, "Request timed out");
-            delete reply;
-            throw exception;
+            QNetworkRequest retryRequest(request);
+            retryRequest.setRawHeader("Connection", "close");
+            startRequest(retryRequest, serverCert, command, timeoutMs, logLevel, false, callback);
+            reply->deleteLater();
+            return;
         }
-        else {
-            QtNetworkReplyException exception(reply->error(), reply->errorString());
-            delete reply;
-            throw exception;
+
+        // Handle error
+        if (reply->error() != QNetworkReply::NoError)
+        {
+            if (logLevel >= NvLogLevel::NVLL_ERROR) {
+                qWarning() << command << "request failed with error:" << reply->error();
+            }
+
+            if (reply->error() == QNetworkReply::SslHandshakeFailedError) {
+                // This will trigger falling back to HTTP for the serverinfo query
+                // then pairing again to get the updated certificate.
+                error = std::make_exception_ptr(GfeHttpResponseException(401, "Server certificate mismatch"));
+            }
+            else if (reply->error() == QNetworkReply::OperationCanceledError) {
+                if (reply->property(TIMED_OUT_PROPERTY).toBool()) {
+                    error = std::make_exception_ptr(QtNetworkReplyException(QNetworkReply::TimeoutError, "Request timed out"));
+                }
+                else {
+                    error = std::make_exception_ptr(QtNetworkReplyException(QNetworkReply::OperationCanceledError, "Request cancelled"));
+                }
+            }
+            else {
+                error = std::make_exception_ptr(QtNetworkReplyException(reply->error(), reply->errorString()));
+            }
         }
-    }
+
+        callback(reply, error);
+        reply->deleteLater();
+    });
 
     return reply;
 }
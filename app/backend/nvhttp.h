@@ -7,8 +7,14 @@
 #include <Limelight.h>
 
 #include <QUrl>
+#include <QHash>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QPointer>
+#include <QSharedPointer>
+
+#include <exception>
+#include <functional>
 
 class NvComputer;
 
@@ -28,6 +34,42 @@ public:
 };
 Q_DECLARE_TYPEINFO(NvDisplayMode, Q_PRIMITIVE_TYPE);
 
+// Identifies a previously fetched app list response
+class NvAppListFingerprint
+{
+public:
+    // Entity tag from the host, if it provides one
+    QByteArray etag;
+
+    // Hash of the response body
+    QByteArray hash;
+};
+
+// The text of each leaf element in a response document, collected in a
+// single pass over the XML. Only the first occurrence of each tag is kept,
+// which matches the behavior of NvHTTP::getXmlString().
+class NvXmlFields
+{
+public:
+    explicit NvXmlFields(const QString& xml);
+
+    QString value(const QString& tagName) const
+    {
+        return m_Fields.value(tagName);
+    }
+
+    QByteArray hexValue(const QString& tagName) const;
+
+    const QVector<NvDisplayMode>& displayModes() const
+    {
+        return m_DisplayModes;
+    }
+
+private:
+    QHash<QString, QString> m_Fields;
+    QVector<NvDisplayMode> m_DisplayModes;
+};
+
 class GfeHttpResponseException : public std::exception
 {
 public:
@@ -98,6 +140,42 @@ private:
     QString m_ErrorText;
 };
 
+// Cancels an asynchronous request that may take more than one round trip,
+// such as a serverinfo query that falls back from HTTPS to HTTP. Aborting
+// it aborts the request in flight and keeps any later ones from starting.
+// The completion callback still runs, with a cancellation error. Like the
+// QNetworkReply it wraps, it must only be used on the requesting thread.
+class NvPendingRequest
+{
+public:
+    NvPendingRequest() :
+        m_Aborted(false)
+    {
+
+    }
+
+    void abort()
+    {
+        m_Aborted = true;
+        if (m_Reply) {
+            m_Reply->abort();
+        }
+    }
+
+    bool isAborted() const
+    {
+        return m_Aborted;
+    }
+
+private:
+    friend class NvHTTP;
+
+    bool m_Aborted;
+    QPointer<QNetworkReply> m_Reply;
+};
+
+typedef QSharedPointer<NvPendingRequest> NvRequestHandle;
+
 class NvHTTP : public QObject
 {
     Q_OBJECT
@@ -109,6 +187,31 @@ public:
         NVLL_VERBOSE
     };
 
+    // Completion callbacks for asynchronous requests. If the request failed,
+    // error holds the GfeHttpResponseException or QtNetworkReplyException that
+    // the synchronous version would have thrown and the other argument is empty.
+    typedef std::function<void(const QByteArray& data, std::exception_ptr error)> ResponseCallback;
+    typedef std::function<void(const QString& serverInfo, std::exception_ptr error)> ServerInfoCallback;
+    typedef std::function<void(const QVector<NvApp>& appList, std::exception_ptr error)> AppListCallback;
+    typedef std::function<void(const QImage& boxArt, std::exception_ptr error)> BoxArtCallback;
+
+    enum class AppListSyncResult {
+        // The list was parsed because it differs from the fingerprinted response
+        Changed,
+
+        // The response body matched the fingerprint, so it wasn't parsed
+        Unchanged,
+
+        // The host answered our conditional request with 304 Not Modified
+        NotModified
+    };
+
+    // appList is only populated for AppListSyncResult::Changed
+    typedef std::function<void(AppListSyncResult result,
+                               const QVector<NvApp>& appList,
+                               const NvAppListFingerprint& fingerprint,
+                               std::exception_ptr error)> AppListSyncCallback;
+
     explicit NvHTTP(NvAddress address, uint16_t httpsPort, QSslCertificate serverCert);
 
     explicit NvHTTP(NvComputer* computer);
@@ -117,9 +220,16 @@ public:
     int
     getCurrentGame(QString serverInfo);
 
+    static
+    int
+    getCurrentGame(const NvXmlFields& serverInfo);
+
     QString
     getServerInfo(NvLogLevel logLevel, bool fastFail = false);
 
+    NvRequestHandle
+    getServerInfoAsync(NvLogLevel logLevel, bool fastFail, ServerInfoCallback callback);
+
     static
     void
     verifyResponseStatus(QString xml);
@@ -141,8 +251,27 @@ public:
                            int timeoutMs,
                            NvLogLevel logLevel = NvLogLevel::NVLL_VERBOSE);
 
+    // Starts a request without blocking. Any number of requests may be in
+    // flight at once. The callback runs on the calling thread's event loop
+    // once the request completes, fails, times out, or is cancelled.
+    //
+    // The returned reply may be aborted to cancel the request. It is deleted
+    // after the callback runs, so hold it in a QPointer if it's kept around.
+    QNetworkReply*
+    openConnectionAsync(QUrl baseUrl,
+                        QString command,
+                        QString arguments,
+                        int timeoutMs,
+                        NvLogLevel logLevel,
+                        ResponseCallback callback);
+
     void setServerCert(QSslCertificate serverCert);
 
+    // Keep connections alive between requests made with this object
+    // instead of performing a new TCP and TLS handshake each time.
+    // This must not be used with GFE hosts.
+    void setConnectionReuse(bool enabled);
+
     void setAddress(NvAddress address);
     void setHttpsPort(uint16_t port);
 
@@ -175,9 +304,27 @@ public:
     QVector<NvApp>
     getAppList();
 
+    QNetworkReply*
+    getAppListAsync(AppListCallback callback);
+
+    // Fetches the app list, using a conditional request if the host gave us an
+    // ETag for the previous response. The list is only parsed if it changed.
+    QNetworkReply*
+    getAppListIfChangedAsync(NvAppListFingerprint fingerprint, AppListSyncCallback callback);
+
     QImage
     getBoxArt(int appId);
 
+    QNetworkReply*
+    getBoxArtAsync(int appId, BoxArtCallback callback);
+
+    // Returns the image encoded as the host sent it
+    QByteArray
+    getBoxArtData(int appId);
+
+    QNetworkReply*
+    getBoxArtDataAsync(int appId, ResponseCallback callback);
+
     static
     QVector<NvDisplayMode>
     getDisplayModeList(QString serverInfo);
@@ -185,10 +332,46 @@ public:
     QUrl m_BaseUrlHttp;
     QUrl m_BaseUrlHttps;
 private:
+    typedef std::function<void(QNetworkReply* reply, std::exception_ptr error)> ReplyCallback;
+
+    void
+    getServerInfoAsync(NvRequestHandle request, NvLogLevel logLevel, bool fastFail, ServerInfoCallback callback);
+
+    static
     void
-    handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors);
+    handleSslErrors(QNetworkReply* reply, const QList<QSslError>& errors, const QSslCertificate& serverCert);
 
+    static
+    QVector<NvApp>
+    parseAppList(QString appxml);
+
+    static
+    QNetworkAccessManager*
+    getNetworkAccessManager();
+
+    // The reply is deleted after the callback returns
     QNetworkReply*
+    sendRequestAsync(QUrl baseUrl,
+                     QString command,
+                     QString arguments,
+                     int timeoutMs,
+                     NvLogLevel logLevel,
+                     QByteArray ifNoneMatch,
+                     ReplyCallback callback);
+
+    // Sends a request built by sendRequestAsync(). If retryOnClose is set
+    // and the host closed the connection, the request is sent once more.
+    static
+    QNetworkReply*
+    startRequest(QNetworkRequest request,
+                 QSslCertificate serverCert,
+                 QString command,
+                 int timeoutMs,
+                 NvLogLevel logLevel,
+                 bool retryOnClose,
+                 ReplyCallback callback);
+
+    QByteArray
     openConnection(QUrl baseUrl,
                    QString command,
                    QString arguments,
@@ -196,6 +379,6 @@ private:
                    NvLogLevel logLevel);
 
     NvAddress m_Address;
-    QNetworkAccessManager m_Nam;
     QSslCertificate m_ServerCert;
+    bool m_ConnectionReuse;
 };
@@ -220,13 +220,14 @@ NvPairingManager::pair(QString appVersion, QString pin, QSslCertificate& serverC
                                                     salt.toHex() + "&clientcert=" + IdentityManager::get()->getCertificate().toHex(),
                                                     0);
     NvHTTP::verifyResponseStatus(getCert);
-    if (NvHTTP::getXmlString(getCert, "paired") != "1")
+    NvXmlFields getCertFields(getCert);
+    if (getCertFields.value("paired") != "1")
     {
         qCritical() << "Failed pairing at stage #1";
         return PairState::FAILED;
     }
 
-    QByteArray serverCertStr = NvHTTP::getXmlStringFromHex(getCert, "plaincert");
+    QByteArray serverCertStr = getCertFields.hexValue("plaincert");
     if (serverCertStr == nullptr)
     {
         qCritical() << "Server likely already pairing";
@@ -255,14 +256,15 @@ NvPairingManager::pair(QString appVersion, QString pin, QSslCertificate& serverC
                                                          encryptedChallenge.toHex(),
                                                          REQUEST_TIMEOUT_MS);
     NvHTTP::verifyResponseStatus(challengeXml);
-    if (NvHTTP::getXmlString(challengeXml, "paired") != "1")
+    NvXmlFields challengeFields(challengeXml);
+    if (challengeFields.value("paired") != "1")
     {
         qCritical() << "Failed pairing at stage #2";
         m_Http.openConnectionToString(m_Http.m_BaseUrlHttp, "unpair", nullptr, REQUEST_TIMEOUT_MS);
         return PairState::FAILED;
     }
 
-    QByteArray challengeResponseData = decrypt(m_Http.getXmlStringFromHex(challengeXml, "challengeresponse"), aesKey);
+    QByteArray challengeResponseData = decrypt(challengeFields.hexValue("challengeresponse"), aesKey);
     QByteArray clientSecretData = generateRandomBytes(16);
     QByteArray challengeResponse;
     QByteArray serverResponse(challengeResponseData.data(), hashLength);
@@ -290,14 +292,15 @@ NvPairingManager::pair(QString appVersion, QString pin, QSslCertificate& serverC
                                                     encryptedChallengeResponseHash.toHex(),
                                                     REQUEST_TIMEOUT_MS);
     NvHTTP::verifyResponseStatus(respXml);
-    if (NvHTTP::getXmlString(respXml, "paired") != "1")
+    NvXmlFields respFields(respXml);
+    if (respFields.value("paired") != "1")
     {
         qCritical() << "Failed pairing at stage #3";
         m_Http.openConnectionToString(m_Http.m_BaseUrlHttp, "unpair", nullptr, REQUEST_TIMEOUT_MS);
         return PairState::FAILED;
     }
 
-    QByteArray pairingSecret = NvHTTP::getXmlStringFromHex(respXml, "pairingsecret");
+    QByteArray pairingSecret = respFields.hexValue("pairingsecret");
     QByteArray serverSecret = pairingSecret.left(16);
     QByteArray serverSignature = pairingSecret.mid(16);
 
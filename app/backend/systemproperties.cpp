@@ -1,8 +1,11 @@
 #include "systemproperties.h"
 #include "utils.h"
+#include "startuptracer.h"
 
+#include <QElapsedTimer>
 #include <QGuiApplication>
 #include <QLibraryInfo>
+#include <QThread>
 
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
@@ -12,7 +15,39 @@
 #include <Windows.h>
 #endif
 
+SystemProperties* SystemProperties::s_SystemProperties;
+
+class QuerySdlInfoThread : public QThread
+{
+public:
+    QuerySdlInfoThread(SystemProperties* me) :
+        QThread(nullptr),
+        m_Me(me)
+    {
+        setObjectName("SDL Query Thread");
+    }
+
+    void run() override
+    {
+        m_Me->querySdlInfoInternal();
+    }
+
+    SystemProperties* m_Me;
+};
+
+SystemProperties* SystemProperties::get()
+{
+    // This is only used on the main thread
+    if (s_SystemProperties == nullptr) {
+        s_SystemProperties = new SystemProperties();
+    }
+
+    return s_SystemProperties;
+}
+
 SystemProperties::SystemProperties()
+    : m_SdlQueryThread(nullptr),
+      m_SdlQueriesComplete(false)
 {
     versionString = QString(VERSION_STR);
     hasDesktopEnvironment = WMUtils::isRunningDesktopEnvironment();
@@ -66,64 +101,172 @@ SystemProperties::SystemProperties()
     hasDiscordIntegration = false;
 #endif
 
-    unmappedGamepads = SdlInputHandler::getUnmappedGamepads();
-
     // Populate data that requires talking to SDL. We do it all in one shot
     // and cache the results to speed up future queries on this data.
-    querySdlVideoInfo();
+    if (WMUtils::isRunningX11() || WMUtils::isRunningWayland()) {
+        // We already use a separate thread to temporarily initialize SDL
+        // video to avoid stomping on Qt's X11 and OGL state, so we can
+        // let it run in the background while the UI loads.
+        m_SdlQueryThread = new QuerySdlInfoThread(this);
+        connect(m_SdlQueryThread, &QThread::finished,
+                this, &SystemProperties::handleSdlQueriesFinished);
+        m_SdlQueryThread->start();
+    }
+
+    // Otherwise, SDL must be used on the main thread, so we'll
+    // defer the queries until one of the results is needed.
+}
+
+SystemProperties::~SystemProperties()
+{
+    if (m_SdlQueryThread != nullptr) {
+        m_SdlQueryThread->wait();
+        delete m_SdlQueryThread;
+    }
+
+    if (s_SystemProperties == this) {
+        s_SystemProperties = nullptr;
+    }
+}
+
+bool SystemProperties::isSdlQueryRunning()
+{
+    // This stays set until handleSdlQueriesFinished() runs, even if
+    // someone waited for the thread in the meantime, so callers are
+    // always sent sdlQueriesFinished() after seeing true here.
+    return m_SdlQueryThread != nullptr;
+}
+
+void SystemProperties::waitForBackgroundSdlQueries()
+{
+    // SDL's subsystem reference counts aren't thread-safe, so the query
+    // thread's SDL_QuitSubSystem() must not race with another init.
+    if (s_SystemProperties != nullptr && s_SystemProperties->m_SdlQueryThread != nullptr) {
+        s_SystemProperties->waitForSdlQueries();
+    }
+}
+
+void SystemProperties::waitForSdlQueries()
+{
+    if (m_SdlQueriesComplete) {
+        return;
+    }
+
+    QElapsedTimer waitTimer;
+    waitTimer.start();
+
+    STARTUP_TRACE_BEGIN("Wait for SDL queries");
+    if (m_SdlQueryThread != nullptr) {
+        m_SdlQueryThread->wait();
+    }
+    else {
+        querySdlInfoInternal();
+    }
+    STARTUP_TRACE_END("Wait for SDL queries");
+
+    m_SdlQueriesComplete = true;
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Waited %d ms for SDL queries",
+                (int)waitTimer.elapsed());
 
     Q_ASSERT(!monitorRefreshRates.isEmpty());
     Q_ASSERT(!monitorNativeResolutions.isEmpty());
     Q_ASSERT(!monitorSafeAreaResolutions.isEmpty());
 }
 
+void SystemProperties::handleSdlQueriesFinished()
+{
+    m_SdlQueryThread->deleteLater();
+    m_SdlQueryThread = nullptr;
+
+    // If nobody has waited for the results yet, we can publish them now
+    if (!m_SdlQueriesComplete) {
+        m_SdlQueriesComplete = true;
+
+        emit videoInfoChanged();
+        emit unmappedGamepadsChanged();
+    }
+
+    emit sdlQueriesFinished();
+}
+
+void SystemProperties::querySdlInfoInternal()
+{
+    QElapsedTimer queryTimer;
+    queryTimer.start();
+
+    STARTUP_TRACE_BEGIN("SDL video query");
+    querySdlVideoInfoInternal();
+    STARTUP_TRACE_END("SDL video query");
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "SDL video query took %d ms",
+                (int)queryTimer.restart());
+
+    STARTUP_TRACE_BEGIN("SDL gamepad query");
+    unmappedGamepads = SdlInputHandler::getUnmappedGamepads();
+    STARTUP_TRACE_END("SDL gamepad query");
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "SDL gamepad query took %d ms",
+                (int)queryTimer.elapsed());
+}
+
+bool SystemProperties::getHasHardwareAcceleration()
+{
+    waitForSdlQueries();
+    return hasHardwareAcceleration;
+}
+
+bool SystemProperties::getRendererAlwaysFullScreen()
+{
+    waitForSdlQueries();
+    return rendererAlwaysFullScreen;
+}
+
+QString SystemProperties::getUnmappedGamepads()
+{
+    waitForSdlQueries();
+    return unmappedGamepads;
+}
+
+QSize SystemProperties::getMaximumResolution()
+{
+    waitForSdlQueries();
+    return maximumResolution;
+}
+
+bool SystemProperties::getSupportsHdr()
+{
+    waitForSdlQueries();
+    return supportsHdr;
+}
+
 QRect SystemProperties::getNativeResolution(int displayIndex)
 {
+    waitForSdlQueries();
+
     // Returns default constructed QRect if out of bounds
     return monitorNativeResolutions.value(displayIndex);
 }
 
 QRect SystemProperties::getSafeAreaResolution(int displayIndex)
 {
+    waitForSdlQueries();
+
     // Returns default constructed QRect if out of bounds
     return monitorSafeAreaResolutions.value(displayIndex);
 }
 
 int SystemProperties::getRefreshRate(int displayIndex)
 {
+    waitForSdlQueries();
+
     // Returns 0 if out of bounds
     return monitorRefreshRates.value(displayIndex);
 }
 
-class QuerySdlVideoThread : public QThread
-{
-public:
-    QuerySdlVideoThread(SystemProperties* me) :
-        QThread(nullptr),
-        m_Me(me) {}
-
-    void run() override
-    {
-        m_Me->querySdlVideoInfoInternal();
-    }
-
-    SystemProperties* m_Me;
-};
-
-void SystemProperties::querySdlVideoInfo()
-{
-    if (WMUtils::isRunningX11() || WMUtils::isRunningWayland()) {
-        // Use a separate thread to temporarily initialize SDL
-        // video to avoid stomping on Qt's X11 and OGL state.
-        QuerySdlVideoThread thread(this);
-        thread.start();
-        thread.wait();
-    }
-    else {
-        querySdlVideoInfoInternal();
-    }
-}
-
 void SystemProperties::querySdlVideoInfoInternal()
 {
     hasHardwareAcceleration = false;
@@ -180,6 +323,9 @@ public:
 
 void SystemProperties::refreshDisplays()
 {
+    // Don't race with the initial queries
+    waitForSdlQueries();
+
     if (WMUtils::isRunningX11() || WMUtils::isRunningWayland()) {
         // Use a separate thread to temporarily initialize SDL
         // video to avoid stomping on Qt's X11 and OGL state.
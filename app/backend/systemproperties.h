@@ -7,14 +7,21 @@ class SystemProperties : public QObject
 {
     Q_OBJECT
 
-    friend class QuerySdlVideoThread;
+    friend class QuerySdlInfoThread;
     friend class RefreshDisplaysThread;
 
 public:
     SystemProperties();
 
-    Q_PROPERTY(bool hasHardwareAcceleration MEMBER hasHardwareAcceleration CONSTANT)
-    Q_PROPERTY(bool rendererAlwaysFullScreen MEMBER rendererAlwaysFullScreen CONSTANT)
+    virtual ~SystemProperties();
+
+    // Creating this early lets the SDL queries run while QML is loading
+    static SystemProperties* get();
+
+    // Properties that require SDL are computed on a background thread where
+    // possible. Reading them blocks until they're available.
+    Q_PROPERTY(bool hasHardwareAcceleration READ getHasHardwareAcceleration NOTIFY videoInfoChanged)
+    Q_PROPERTY(bool rendererAlwaysFullScreen READ getRendererAlwaysFullScreen NOTIFY videoInfoChanged)
     Q_PROPERTY(bool isRunningWayland MEMBER isRunningWayland CONSTANT)
     Q_PROPERTY(bool isRunningXWayland MEMBER isRunningXWayland CONSTANT)
     Q_PROPERTY(bool isWow64 MEMBER isWow64 CONSTANT)
@@ -22,10 +29,10 @@ public:
     Q_PROPERTY(bool hasDesktopEnvironment MEMBER hasDesktopEnvironment CONSTANT)
     Q_PROPERTY(bool hasBrowser MEMBER hasBrowser CONSTANT)
     Q_PROPERTY(bool hasDiscordIntegration MEMBER hasDiscordIntegration CONSTANT)
-    Q_PROPERTY(QString unmappedGamepads MEMBER unmappedGamepads NOTIFY unmappedGamepadsChanged)
-    Q_PROPERTY(QSize maximumResolution MEMBER maximumResolution CONSTANT)
+    Q_PROPERTY(QString unmappedGamepads READ getUnmappedGamepads NOTIFY unmappedGamepadsChanged)
+    Q_PROPERTY(QSize maximumResolution READ getMaximumResolution NOTIFY videoInfoChanged)
     Q_PROPERTY(QString versionString MEMBER versionString CONSTANT)
-    Q_PROPERTY(bool supportsHdr MEMBER supportsHdr CONSTANT)
+    Q_PROPERTY(bool supportsHdr READ getSupportsHdr NOTIFY videoInfoChanged)
     Q_PROPERTY(bool usesMaterial3Theme MEMBER usesMaterial3Theme CONSTANT)
 
     Q_INVOKABLE void refreshDisplays();
@@ -33,14 +40,43 @@ public:
     Q_INVOKABLE QRect getSafeAreaResolution(int displayIndex);
     Q_INVOKABLE int getRefreshRate(int displayIndex);
 
+    // Returns true while the SDL queries are running on another thread.
+    // SDL must not be used on the main thread until sdlQueriesFinished()
+    // is emitted.
+    Q_INVOKABLE bool isSdlQueryRunning();
+
+    // Blocks until the SDL queries are complete, running them on the
+    // calling thread if they weren't started in the background
+    void waitForSdlQueries();
+
+    // Blocks until SDL is no longer in use by the background query thread,
+    // if there is one. This must be called on the main thread before any
+    // other code initializes or quits SDL subsystems.
+    static void waitForBackgroundSdlQueries();
+
 signals:
     void unmappedGamepadsChanged();
+    void videoInfoChanged();
+    void sdlQueriesFinished();
+
+private slots:
+    void handleSdlQueriesFinished();
 
 private:
-    void querySdlVideoInfo();
+    bool getHasHardwareAcceleration();
+    bool getRendererAlwaysFullScreen();
+    QString getUnmappedGamepads();
+    QSize getMaximumResolution();
+    bool getSupportsHdr();
+
+    void querySdlInfoInternal();
     void querySdlVideoInfoInternal();
     void refreshDisplaysInternal();
 
+    QThread* m_SdlQueryThread;
+    bool m_SdlQueriesComplete;
+    static SystemProperties* s_SystemProperties;
+
     bool hasHardwareAcceleration;
     bool rendererAlwaysFullScreen;
     bool isRunningWayland;
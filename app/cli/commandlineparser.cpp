@@ -38,6 +38,9 @@ public:
         setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
         addHelpOption();
         addVersionOption();
+
+        // Handled by StartupTracer before we get here
+        addOption(QCommandLineOption("trace-startup", "Write a timeline of startup phases to the log directory."));
     }
 
     void handleHelpAndVersionOptions()
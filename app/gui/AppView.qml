@@ -77,9 +77,23 @@ CenteredGridView {
         property alias appContextMenu: appContextMenuLoader.item
         property alias appNameText: appNameTextLoader.item
 
+        property int appId: model.appid
+
         // Dim the app if it's hidden
         opacity: model.hidden ? 0.4 : 1.0
 
+        // Fetch box art while this tile exists, but don't keep
+        // fetching it for tiles scrolled out of view
+        Component.onCompleted: {
+            appModel.requestBoxArtLoad(appId)
+        }
+
+        Component.onDestruction: {
+            if (appModel) {
+                appModel.cancelBoxArtLoad(appId)
+            }
+        }
+
         Image {
             property bool isPlaceholder: false
 
@@ -84,7 +84,7 @@ QVariant AppModel::data(const QModelIndex &index, int role) const
         return m_Computer->currentGameId == app.id;
     case BoxArtRole:
         // FIXME: const-correctness
-        return const_cast<BoxArtManager&>(m_BoxArtManager).loadBoxArt(m_Computer, app);
+        return const_cast<BoxArtManager&>(m_BoxArtManager).getBoxArt(m_Computer, app.id);
     case HiddenRole:
         return app.hidden;
     case AppIdRole:
@@ -250,6 +250,21 @@ void AppModel::setAppDirectLaunch(int appIndex, bool directLaunch)
     m_ComputerManager->clientSideAttributeUpdated(m_Computer);
 }
 
+void AppModel::requestBoxArtLoad(int appId)
+{
+    for (NvApp& app : m_VisibleApps) {
+        if (app.id == appId) {
+            m_BoxArtManager.requestBoxArtLoad(m_Computer, app);
+            break;
+        }
+    }
+}
+
+void AppModel::cancelBoxArtLoad(int appId)
+{
+    m_BoxArtManager.cancelBoxArtLoad(m_Computer, appId);
+}
+
 void AppModel::handleComputerStateChanged(NvComputer* computer)
 {
     // Ignore updates for computers that aren't ours
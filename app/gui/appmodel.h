@@ -41,6 +41,10 @@ public:
 
     Q_INVOKABLE void setAppDirectLaunch(int appIndex, bool directLaunch);
 
+    Q_INVOKABLE void requestBoxArtLoad(int appId);
+
+    Q_INVOKABLE void cancelBoxArtLoad(int appId);
+
     QVariant data(const QModelIndex &index, int role) const override;
 
     int rowCount(const QModelIndex &parent) const override;
@@ -31,7 +31,33 @@ ApplicationWindow {
             Material.background = "#303030"
         }
 
-        SdlGamepadKeyNavigation.enable()
+        // SystemProperties may still be using SDL on another thread. Rather
+        // than blocking the UI on it, enable gamepad navigation when it's done.
+        if (SystemProperties.isSdlQueryRunning()) {
+            SystemProperties.sdlQueriesFinished.connect(SdlGamepadKeyNavigation.enable)
+        }
+        else {
+            SdlGamepadKeyNavigation.enable()
+        }
+    }
+
+    function showConfigurationWarnings() {
+        if (SystemProperties.isWow64) {
+            wow64Dialog.open()
+        }
+        else if (!SystemProperties.hasHardwareAcceleration && StreamingPreferences.videoDecoderSelection !== StreamingPreferences.VDS_FORCE_SOFTWARE) {
+            if (SystemProperties.isRunningXWayland) {
+                xWaylandDialog.open()
+            }
+            else {
+                noHwDecoderDialog.open()
+            }
+        }
+
+        if (SystemProperties.unmappedGamepads) {
+            unmappedGamepadDialog.unmappedGamepads = SystemProperties.unmappedGamepads
+            unmappedGamepadDialog.open()
+        }
     }
 
     Component.onCompleted: {
@@ -50,22 +76,13 @@ ApplicationWindow {
             window.showFullScreen()
         }
 
-        // Display any modal dialogs for configuration warnings
-        if (SystemProperties.isWow64) {
-            wow64Dialog.open()
-        }
-        else if (!SystemProperties.hasHardwareAcceleration && StreamingPreferences.videoDecoderSelection !== StreamingPreferences.VDS_FORCE_SOFTWARE) {
-            if (SystemProperties.isRunningXWayland) {
-                xWaylandDialog.open()
-            }
-            else {
-                noHwDecoderDialog.open()
-            }
+        // Display any modal dialogs for configuration warnings. These read
+        // SDL properties, so don't block on them if the queries are running.
+        if (SystemProperties.isSdlQueryRunning()) {
+            SystemProperties.sdlQueriesFinished.connect(showConfigurationWarnings)
         }
-
-        if (SystemProperties.unmappedGamepads) {
-            unmappedGamepadDialog.unmappedGamepads = SystemProperties.unmappedGamepads
-            unmappedGamepadDialog.open()
+        else {
+            showConfigurationWarnings()
         }
     }
   
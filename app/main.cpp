@@ -3,6 +3,7 @@
 #include <QQmlContext>
 #include <QIcon>
 #include <QQuickStyle>
+#include <QQuickWindow>
 #include <QMutex>
 #include <QtDebug>
 #include <QNetworkProxyFactory>
@@ -11,7 +12,10 @@
 #include <QCursor>
 #include <QElapsedTimer>
 #include <QTemporaryFile>
-#include <QRegularExpression>
+#include <QSemaphore>
+#include <QThread>
+
+#include <atomic>
 
 // Don't let SDL hook our main function, since Qt is already
 // doing the same thing. This needs to be before any headers
@@ -38,10 +42,12 @@
 #include "cli/pair.h"
 #include "cli/commandlineparser.h"
 #include "path.h"
+#include "startuptracer.h"
 #include "utils.h"
 #include "gui/computermodel.h"
 #include "gui/appmodel.h"
 #include "backend/autoupdatechecker.h"
+#include "backend/boxartmanager.h"
 #include "backend/computermanager.h"
 #include "backend/systemproperties.h"
 #include "streaming/session.h"
@@ -60,12 +66,66 @@
 // Log to console for debug Mac builds
 #endif
 
+// Log messages are copied into a ring of preallocated records by whichever
+// thread logs them, then written out in batches by a single logger thread.
+// Messages that don't fit in a record are truncated and messages that don't
+// fit in the ring are dropped (and counted) rather than blocking the caller.
+#define LOG_RECORD_SIZE 2048
+#define LOG_RECORD_COUNT 512 // Must be a power of 2
+
+struct LogRecord {
+    // Equal to the enqueue position when free and one past it when filled
+    std::atomic<uint32_t> sequence;
+    int length;
+    char text[LOG_RECORD_SIZE];
+};
+
+class LoggerThread : public QThread
+{
+public:
+    LoggerThread() : m_Stopping(false), m_Sleeping(false) {}
+
+    // main() stops this before returning normally, but the command line
+    // parser and some error paths leave via exit() or an early return.
+    // Static destruction still runs then, so flush what's left here.
+    ~LoggerThread()
+    {
+        if (isRunning()) {
+            stop();
+        }
+    }
+
+    void wake()
+    {
+        if (m_Sleeping.exchange(false)) {
+            m_WakeSemaphore.release();
+        }
+    }
+
+    void stop()
+    {
+        m_Stopping = true;
+        m_WakeSemaphore.release();
+        wait();
+    }
+
+protected:
+    void run() override;
+
+private:
+    std::atomic<bool> m_Stopping;
+    std::atomic<bool> m_Sleeping;
+    QSemaphore m_WakeSemaphore;
+};
+
 static QElapsedTimer s_LoggerTime;
 static QTextStream s_LoggerStream(stderr);
-static QThreadPool s_LoggerThread;
+static LoggerThread s_LoggerThread;
 static bool s_SuppressVerboseOutput;
-static QRegularExpression k_RikeyRegex("&rikey=\\w+");
-static QRegularExpression k_RikeyIdRegex("&rikeyid=[\\d-]+");
+static LogRecord s_LogRecords[LOG_RECORD_COUNT];
+static std::atomic<uint32_t> s_LogEnqueuePosition;
+static uint32_t s_LogDequeuePosition; // Only accessed by the logger thread
+static std::atomic<uint32_t> s_LogMessagesDropped;
 #ifdef LOG_TO_FILE
 // Max log file size of 10 MB
 static const uint64_t k_MaxLogSizeBytes = 10 * 1024 * 1024;
@@ -73,32 +133,103 @@ static QAtomicInteger<uint64_t> s_LogBytesWritten = 0;
 static QFile* s_LoggerFile;
 #endif
 
-class LoggerTask : public QRunnable
+void LoggerThread::run()
 {
-public:
-    LoggerTask(const QString& msg) : m_Msg(msg)
-    {
-        setAutoDelete(true);
+    QByteArray batch;
+
+    for (;;) {
+        bool stopping = m_Stopping;
+
+        // Collect everything that's queued so it can be written at once
+        for (;;) {
+            LogRecord* record = &s_LogRecords[s_LogDequeuePosition % LOG_RECORD_COUNT];
+            if (record->sequence.load(std::memory_order_acquire) != s_LogDequeuePosition + 1) {
+                break;
+            }
+
+            batch.append(record->text, record->length);
+
+            // Hand the record back to the producers for the next trip around the ring
+            record->sequence.store(s_LogDequeuePosition + LOG_RECORD_COUNT, std::memory_order_release);
+            s_LogDequeuePosition++;
+        }
+
+        uint32_t dropped = s_LogMessagesDropped.exchange(0);
+        if (dropped != 0) {
+            batch.append(QByteArray::number(dropped));
+            batch.append(" log messages were dropped because the log buffer was full\n");
+        }
+
+        if (!batch.isEmpty()) {
+            s_LoggerStream << QString::fromUtf8(batch);
+            s_LoggerStream.flush();
+            batch.clear();
+        }
+
+        if (stopping) {
+            break;
+        }
+
+        // Sleep until a producer wakes us. If a message was queued after we
+        // drained the ring but before producers could see that we're asleep,
+        // go around again rather than waiting for the timeout.
+        m_Sleeping = true;
+        LogRecord* next = &s_LogRecords[s_LogDequeuePosition % LOG_RECORD_COUNT];
+        if (next->sequence.load(std::memory_order_acquire) == s_LogDequeuePosition + 1 && m_Sleeping.exchange(false)) {
+            continue;
+        }
+        m_WakeSemaphore.tryAcquire(1, 100);
+        m_Sleeping = false;
     }
+}
 
-    void run() override
-    {
-        s_LoggerStream << m_Msg;
-        s_LoggerStream.flush();
+// Copies text into buffer with session encryption keys and IVs stripped.
+// Returns the length of the result.
+static int redactLogMessage(const char* text, int length, char* buffer, int bufferLength)
+{
+    static const struct {
+        const char* param;
+        const char* allowedChars;
+    } k_RedactedParams[] = {
+        { "&rikey=", "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_" },
+        { "&rikeyid=", "0123456789-" },
+    };
+
+    int outLength = 0;
+    int i = 0;
+    while (i < length && outLength < bufferLength) {
+        bool redacted = false;
+
+        for (const auto& redactedParam : k_RedactedParams) {
+            int paramLength = (int)strlen(redactedParam.param);
+            if (length - i >= paramLength && memcmp(&text[i], redactedParam.param, paramLength) == 0) {
+                i += paramLength;
+                i += (int)strspn(&text[i], redactedParam.allowedChars);
+
+                outLength += snprintf(&buffer[outLength], bufferLength - outLength,
+                                      "%sREDACTED", redactedParam.param);
+                outLength = qMin(outLength, bufferLength - 1);
+                redacted = true;
+                break;
+            }
+        }
+
+        if (!redacted) {
+            buffer[outLength++] = text[i++];
+        }
     }
 
-private:
-    QString m_Msg;
-};
+    return outLength;
+}
 
-void logToLoggerStream(QString& message)
+void logToLoggerStream(const char* text, int length)
 {
 #if defined(QT_DEBUG) && defined(Q_OS_WIN32)
     // Output log messages to a debugger if attached
     if (IsDebuggerPresent()) {
         static QString lineBuffer;
-        lineBuffer += message;
-        if (message.endsWith('\n')) {
+        lineBuffer += QString::fromUtf8(text, length);
+        if (lineBuffer.endsWith('\n')) {
             OutputDebugStringW(lineBuffer.toStdWString().c_str());
             lineBuffer.clear();
         }
@@ -106,34 +237,87 @@ void logToLoggerStream(QString& message)
 #endif
 
     // Strip session encryption keys and IVs from the logs
-    message.replace(k_RikeyRegex, "&rikey=REDACTED");
-    message.replace(k_RikeyIdRegex, "&rikeyid=REDACTED");
+    char redactedText[LOG_RECORD_SIZE];
+    if (strstr(text, "&rikey") != nullptr) {
+        length = redactLogMessage(text, length, redactedText, sizeof(redactedText));
+        text = redactedText;
+    }
 
 #ifdef LOG_TO_FILE
-    auto oldLogSize = s_LogBytesWritten.fetchAndAddRelaxed(message.size());
+    auto oldLogSize = s_LogBytesWritten.fetchAndAddRelaxed(length);
     if (oldLogSize >= k_MaxLogSizeBytes) {
         return;
     }
-    else if (oldLogSize >= k_MaxLogSizeBytes - message.size()) {
-        s_LoggerThread.waitForDone();
-        s_LoggerStream << "Log size limit reached!";
-#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
-        s_LoggerStream << Qt::endl;
-#else
-        s_LoggerStream << endl;
-#endif
-        s_LoggerStream.flush();
-        return;
+    else if (oldLogSize >= k_MaxLogSizeBytes - length) {
+        static const char k_LogLimitMessage[] = "Log size limit reached!\n";
+        text = k_LogLimitMessage;
+        length = sizeof(k_LogLimitMessage) - 1;
     }
 #endif
 
-    // Queue the log message to be written asynchronously
-    s_LoggerThread.start(new LoggerTask(message));
+    length = qMin(length, LOG_RECORD_SIZE);
+
+    // Claim the next free record in the ring
+    LogRecord* record;
+    uint32_t position = s_LogEnqueuePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        record = &s_LogRecords[position % LOG_RECORD_COUNT];
+        int32_t diff = (int32_t)(record->sequence.load(std::memory_order_acquire) - position);
+        if (diff == 0) {
+            if (s_LogEnqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            // The logger thread hasn't written this record out yet
+            s_LogMessagesDropped++;
+            s_LoggerThread.wake();
+            return;
+        }
+        else {
+            position = s_LogEnqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    memcpy(record->text, text, length);
+    record->length = length;
+    record->sequence.store(position + 1, std::memory_order_release);
+
+    s_LoggerThread.wake();
+}
+
+// Formats a log message into buffer, ending it with a newline if it was truncated.
+// Returns the length of the message.
+static int formatLogMessage(char* buffer, int length, const char* format, ...)
+{
+    va_list ap;
+
+    va_start(ap, format);
+    int ret = vsnprintf(buffer, length, format, ap);
+    va_end(ap);
+
+    if (ret < 0) {
+        buffer[0] = 0;
+        return 0;
+    }
+    else if (ret >= length) {
+        buffer[length - 2] = '\n';
+        return length - 1;
+    }
+
+    return ret;
+}
+
+static void getLogTime(char* buffer, int length)
+{
+    qint64 elapsedSecs = s_LoggerTime.elapsed() / 1000;
+    snprintf(buffer, length, "%02d:%02d:%02d",
+             (int)(elapsedSecs / 3600 % 24), (int)(elapsedSecs / 60 % 60), (int)(elapsedSecs % 60));
 }
 
 void sdlLogToDiskHandler(void*, int category, SDL_LogPriority priority, const char* message)
 {
-    QString priorityTxt;
+    const char* priorityTxt;
 
     switch (priority) {
     case SDL_LOG_PRIORITY_VERBOSE:
@@ -171,15 +355,17 @@ void sdlLogToDiskHandler(void*, int category, SDL_LogPriority priority, const ch
         break;
     }
 
-    QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-    QString txt = QString("%1 - SDL %2 (%3): %4\n").arg(logTime.toString()).arg(priorityTxt).arg(category).arg(message);
+    char logTime[16];
+    char txt[LOG_RECORD_SIZE];
+    getLogTime(logTime, sizeof(logTime));
+    int length = formatLogMessage(txt, sizeof(txt), "%s - SDL %s (%d): %s\n", logTime, priorityTxt, category, message);
 
-    logToLoggerStream(txt);
+    logToLoggerStream(txt, length);
 }
 
 void qtLogToDiskHandler(QtMsgType type, const QMessageLogContext&, const QString& msg)
 {
-    QString typeTxt;
+    const char* typeTxt = "";
 
     switch (type) {
     case QtDebugMsg:
@@ -208,10 +394,12 @@ void qtLogToDiskHandler(QtMsgType type, const QMessageLogContext&, const QString
         break;
     }
 
-    QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-    QString txt = QString("%1 - Qt %2: %3\n").arg(logTime.toString()).arg(typeTxt).arg(msg);
+    char logTime[16];
+    char txt[LOG_RECORD_SIZE];
+    getLogTime(logTime, sizeof(logTime));
+    int length = formatLogMessage(txt, sizeof(txt), "%s - Qt %s: %s\n", logTime, typeTxt, msg.toUtf8().constData());
 
-    logToLoggerStream(txt);
+    logToLoggerStream(txt, length);
 }
 
 #ifdef HAVE_FFMPEG
@@ -236,13 +424,14 @@ void ffmpegLogToDiskHandler(void* ptr, int level, const char* fmt, va_list vl)
     av_log_format_line(ptr, level, fmt, vl, lineBuffer, sizeof(lineBuffer), &printPrefix);
 
     if (shouldPrefixThisMessage) {
-        QTime logTime = QTime::fromMSecsSinceStartOfDay(s_LoggerTime.elapsed());
-        QString txt = QString("%1 - FFmpeg: %2").arg(logTime.toString()).arg(lineBuffer);
-        logToLoggerStream(txt);
+        char logTime[16];
+        char txt[LOG_RECORD_SIZE];
+        getLogTime(logTime, sizeof(logTime));
+        int length = formatLogMessage(txt, sizeof(txt), "%s - FFmpeg: %s", logTime, lineBuffer);
+        logToLoggerStream(txt, length);
     }
     else {
-        QString txt = QString(lineBuffer);
-        logToLoggerStream(txt);
+        logToLoggerStream(lineBuffer, (int)strlen(lineBuffer));
     }
 }
 
@@ -308,6 +497,9 @@ int main(int argc, char *argv[])
 {
     SDL_SetMainReady();
 
+    // Start the startup timeline before we do anything else
+    StartupTracer::initialize(argc, argv);
+
     // Set the app version for the QCommandLineParser's showVersion() command
     QCoreApplication::setApplicationVersion(VERSION_STR);
 
@@ -342,6 +534,8 @@ int main(int argc, char *argv[])
     HANDLE oldConErr = GetStdHandle(STD_ERROR_HANDLE);
 #endif
 
+    STARTUP_TRACE_BEGIN("Logger setup");
+
 #ifdef LOG_TO_FILE
     QDir tempDir(Path::getLogDir());
 
@@ -359,8 +553,11 @@ int main(int argc, char *argv[])
 #endif
 
     // Serialize log messages on a single thread
-    s_LoggerThread.setMaxThreadCount(1);
+    for (uint32_t i = 0; i < LOG_RECORD_COUNT; i++) {
+        s_LogRecords[i].sequence = i;
+    }
     s_LoggerTime.start();
+    s_LoggerThread.start();
 
     // Register our logger with all libraries
 #if SDL_VERSION_ATLEAST(3, 0, 0)
@@ -381,6 +578,8 @@ int main(int argc, char *argv[])
     SetUnhandledExceptionFilter(UnhandledExceptionHandler);
 #endif
 
+    STARTUP_TRACE_END("Logger setup");
+
 #ifdef LOG_TO_FILE
     // Prune the oldest existing logs if there are more than 10
     QStringList existingLogNames = tempDir.entryList(QStringList("Moonlight-*.log"), QDir::NoFilter, QDir::SortFlag::Time);
@@ -522,6 +721,8 @@ int main(int argc, char *argv[])
     // The DXVA2 renderer uses Direct3D 9Ex itself directly.
     SDL_SetHint(SDL_HINT_WINDOWS_USE_D3D9EX, "1");
 
+    STARTUP_TRACE_BEGIN("SDL init");
+
     if (SDL_InitSubSystem(SDL_INIT_TIMER) != 0) {
         SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
                      "SDL_InitSubSystem(SDL_INIT_TIMER) failed: %s",
@@ -544,6 +745,8 @@ int main(int argc, char *argv[])
     // racing with object destruction where SDL may be used.
     atexit(SDL_Quit);
 
+    STARTUP_TRACE_END("SDL init");
+
     // Avoid the default behavior of changing the timer resolution to 1 ms.
     // We don't want this all the time that Moonlight is open. We will set
     // it manually when we start streaming.
@@ -585,7 +788,9 @@ int main(int argc, char *argv[])
     SDL_SetHint(SDL_HINT_WINDOWS_DISABLE_THREAD_NAMING, "0");
 #endif
 
+    STARTUP_TRACE_BEGIN("QGuiApplication init");
     QGuiApplication app(argc, argv);
+    STARTUP_TRACE_END("QGuiApplication init");
 
 #ifndef STEAM_LINK
     // Force use of the KMSDRM backend for SDL when using Qt platform plugins
@@ -715,7 +920,7 @@ int main(int argc, char *argv[])
     qmlRegisterSingletonType<SystemProperties>("SystemProperties", 1, 0,
                                                "SystemProperties",
                                                [](QQmlEngine*, QJSEngine*) -> QObject* {
-                                                   return new SystemProperties();
+                                                   return SystemProperties::get();
                                                });
     qmlRegisterSingletonType<SdlGamepadKeyNavigation>("SdlGamepadKeyNavigation", 1, 0,
                                                       "SdlGamepadKeyNavigation",
@@ -797,10 +1002,35 @@ int main(int argc, char *argv[])
     if (hasGUI) {
         engine.rootContext()->setContextProperty("initialView", initialView);
 
+        // The engine takes ownership of the image provider
+        engine.addImageProvider("boxart", new BoxArtImageProvider());
+
+        // Start querying SDL in the background while we load the UI
+        STARTUP_TRACE_BEGIN("SystemProperties");
+        SystemProperties::get();
+        STARTUP_TRACE_END("SystemProperties");
+
         // Load the main.qml file
+        STARTUP_TRACE_BEGIN("QML engine load");
         engine.load(QUrl(QStringLiteral("qrc:/gui/main.qml")));
+        STARTUP_TRACE_END("QML engine load");
         if (engine.rootObjects().isEmpty())
             return -1;
+
+        if (StartupTracer::isEnabled()) {
+            // The app timeline ends once the UI is actually on screen
+            QQuickWindow* window = qobject_cast<QQuickWindow*>(engine.rootObjects().first());
+            if (window != nullptr) {
+                QObject::connect(window, &QQuickWindow::frameSwapped, window, []() {
+                    // Only the first frame is recorded. Later calls do nothing.
+                    STARTUP_TRACE_FINISH("app", "First UI frame");
+                });
+            }
+        }
+    }
+    else {
+        // There's no UI to wait for
+        STARTUP_TRACE_FINISH("app", "Startup complete");
     }
 
     int err = app.exec();
@@ -821,7 +1051,7 @@ int main(int argc, char *argv[])
 #endif
 
     // Wait for pending log messages to be printed
-    s_LoggerThread.waitForDone();
+    s_LoggerThread.stop();
 
 #ifdef Q_OS_WIN32
     // Without an explicit flush, console redirection for the list command
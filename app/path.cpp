@@ -10,6 +10,7 @@ QString Path::s_CacheDir;
 QString Path::s_LogDir;
 QString Path::s_BoxArtCacheDir;
 QString Path::s_QmlCacheDir;
+QString Path::s_DataDir;
 
 QString Path::getLogDir()
 {
@@ -29,6 +30,12 @@ QString Path::getQmlCacheDir()
     return s_QmlCacheDir;
 }
 
+QString Path::getDataDir()
+{
+    Q_ASSERT(!s_DataDir.isEmpty());
+    return s_DataDir;
+}
+
 QByteArray Path::readDataFile(QString fileName)
 {
     QFile dataFile(getDataFilePath(fileName));
@@ -105,6 +112,7 @@ void Path::initialize(bool portable)
         s_LogDir = QDir::currentPath();
         s_BoxArtCacheDir = QDir::currentPath() + "/boxart";
         s_QmlCacheDir = QDir::currentPath() + "/qmlcache";
+        s_DataDir = QDir::currentPath();
 
         // In order for the If-Modified-Since logic to work in MappingFetcher,
         // the cache directory must be different than the current directory.
@@ -121,5 +129,8 @@ void Path::initialize(bool portable)
         s_CacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
         s_BoxArtCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/boxart";
         s_QmlCacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/qmlcache";
+
+        // Unlike the cache, this must not be cleared by the OS
+        s_DataDir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
     }
 }
@@ -41,6 +41,8 @@
 #define SER_GAMEPADMOUSE "gamepadmouse"
 #define SER_DEFAULTVER "defaultver"
 #define SER_PACKETSIZE "packetsize"
+#define SER_DECODERKEEPWARM "decoderkeepwarm"
+#define SER_GAMEPADMAXSENDRATE "gamepadmaxsendrate"
 #define SER_DETECTNETBLOCKING "detectnetblocking"
 #define SER_SHOWPERFOVERLAY "showperfoverlay"
 #define SER_SWAPMOUSEBUTTONS "swapmousebuttons"
@@ -141,6 +143,8 @@ void StreamingPreferences::reload()
     detectNetworkBlocking = settings.value(SER_DETECTNETBLOCKING, true).toBool();
     showPerformanceOverlay = settings.value(SER_SHOWPERFOVERLAY, false).toBool();
     packetSize = settings.value(SER_PACKETSIZE, 0).toInt();
+    decoderKeepWarmSecs = settings.value(SER_DECODERKEEPWARM, 0).toInt();
+    gamepadMaxSendRate = settings.value(SER_GAMEPADMAXSENDRATE, 0).toInt();
     swapMouseButtons = settings.value(SER_SWAPMOUSEBUTTONS, false).toBool();
     muteOnFocusLoss = settings.value(SER_MUTEONFOCUSLOSS, false).toBool();
     backgroundGamepad = settings.value(SER_BACKGROUNDGAMEPAD, false).toBool();
@@ -337,6 +341,8 @@ void StreamingPreferences::save()
     settings.setValue(SER_RICHPRESENCE, richPresence);
     settings.setValue(SER_GAMEPADMOUSE, gamepadMouse);
     settings.setValue(SER_PACKETSIZE, packetSize);
+    settings.setValue(SER_DECODERKEEPWARM, decoderKeepWarmSecs);
+    settings.setValue(SER_GAMEPADMAXSENDRATE, gamepadMaxSendRate);
     settings.setValue(SER_DETECTNETBLOCKING, detectNetworkBlocking);
     settings.setValue(SER_SHOWPERFOVERLAY, showPerformanceOverlay);
     settings.setValue(SER_AUDIOCFG, static_cast<int>(audioConfig));
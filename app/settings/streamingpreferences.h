@@ -177,6 +177,8 @@ public:
     bool swapFaceButtons;
     bool keepAwake;
     int packetSize;
+    int decoderKeepWarmSecs;
+    int gamepadMaxSendRate;
     AudioConfig audioConfig;
     VideoCodecConfig videoCodecConfig;
     bool enableHdr;
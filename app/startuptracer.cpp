@@ -0,0 +1,184 @@
+#include "startuptracer.h"
+#include "path.h"
+#include "traceeventwriter.h"
+
+#include <QDateTime>
+#include <QDir>
+
+#include <string.h>
+
+bool StartupTracer::s_Enabled = false;
+QAtomicInt StartupTracer::s_Recording;
+QElapsedTimer StartupTracer::s_Clock;
+QMutex StartupTracer::s_Lock;
+const char* StartupTracer::s_TimelineName = nullptr;
+qint64 StartupTracer::s_TimelineStartTime = 0;
+QVector<StartupTracer::Event> StartupTracer::s_Events;
+
+void StartupTracer::initialize(int argc, char* argv[])
+{
+    // We can't wait for the command line parser because it runs
+    // after most of the startup work we want to measure.
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace-startup") == 0 || strcmp(argv[i], "-trace-startup") == 0) {
+            s_Enabled = true;
+            break;
+        }
+    }
+
+    if (!s_Enabled) {
+        return;
+    }
+
+    s_Clock.start();
+    startTimeline("app");
+}
+
+void StartupTracer::startTimeline(const char* name)
+{
+    QMutexLocker lock(&s_Lock);
+
+    s_TimelineName = name;
+    s_TimelineStartTime = s_Clock.nsecsElapsed();
+    s_Events.clear();
+    s_Recording.storeRelease(1);
+}
+
+void StartupTracer::finishTimeline(const char* name, const char* eventName)
+{
+    // Avoid taking the lock on every frame once the timeline is written
+    if (s_Recording.loadAcquire() == 0) {
+        return;
+    }
+
+    QVector<Event> events;
+    qint64 startTime;
+
+    s_Lock.lock();
+    if (s_TimelineName == nullptr || strcmp(s_TimelineName, name) != 0) {
+        s_Lock.unlock();
+        return;
+    }
+
+    recordEvent('i', eventName);
+    events.swap(s_Events);
+    startTime = s_TimelineStartTime;
+    s_TimelineName = nullptr;
+    s_Recording.storeRelease(0);
+    s_Lock.unlock();
+
+    logTimeline(name, events, startTime);
+
+    QString fileName = QDir(Path::getLogDir()).filePath(QString("Moonlight-%1-%2.startup.json")
+                                                        .arg(QDateTime::currentSecsSinceEpoch())
+                                                        .arg(name));
+    writeTrace(fileName, events, startTime);
+}
+
+void StartupTracer::recordEvent(char phase, const char* name)
+{
+    // Caller must hold s_Lock
+    Event event;
+    event.timestamp = s_Clock.nsecsElapsed();
+    event.name = name;
+    event.threadId = SDL_ThreadID();
+    event.phase = phase;
+    s_Events.append(event);
+}
+
+void StartupTracer::beginPhase(const char* name)
+{
+    QMutexLocker lock(&s_Lock);
+    if (s_TimelineName != nullptr) {
+        recordEvent('B', name);
+    }
+}
+
+void StartupTracer::endPhase(const char* name)
+{
+    QMutexLocker lock(&s_Lock);
+    if (s_TimelineName != nullptr) {
+        recordEvent('E', name);
+    }
+}
+
+void StartupTracer::mark(const char* name)
+{
+    QMutexLocker lock(&s_Lock);
+    if (s_TimelineName != nullptr) {
+        recordEvent('i', name);
+    }
+}
+
+void StartupTracer::logTimeline(const char* name, const QVector<Event>& events, qint64 startTime)
+{
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Startup timeline '%s' took %.1f ms:",
+                name,
+                events.isEmpty() ? 0.0 : (events.last().timestamp - startTime) / 1000000.0);
+
+    int depth = 0;
+    for (int i = 0; i < events.size(); i++) {
+        const Event& event = events[i];
+        QByteArray indent(depth * 2, ' ');
+        double offsetMs = (event.timestamp - startTime) / 1000000.0;
+
+        if (event.phase == 'B') {
+            // Find the end of this phase on the same thread
+            const Event* end = nullptr;
+            for (int j = i + 1; j < events.size(); j++) {
+                if (events[j].phase == 'E' && events[j].threadId == event.threadId &&
+                        strcmp(events[j].name, event.name) == 0) {
+                    end = &events[j];
+                    break;
+                }
+            }
+
+            if (end != nullptr) {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "  %9.1f ms %s%s: %.1f ms",
+                            offsetMs, indent.constData(), event.name,
+                            (end->timestamp - event.timestamp) / 1000000.0);
+            }
+            else {
+                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                            "  %9.1f ms %s%s: unfinished",
+                            offsetMs, indent.constData(), event.name);
+            }
+
+            depth++;
+        }
+        else if (event.phase == 'E') {
+            depth = qMax(depth - 1, 0);
+        }
+        else {
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "  %9.1f ms %s%s",
+                        offsetMs, indent.constData(), event.name);
+        }
+    }
+}
+
+bool StartupTracer::writeTrace(const QString& fileName, const QVector<Event>& events, qint64 startTime)
+{
+    TraceEventWriter writer(fileName);
+    if (!writer.open()) {
+        return false;
+    }
+
+    for (const Event& event : events) {
+        writer.writeEvent(event.name, event.phase,
+                          (event.timestamp - startTime) / 1000.0,
+                          event.threadId, 0, 'p');
+    }
+
+    if (!writer.close()) {
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Wrote startup trace to %s",
+                qPrintable(QDir::toNativeSeparators(fileName)));
+
+    return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+
+#include "SDL_compat.h"
+
+// Records how long each phase of starting Moonlight and starting a stream
+// takes. Phases are grouped into timelines: "app" runs from process start
+// until the first UI frame is shown, and "stream" runs from launching a
+// stream until its first video frame is rendered. When a timeline finishes,
+// its phases are written to the log and as Chrome trace event JSON to the
+// log directory. The output can be loaded in chrome://tracing or
+// ui.perfetto.dev.
+//
+// Tracing is enabled by passing --trace-startup. When disabled, each
+// trace point costs a single branch on a global flag.
+class StartupTracer
+{
+public:
+    // Called first thing in main() so the app timeline covers all of startup
+    static void initialize(int argc, char* argv[]);
+
+    static bool isEnabled()
+    {
+        return s_Enabled;
+    }
+
+    // Starts recording a new timeline, discarding any unfinished one
+    static void startTimeline(const char* name);
+
+    // Records the event that ended the timeline and writes it out if it's
+    // the one being recorded. Later calls for the same timeline do nothing,
+    // so this can sit on a hot path.
+    static void finishTimeline(const char* name, const char* eventName);
+
+    // Phase names must be string literals (or otherwise outlive the timeline)
+    static void beginPhase(const char* name);
+    static void endPhase(const char* name);
+    static void mark(const char* name);
+
+private:
+    struct Event {
+        qint64 timestamp;
+        const char* name;
+        SDL_threadID threadId;
+        char phase;
+    };
+
+    static void recordEvent(char phase, const char* name);
+
+    static void logTimeline(const char* name, const QVector<Event>& events, qint64 startTime);
+
+    static bool writeTrace(const QString& fileName, const QVector<Event>& events, qint64 startTime);
+
+    static bool s_Enabled;
+    static QAtomicInt s_Recording;
+    static QElapsedTimer s_Clock;
+    static QMutex s_Lock;
+    static const char* s_TimelineName;
+    static qint64 s_TimelineStartTime;
+    static QVector<Event> s_Events;
+};
+
+#define STARTUP_TRACE_START(name) \
+    do { if (StartupTracer::isEnabled()) StartupTracer::startTimeline(name); } while (0)
+
+#define STARTUP_TRACE_FINISH(name, eventName) \
+    do { if (StartupTracer::isEnabled()) StartupTracer::finishTimeline(name, eventName); } while (0)
+
+#define STARTUP_TRACE_BEGIN(name) \
+    do { if (StartupTracer::isEnabled()) StartupTracer::beginPhase(name); } while (0)
+
+#define STARTUP_TRACE_END(name) \
+    do { if (StartupTracer::isEnabled()) StartupTracer::endPhase(name); } while (0)
+
+#define STARTUP_TRACE_MARK(name) \
+    do { if (StartupTracer::isEnabled()) StartupTracer::mark(name); } while (0)
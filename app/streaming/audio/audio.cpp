@@ -1,4 +1,5 @@
 #include "../session.h"
+#include "../frametracer.h"
 #include "renderers/renderer.h"
 
 #ifdef HAVE_SOUNDIO
@@ -213,6 +214,8 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
             return;
         }
 
+        FRAME_TRACE_THREAD_NAME("AudioDecode");
+        FRAME_TRACE_BEGIN("AudioDecode", sampleLength);
         if (s_ActiveSession->m_AudioRenderer->getAudioBufferFormat() == IAudioRenderer::AudioFormat::Float32NE) {
             samplesDecoded = opus_multistream_decode_float(s_ActiveSession->m_OpusDecoder,
                                                            (unsigned char*)sampleData,
@@ -229,6 +232,7 @@ void Session::arDecodeAndPlaySample(char* sampleData, int sampleLength)
                                                      desiredBufferSize / frameSize,
                                                      0);
         }
+        FRAME_TRACE_END("AudioDecode");
 
         // Update desiredSize with the number of bytes actually populated by the decoding operation
         if (samplesDecoded > 0) {
@@ -0,0 +1,215 @@
+#include "frametracer.h"
+#include "path.h"
+#include "traceeventwriter.h"
+
+#include <Limelight.h>
+
+#include <QDateTime>
+#include <QDir>
+
+// Number of events retained per thread. Must be a power of 2.
+// At 32 bytes per event, this is 4 MB per traced thread.
+#define EVENTS_PER_THREAD (1 << 17)
+
+SDL_atomic_t FrameTracer::s_Enabled;
+SDL_atomic_t FrameTracer::s_Generation;
+Uint64 FrameTracer::s_StartTime = 0;
+QMutex FrameTracer::s_BuffersLock;
+QVector<FrameTracer::ThreadBuffer*> FrameTracer::s_Buffers;
+
+// Owns the calling thread's reference to its buffer. Threads like the
+// Pacer's of a warm decoder outlive a session, so a buffer is only freed
+// once its thread has exited.
+struct FrameTracer::ThreadBufferRef {
+    ThreadBuffer* buffer = nullptr;
+
+    ~ThreadBufferRef()
+    {
+        if (buffer != nullptr) {
+            QMutexLocker lock(&s_BuffersLock);
+            buffer->threadExited = true;
+        }
+    }
+};
+
+void FrameTracer::startSession()
+{
+    SDL_assert(!isEnabled());
+
+    if (qEnvironmentVariableIntValue("FRAME_TRACE") == 0) {
+        return;
+    }
+
+    // Each thread discards its events from older sessions
+    // the next time it records an event.
+    SDL_AtomicIncRef(&s_Generation);
+
+    s_StartTime = SDL_GetPerformanceCounter();
+    SDL_AtomicSet(&s_Enabled, 1);
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Frame tracing enabled");
+}
+
+void FrameTracer::endSession()
+{
+    // Stop recording before we read out the buffers
+    if (SDL_AtomicSet(&s_Enabled, 0) == 0) {
+        return;
+    }
+
+    QString fileName = QDir(Path::getLogDir()).filePath(QString("Moonlight-%1.trace.json").arg(QDateTime::currentSecsSinceEpoch()));
+
+    QMutexLocker lock(&s_BuffersLock);
+    writeTrace(fileName);
+
+    // Free the buffers of threads that have exited. Threads that are still
+    // alive keep theirs, since they may still be in the middle of an event.
+    for (int i = s_Buffers.size() - 1; i >= 0; i--) {
+        ThreadBuffer* buffer = s_Buffers[i];
+        if (buffer->threadExited) {
+            delete[] buffer->events;
+            delete buffer;
+            s_Buffers.remove(i);
+        }
+    }
+}
+
+FrameTracer::ThreadBuffer* FrameTracer::getThreadBuffer()
+{
+    static thread_local ThreadBufferRef t_BufferRef;
+    ThreadBuffer* buffer = t_BufferRef.buffer;
+    int generation = SDL_AtomicGet(&s_Generation);
+
+    if (buffer == nullptr) {
+        buffer = new ThreadBuffer();
+        buffer->threadId = SDL_ThreadID();
+        buffer->threadName = nullptr;
+        buffer->threadExited = false;
+        buffer->generation = generation;
+        SDL_AtomicSet(&buffer->writeIndex, 0);
+        buffer->events = new Event[EVENTS_PER_THREAD];
+
+        QMutexLocker lock(&s_BuffersLock);
+        s_Buffers.append(buffer);
+        t_BufferRef.buffer = buffer;
+    }
+    else if (buffer->generation != generation) {
+        // Don't reset the buffer while it's being written out
+        QMutexLocker lock(&s_BuffersLock);
+        buffer->generation = generation;
+        SDL_AtomicSet(&buffer->writeIndex, 0);
+    }
+
+    return buffer;
+}
+
+void FrameTracer::recordEvent(char phase, const char* name, Uint64 timestamp, Uint64 duration, int arg)
+{
+    ThreadBuffer* buffer = getThreadBuffer();
+
+    // Only the owning thread writes to this buffer, so we just need
+    // to publish the new write index after the event is filled in.
+    int writeIndex = SDL_AtomicGet(&buffer->writeIndex);
+    Event& event = buffer->events[writeIndex & (EVENTS_PER_THREAD - 1)];
+    event.timestamp = timestamp;
+    event.duration = duration;
+    event.name = name;
+    event.arg = arg;
+    event.phase = phase;
+    SDL_AtomicSet(&buffer->writeIndex, writeIndex + 1);
+}
+
+void FrameTracer::setThreadName(const char* name)
+{
+    getThreadBuffer()->threadName = name;
+}
+
+void FrameTracer::beginEvent(const char* name, int arg)
+{
+    recordEvent('B', name, SDL_GetPerformanceCounter(), 0, arg);
+}
+
+void FrameTracer::endEvent(const char* name)
+{
+    recordEvent('E', name, SDL_GetPerformanceCounter(), 0, -1);
+}
+
+void FrameTracer::instantEvent(const char* name, int arg)
+{
+    recordEvent('i', name, SDL_GetPerformanceCounter(), 0, arg);
+}
+
+void FrameTracer::completeEvent(const char* name, Uint64 startTime, int arg)
+{
+    // Tracing may have been enabled after the caller took its timestamp
+    if (startTime == 0) {
+        return;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    recordEvent('X', name, startTime, now - startTime, arg);
+}
+
+void FrameTracer::completeEventMillis(const char* name, uint64_t startTimeMs, uint64_t endTimeMs, int arg)
+{
+    // Translate from the LiGetMillis() clock to the performance counter
+    Uint64 now = SDL_GetPerformanceCounter();
+    uint64_t nowMs = LiGetMillis();
+    Uint64 ticksPerMs = SDL_GetPerformanceFrequency() / 1000;
+
+    if (startTimeMs > endTimeMs || endTimeMs > nowMs) {
+        return;
+    }
+
+    Uint64 startTime = now - (nowMs - startTimeMs) * ticksPerMs;
+    recordEvent('X', name, startTime, (endTimeMs - startTimeMs) * ticksPerMs, arg);
+}
+
+bool FrameTracer::writeTrace(const QString& fileName)
+{
+    TraceEventWriter writer(fileName);
+    if (!writer.open()) {
+        return false;
+    }
+
+    double usPerTick = 1000000.0 / SDL_GetPerformanceFrequency();
+    int eventCount = 0;
+    int droppedCount = 0;
+
+    int generation = SDL_AtomicGet(&s_Generation);
+
+    for (const ThreadBuffer* buffer : s_Buffers) {
+        // Skip threads that haven't recorded anything this session
+        if (buffer->generation != generation) {
+            continue;
+        }
+
+        if (buffer->threadName != nullptr) {
+            writer.writeThreadName(buffer->threadId, buffer->threadName);
+        }
+
+        int writeIndex = SDL_AtomicGet(&buffer->writeIndex);
+        int count = qMin(writeIndex, EVENTS_PER_THREAD);
+        droppedCount += writeIndex - count;
+
+        for (int i = writeIndex - count; i < writeIndex; i++) {
+            const Event& event = buffer->events[i & (EVENTS_PER_THREAD - 1)];
+            writer.writeEvent(event.name, event.phase,
+                              (Sint64)(event.timestamp - s_StartTime) * usPerTick,
+                              buffer->threadId,
+                              event.duration * usPerTick,
+                              't', event.arg);
+            eventCount++;
+        }
+    }
+
+    bool success = writer.close();
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Wrote %d trace events (%d overwritten) to %s",
+                eventCount, droppedCount,
+                qPrintable(QDir::toNativeSeparators(fileName)));
+
+    return success;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QMutex>
+#include <QVector>
+
+#include "SDL_compat.h"
+
+// Records timestamped events from the streaming pipeline into a ring
+// buffer owned by each thread and writes them out as Chrome trace event
+// JSON when the session ends. The output can be loaded in chrome://tracing
+// or ui.perfetto.dev.
+//
+// Tracing is enabled by setting FRAME_TRACE=1. When disabled, each trace
+// point costs an atomic load and a branch on a global flag.
+class FrameTracer
+{
+public:
+    static void startSession();
+
+    static void endSession();
+
+    static bool isEnabled()
+    {
+        return SDL_AtomicGet(&s_Enabled) != 0;
+    }
+
+    // Returns 0 when tracing is disabled to avoid the syscall
+    static Uint64 now()
+    {
+        return isEnabled() ? SDL_GetPerformanceCounter() : 0;
+    }
+
+    static void setThreadName(const char* name);
+
+    // Event names must be string literals (or otherwise outlive the session)
+    static void beginEvent(const char* name, int arg);
+    static void endEvent(const char* name);
+    static void instantEvent(const char* name, int arg);
+    static void completeEvent(const char* name, Uint64 startTime, int arg);
+
+    // For spans measured with LiGetMillis() by moonlight-common-c
+    static void completeEventMillis(const char* name, uint64_t startTimeMs, uint64_t endTimeMs, int arg);
+
+private:
+    struct Event {
+        Uint64 timestamp;
+        Uint64 duration;
+        const char* name;
+        int arg;
+        char phase;
+    };
+
+    // Buffers are owned by s_Buffers and protected by s_BuffersLock,
+    // except that only the owning thread writes events.
+    struct ThreadBuffer {
+        SDL_threadID threadId;
+        const char* threadName;
+        bool threadExited;
+        int generation;
+        SDL_atomic_t writeIndex;
+        Event* events;
+    };
+
+    struct ThreadBufferRef;
+
+    static ThreadBuffer* getThreadBuffer();
+
+    static void recordEvent(char phase, const char* name, Uint64 timestamp, Uint64 duration, int arg);
+
+    static bool writeTrace(const QString& fileName);
+
+    static SDL_atomic_t s_Enabled;
+    static SDL_atomic_t s_Generation;
+    static Uint64 s_StartTime;
+    static QMutex s_BuffersLock;
+    static QVector<ThreadBuffer*> s_Buffers;
+};
+
+#define FRAME_TRACE_THREAD_NAME(name) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::setThreadName(name); } while (0)
+
+#define FRAME_TRACE_BEGIN(name, arg) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::beginEvent(name, arg); } while (0)
+
+#define FRAME_TRACE_END(name) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::endEvent(name); } while (0)
+
+#define FRAME_TRACE_INSTANT(name, arg) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::instantEvent(name, arg); } while (0)
+
+#define FRAME_TRACE_COMPLETE(name, startTime, arg) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::completeEvent(name, startTime, arg); } while (0)
+
+#define FRAME_TRACE_COMPLETE_MS(name, startTimeMs, endTimeMs, arg) \
+    do { if (FrameTracer::isEnabled()) FrameTracer::completeEventMillis(name, startTimeMs, endTimeMs, arg); } while (0)
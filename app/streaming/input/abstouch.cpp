@@ -132,12 +132,14 @@ void SdlInputHandler::handleAbsoluteFingerEvent(SDL_TouchFingerEvent* event)
         if (isPen) {
             LiSendPenEvent(eventType, LI_TOOL_TYPE_PEN, 0, vidrelx / dst.w, vidrely / dst.h, event->pressure,
                            0.0f, 0.0f, LI_ROT_UNKNOWN, LI_TILT_UNKNOWN);
+            recordInputSend(InputClassTouch, event->timestamp);
         }
         else
 #endif
         {
             LiSendTouchEvent(eventType, pointerId, vidrelx / dst.w, vidrely / dst.h, event->pressure,
                              0.0f, 0.0f, LI_ROT_UNKNOWN);
+            recordInputSend(InputClassTouch, event->timestamp);
         }
 
         if (!m_DisabledTouchFeedback) {
@@ -201,6 +203,7 @@ void SdlInputHandler::emulateAbsoluteFingerEvent(SDL_TouchFingerEvent* event)
 
         // Update the cursor position relative to the video region
         LiSendMousePositionEvent(x - dst.x, y - dst.y, dst.w, dst.h);
+        recordInputSend(InputClassTouch, event->timestamp);
     }
 
     if (event->type == SDL_FINGERDOWN) {
@@ -18,6 +18,16 @@
 // Determines the maximum motion amount before allowing movement
 #define MOUSE_EMULATION_DEADZONE 2
 
+// Motion samples that differ from the last one sent by less than these
+// amounts on every axis are only sent once per refresh interval. This
+// filters out sensor noise while the controller is at rest. Slow motion
+// isn't lost because samples are compared with the last one sent.
+#define MOTION_GYRO_DEADBAND_DPS 0.2f
+#define MOTION_ACCEL_DEADBAND_MS2 0.05f
+#define MOTION_DEADBAND_REFRESH_INTERVAL 100
+
+#define RADIANS_TO_DEGREES 57.2957795f
+
 // Haptic capabilities (in addition to those from SDL_HapticQuery())
 #define ML_HAPTIC_GC_RUMBLE         (1U << 16)
 #define ML_HAPTIC_SIMPLE_RUMBLE     (1U << 17)
@@ -75,10 +85,23 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
     short rsX = state->rsX;
     short rsY = state->rsY;
 
+    // Track the oldest input event that this update includes
+    bool hasPendingEvents = state->sendPending;
+    uint32_t pendingEventTime = state->pendingEventTime;
+
     // When in single controller mode, merge all gamepad state together
     if (!m_MultiController) {
         for (int i = 0; i < MAX_GAMEPADS; i++) {
             if (m_GamepadState[i].index == state->index) {
+                // This sends any pending state from the other gamepads too
+                if (m_GamepadState[i].sendPending &&
+                        (!hasPendingEvents || SDL_TICKS_PASSED(pendingEventTime, m_GamepadState[i].pendingEventTime))) {
+                    hasPendingEvents = true;
+                    pendingEventTime = m_GamepadState[i].pendingEventTime;
+                }
+                m_GamepadState[i].sendPending = false;
+                m_GamepadState[i].pendingButtonChanges = 0;
+
                 buttons |= m_GamepadState[i].buttons;
                 if (lt < m_GamepadState[i].lt) {
                     lt = m_GamepadState[i].lt;
@@ -110,6 +133,55 @@ void SdlInputHandler::sendGamepadState(GamepadState* state)
                                lsY,
                                rsX,
                                rsY);
+
+    state->sendPending = false;
+    state->pendingButtonChanges = 0;
+    state->lastSendTime = SDL_GetTicks();
+
+    if (hasPendingEvents) {
+        recordInputSend(InputClassGamepad, pendingEventTime);
+    }
+}
+
+int SdlInputHandler::flushGamepadState()
+{
+    Uint32 now = SDL_GetTicks();
+    int nextFlushMs = -1;
+
+    for (int i = 0; i < MAX_GAMEPADS; i++) {
+        GamepadState* state = &m_GamepadState[i];
+
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+        int motionDelaysMs[] = {
+            flushMotionSample(state, &state->accel, LI_MOTION_TYPE_ACCEL, now),
+            flushMotionSample(state, &state->gyro, LI_MOTION_TYPE_GYRO, now),
+        };
+        for (int delayMs : motionDelaysMs) {
+            if (delayMs >= 0 && (nextFlushMs < 0 || delayMs < nextFlushMs)) {
+                nextFlushMs = delayMs;
+            }
+        }
+#endif
+
+        if (!state->sendPending) {
+            continue;
+        }
+
+        // Button changes are always sent right away, but axis motion
+        // is held back to respect the send rate limit (if any).
+        if (m_GamepadSendIntervalMs != 0 && state->pendingButtonChanges == 0 &&
+                !SDL_TICKS_PASSED(now, state->lastSendTime + m_GamepadSendIntervalMs)) {
+            int delayMs = (int)(state->lastSendTime + m_GamepadSendIntervalMs - now);
+            if (nextFlushMs < 0 || delayMs < nextFlushMs) {
+                nextFlushMs = delayMs;
+            }
+            continue;
+        }
+
+        sendGamepadState(state);
+    }
+
+    return nextFlushMs;
 }
 
 void SdlInputHandler::sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level)
@@ -197,8 +269,11 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
     }
 
     // Batch all pending axis motion events for this gamepad to save CPU time
+    Uint32 eventTime = event->timestamp;
     SDL_Event nextEvent;
     for (;;) {
+        countInputEvents(InputClassGamepad);
+
         switch (event->axis)
         {
             case SDL_CONTROLLER_AXIS_LEFTX:
@@ -246,9 +321,13 @@ void SdlInputHandler::handleControllerAxisEvent(SDL_ControllerAxisEvent* event)
         SDL_PeepEvents(&nextEvent, 1, SDL_GETEVENT, SDL_CONTROLLERAXISMOTION, SDL_CONTROLLERAXISMOTION);
     }
 
-    // Only send the gamepad state to the host if it's not in mouse emulation mode
+    // Only send the gamepad state to the host if it's not in mouse emulation mode.
+    // It will be sent along with any other changes once the event queue is drained.
     if (state->mouseEmulationTimer == 0) {
-        sendGamepadState(state);
+        if (!state->sendPending) {
+            state->sendPending = true;
+            state->pendingEventTime = eventTime;
+        }
     }
 }
 
@@ -266,6 +345,8 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         return;
     }
 
+    countInputEvents(InputClassGamepad);
+
     if (m_SwapFaceButtons) {
         switch (event->button) {
         case SDL_CONTROLLER_BUTTON_A:
@@ -283,6 +364,12 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         }
     }
 
+    // Don't let a quick press and release of a button coalesce into
+    // no change at all. Send the pending state first instead.
+    if (state->pendingButtonChanges & k_ButtonMap[event->button]) {
+        sendGamepadState(state);
+    }
+
     if (event->state == SDL_PRESSED) {
         state->buttons |= k_ButtonMap[event->button];
 
@@ -377,6 +464,8 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         // Clear buttons down on this gamepad
         LiSendMultiControllerEvent(state->index, m_GamepadMask,
                                    0, 0, 0, 0, 0, 0, 0);
+        state->sendPending = false;
+        state->pendingButtonChanges = 0;
         return;
     }
 
@@ -392,12 +481,19 @@ void SdlInputHandler::handleControllerButtonEvent(SDL_ControllerButtonEvent* eve
         // Clear buttons down on this gamepad
         LiSendMultiControllerEvent(state->index, m_GamepadMask,
                                    0, 0, 0, 0, 0, 0, 0);
+        state->sendPending = false;
+        state->pendingButtonChanges = 0;
         return;
     }
 
-    // Only send the gamepad state to the host if it's not in mouse emulation mode
+    // Only send the gamepad state to the host if it's not in mouse emulation mode.
+    // It will be sent along with any other changes once the event queue is drained.
     if (state->mouseEmulationTimer == 0) {
-        sendGamepadState(state);
+        if (!state->sendPending) {
+            state->sendPending = true;
+            state->pendingEventTime = event->timestamp;
+        }
+        state->pendingButtonChanges |= k_ButtonMap[event->button];
     }
 }
 
@@ -410,32 +506,94 @@ void SdlInputHandler::handleControllerSensorEvent(SDL_ControllerSensorEvent* eve
         return;
     }
 
+    countInputEvents(InputClassGamepadMotion);
+
+    MotionSensorState* sensor;
+    uint8_t motionType;
+    float deadband;
     switch (event->sensor) {
     case SDL_SENSOR_ACCEL:
-        if (state->accelReportPeriodMs &&
-                SDL_TICKS_PASSED(event->timestamp, state->lastAccelEventTime + state->accelReportPeriodMs) &&
-                memcmp(event->data, state->lastAccelEventData, sizeof(event->data)) != 0) {
-            memcpy(state->lastAccelEventData, event->data, sizeof(event->data));
-            state->lastAccelEventTime = event->timestamp;
-
-            LiSendControllerMotionEvent((uint8_t)state->index, LI_MOTION_TYPE_ACCEL, event->data[0], event->data[1], event->data[2]);
-        }
+        sensor = &state->accel;
+        motionType = LI_MOTION_TYPE_ACCEL;
+        deadband = MOTION_ACCEL_DEADBAND_MS2;
         break;
     case SDL_SENSOR_GYRO:
-        if (state->gyroReportPeriodMs &&
-                SDL_TICKS_PASSED(event->timestamp, state->lastGyroEventTime + state->gyroReportPeriodMs) &&
-                memcmp(event->data, state->lastGyroEventData, sizeof(event->data)) != 0) {
-            memcpy(state->lastGyroEventData, event->data, sizeof(event->data));
-            state->lastGyroEventTime = event->timestamp;
-
-            // Convert rad/s to deg/s
-            LiSendControllerMotionEvent((uint8_t)state->index, LI_MOTION_TYPE_GYRO,
-                                        event->data[0] * 57.2957795f,
-                                        event->data[1] * 57.2957795f,
-                                        event->data[2] * 57.2957795f);
-        }
+        sensor = &state->gyro;
+        motionType = LI_MOTION_TYPE_GYRO;
+        deadband = MOTION_GYRO_DEADBAND_DPS / RADIANS_TO_DEGREES;
         break;
+    default:
+        return;
+    }
+
+    if (sensor->reportPeriodMs == 0) {
+        // The host hasn't asked for this sensor
+        return;
+    }
+    else if (memcmp(event->data, sensor->lastSentData, sizeof(event->data)) == 0) {
+        // The host already has this sample
+        sensor->samplePending = false;
+        return;
+    }
+
+    // Only the latest sample is sent, but latency is measured from the oldest
+    if (!sensor->samplePending) {
+        sensor->samplePending = true;
+        sensor->pendingEventTime = event->timestamp;
     }
+    memcpy(sensor->pendingData, event->data, sizeof(event->data));
+
+    sensor->pendingChangeSignificant = false;
+    for (int i = 0; i < (int)SDL_arraysize(event->data); i++) {
+        if (qAbs(event->data[i] - sensor->lastSentData[i]) > deadband) {
+            sensor->pendingChangeSignificant = true;
+            break;
+        }
+    }
+
+    // Send it now if it's due, otherwise flushGamepadState() will send it later
+    flushMotionSample(state, sensor, motionType, SDL_GetTicks());
+}
+
+void SdlInputHandler::sendMotionSample(GamepadState* state, MotionSensorState* sensor, uint8_t motionType)
+{
+    if (motionType == LI_MOTION_TYPE_GYRO) {
+        // Convert rad/s to deg/s
+        LiSendControllerMotionEvent((uint8_t)state->index, LI_MOTION_TYPE_GYRO,
+                                    sensor->pendingData[0] * RADIANS_TO_DEGREES,
+                                    sensor->pendingData[1] * RADIANS_TO_DEGREES,
+                                    sensor->pendingData[2] * RADIANS_TO_DEGREES);
+    }
+    else {
+        LiSendControllerMotionEvent((uint8_t)state->index, motionType,
+                                    sensor->pendingData[0], sensor->pendingData[1], sensor->pendingData[2]);
+    }
+
+    memcpy(sensor->lastSentData, sensor->pendingData, sizeof(sensor->lastSentData));
+    sensor->lastSendTime = SDL_GetTicks();
+    sensor->samplePending = false;
+
+    recordInputSend(InputClassGamepadMotion, sensor->pendingEventTime);
+}
+
+int SdlInputHandler::flushMotionSample(GamepadState* state, MotionSensorState* sensor, uint8_t motionType, Uint32 now)
+{
+    if (!sensor->samplePending) {
+        return -1;
+    }
+
+    // Changes within the deadband are sent less often
+    Uint32 intervalMs = sensor->reportPeriodMs;
+    if (!sensor->pendingChangeSignificant) {
+        intervalMs = qMax(intervalMs, (Uint32)MOTION_DEADBAND_REFRESH_INTERVAL);
+    }
+
+    if (!SDL_TICKS_PASSED(now, sensor->lastSendTime + intervalMs)) {
+        return (int)(sensor->lastSendTime + intervalMs - now);
+    }
+
+    sendMotionSample(state, sensor, motionType);
+    return -1;
 }
 
 void SdlInputHandler::handleControllerTouchpadEvent(SDL_ControllerTouchpadEvent* event)
@@ -460,7 +618,9 @@ void SdlInputHandler::handleControllerTouchpadEvent(SDL_ControllerTouchpadEvent*
         return;
     }
 
+    countInputEvents(InputClassGamepad);
     LiSendControllerTouchEvent((uint8_t)state->index, eventType, event->finger, event->x, event->y, event->pressure);
+    recordInputSend(InputClassGamepad, event->timestamp);
 }
 
 #endif
@@ -869,19 +1029,32 @@ void SdlInputHandler::setMotionEventState(uint16_t controllerNumber, uint8_t mot
 
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     if (m_GamepadState[controllerNumber].controller != nullptr) {
-        uint8_t reportPeriodMs = reportRateHz ? (1000 / reportRateHz) : 0;
+        // Samples are sent no faster than the host asked for, which may be
+        // slower than the controller reports them.
+        uint16_t reportPeriodMs = reportRateHz ? qMax(1000 / reportRateHz, 1) : 0;
+        MotionSensorState* sensor;
+        SDL_SensorType sensorType;
 
         switch (motionType) {
         case LI_MOTION_TYPE_ACCEL:
-            m_GamepadState[controllerNumber].accelReportPeriodMs = reportPeriodMs;
-            SDL_GameControllerSetSensorEnabled(m_GamepadState[controllerNumber].controller, SDL_SENSOR_ACCEL, reportRateHz ? SDL_TRUE : SDL_FALSE);
+            sensor = &m_GamepadState[controllerNumber].accel;
+            sensorType = SDL_SENSOR_ACCEL;
             break;
 
         case LI_MOTION_TYPE_GYRO:
-            m_GamepadState[controllerNumber].gyroReportPeriodMs = reportPeriodMs;
-            SDL_GameControllerSetSensorEnabled(m_GamepadState[controllerNumber].controller, SDL_SENSOR_GYRO, reportRateHz ? SDL_TRUE : SDL_FALSE);
+            sensor = &m_GamepadState[controllerNumber].gyro;
+            sensorType = SDL_SENSOR_GYRO;
             break;
+
+        default:
+            return;
+        }
+
+        sensor->reportPeriodMs = reportPeriodMs;
+        if (reportPeriodMs == 0) {
+            sensor->samplePending = false;
         }
+        SDL_GameControllerSetSensorEnabled(m_GamepadState[controllerNumber].controller, sensorType, reportRateHz ? SDL_TRUE : SDL_FALSE);
     }
 #endif
 }
@@ -9,6 +9,18 @@
 #include <QDir>
 #include <QGuiApplication>
 
+InputStats SdlInputHandler::s_WindowInputStats[InputClassMax];
+InputStats SdlInputHandler::s_SessionInputStats[InputClassMax];
+SDL_atomic_t SdlInputHandler::s_WindowInputStatsStartTime;
+
+static const char* const k_InputClassNames[] = {
+    "Keyboard",
+    "Mouse",
+    "Gamepad",
+    "Gamepad motion",
+    "Touch",
+};
+
 SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, int streamHeight)
     : m_MultiController(prefs.multiController),
       m_GamepadMouse(prefs.gamepadMouse),
@@ -19,6 +31,7 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
       m_PendingMouseButtonsAllUpOnVideoRegionLeave(false),
       m_PointerRegionLockActive(false),
       m_PointerRegionLockToggledByUser(false),
+      m_GamepadSendIntervalMs(prefs.gamepadMaxSendRate > 0 ? 1000 / prefs.gamepadMaxSendRate : 0),
       m_FakeCaptureActive(false),
       m_CaptureSystemKeysMode(prefs.captureSysKeysMode),
       m_MouseCursorCapturedVisibilityState(SDL_DISABLE),
@@ -192,6 +205,11 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
     m_GamepadMask = getAttachedGamepadMask();
 
     SDL_zero(m_GamepadState);
+
+    SDL_zero(s_WindowInputStats);
+    SDL_zero(s_SessionInputStats);
+    SDL_AtomicSet(&s_WindowInputStatsStartTime, (int)SDL_GetTicks());
+
     SDL_zero(m_LastTouchDownEvent);
     SDL_zero(m_LastTouchUpEvent);
     SDL_zero(m_TouchDownEvent);
@@ -199,6 +217,8 @@ SdlInputHandler::SdlInputHandler(StreamingPreferences& prefs, int streamWidth, i
 
 SdlInputHandler::~SdlInputHandler()
 {
+    logInputStats();
+
     for (int i = 0; i < MAX_GAMEPADS; i++) {
         if (m_GamepadState[i].mouseEmulationTimer != 0) {
             Session::get()->notifyMouseEmulationMode(false);
@@ -438,6 +458,8 @@ void SdlInputHandler::handleTouchFingerEvent(SDL_TouchFingerEvent* event)
     return;
 #endif
 
+    countInputEvents(InputClassTouch);
+
     if (m_AbsoluteTouchMode) {
         handleAbsoluteFingerEvent(event);
     }
@@ -445,3 +467,125 @@ void SdlInputHandler::handleTouchFingerEvent(SDL_TouchFingerEvent* event)
         handleRelativeFingerEvent(event);
     }
 }
+
+void SdlInputHandler::countInputEvents(InputClass inputClass, int events)
+{
+    SDL_AtomicAdd(&s_WindowInputStats[inputClass].events, events);
+    SDL_AtomicAdd(&s_SessionInputStats[inputClass].events, events);
+}
+
+void SdlInputHandler::recordInputSend(InputClass inputClass, Uint32 eventTime)
+{
+    Uint32 latencyMs = SDL_GetTicks() - eventTime;
+
+    int bucket = 0;
+    while (bucket < INPUT_LATENCY_BUCKETS - 1 && latencyMs >= (1U << bucket)) {
+        bucket++;
+    }
+
+    InputStats* stats[] = { &s_WindowInputStats[inputClass], &s_SessionInputStats[inputClass] };
+    for (InputStats* s : stats) {
+        SDL_AtomicIncRef(&s->sends);
+        SDL_AtomicAdd(&s->totalLatencyMs, (int)latencyMs);
+        SDL_AtomicIncRef(&s->latencyBuckets[bucket]);
+    }
+}
+
+void SdlInputHandler::stringifyInputStats(char* output, int length)
+{
+    Uint32 now = SDL_GetTicks();
+    Uint32 elapsedMs = now - (Uint32)SDL_AtomicSet(&s_WindowInputStatsStartTime, (int)now);
+    int offset = 0;
+
+    // Start with an empty string
+    output[offset] = 0;
+
+    for (int i = 0; i < InputClassMax; i++) {
+        InputStats& stats = s_WindowInputStats[i];
+        int events = SDL_AtomicSet(&stats.events, 0);
+        int sends = SDL_AtomicSet(&stats.sends, 0);
+        int totalLatencyMs = SDL_AtomicSet(&stats.totalLatencyMs, 0);
+        int buckets[INPUT_LATENCY_BUCKETS];
+        for (int j = 0; j < INPUT_LATENCY_BUCKETS; j++) {
+            buckets[j] = SDL_AtomicSet(&stats.latencyBuckets[j], 0);
+        }
+
+        if (sends == 0 || elapsedMs == 0) {
+            continue;
+        }
+
+        // Find the bucket that 95% of sends fall within
+        int p95Bucket = 0;
+        for (int count = buckets[0];
+             count * 100 < sends * 95 && p95Bucket < INPUT_LATENCY_BUCKETS - 1;
+             count += buckets[p95Bucket]) {
+            p95Bucket++;
+        }
+
+        char p95String[16];
+        if (p95Bucket < INPUT_LATENCY_BUCKETS - 1) {
+            snprintf(p95String, sizeof(p95String), "< %u ms", 1U << p95Bucket);
+        }
+        else {
+            snprintf(p95String, sizeof(p95String), "%u+ ms", 1U << (p95Bucket - 1));
+        }
+
+        int ret = snprintf(&output[offset],
+                           length - offset,
+                           "%s input: %.0f events/sec, %.1f events per send, latency: %.1f ms average, 95%% %s\n",
+                           k_InputClassNames[i],
+                           events * 1000.0f / elapsedMs,
+                           (float)events / sends,
+                           (float)totalLatencyMs / sends,
+                           p95String);
+        if (ret < 0 || ret >= length - offset) {
+            // This is appended after the video stats, so there may not be room
+            // for every line. Drop the partial line, but keep going so the
+            // remaining classes still start a new window.
+            output[offset] = 0;
+            continue;
+        }
+
+        offset += ret;
+    }
+}
+
+void SdlInputHandler::logInputStats()
+{
+    for (int i = 0; i < InputClassMax; i++) {
+        InputStats& stats = s_SessionInputStats[i];
+        int events = SDL_AtomicGet(&stats.events);
+        int sends = SDL_AtomicGet(&stats.sends);
+
+        if (sends == 0) {
+            continue;
+        }
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "%s input: %d events in %d sends (%.1f events per send), average latency: %.2f ms",
+                    k_InputClassNames[i],
+                    events,
+                    sends,
+                    (float)events / sends,
+                    (float)SDL_AtomicGet(&stats.totalLatencyMs) / sends);
+
+        char histogram[128];
+        int offset = 0;
+        for (int j = 0; j < INPUT_LATENCY_BUCKETS; j++) {
+            float percent = SDL_AtomicGet(&stats.latencyBuckets[j]) * 100.0f / sends;
+            if (j < INPUT_LATENCY_BUCKETS - 1) {
+                offset += snprintf(&histogram[offset], sizeof(histogram) - offset,
+                                   "%s< %u ms: %.1f%%", j == 0 ? "" : ", ", 1U << j, percent);
+            }
+            else {
+                offset += snprintf(&histogram[offset], sizeof(histogram) - offset,
+                                   ", %u+ ms: %.1f%%", 1U << (j - 1), percent);
+            }
+        }
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "%s input latency: %s",
+                    k_InputClassNames[i],
+                    histogram);
+    }
+}
@@ -5,6 +5,22 @@
 
 #include "SDL_compat.h"
 
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+struct MotionSensorState {
+    // Minimum time between samples requested by the host (0 if disabled)
+    uint16_t reportPeriodMs;
+
+    float lastSentData[SDL_arraysize(SDL_ControllerSensorEvent::data)];
+    uint32_t lastSendTime;
+
+    // Latest sample, held back until it's due to be sent
+    bool samplePending;
+    bool pendingChangeSignificant;
+    float pendingData[SDL_arraysize(SDL_ControllerSensorEvent::data)];
+    uint32_t pendingEventTime;
+};
+#endif
+
 struct GamepadState {
     SDL_GameController* controller;
     SDL_JoystickID jsId;
@@ -23,19 +39,30 @@ struct GamepadState {
     bool emulatedClickpadButtonDown;
 
 #if SDL_VERSION_ATLEAST(2, 0, 14)
-    uint8_t gyroReportPeriodMs;
-    float lastGyroEventData[SDL_arraysize(SDL_ControllerSensorEvent::data)];
-    uint32_t lastGyroEventTime;
-
-    uint8_t accelReportPeriodMs;
-    float lastAccelEventData[SDL_arraysize(SDL_ControllerSensorEvent::data)];
-    uint32_t lastAccelEventTime;
+    MotionSensorState gyro;
+    MotionSensorState accel;
 #endif
 
     int buttons;
     short lsX, lsY;
     short rsX, rsY;
     unsigned char lt, rt;
+
+    // State changes waiting for flushGamepadState()
+    bool sendPending;
+    int pendingButtonChanges;
+    uint32_t pendingEventTime;
+    uint32_t lastSendTime;
+};
+
+// Event-to-send latency buckets: < 1, < 2, < 4, < 8, < 16 and 16+ ms
+#define INPUT_LATENCY_BUCKETS 6
+
+struct InputStats {
+    SDL_atomic_t events;
+    SDL_atomic_t sends;
+    SDL_atomic_t totalLatencyMs;
+    SDL_atomic_t latencyBuckets[INPUT_LATENCY_BUCKETS];
 };
 
 
@@ -104,6 +131,16 @@ public:
 
     void handleControllerDeviceEvent(SDL_ControllerDeviceEvent* event);
 
+    // Sends gamepad state and motion samples changed since the last flush. Returns
+    // the number of milliseconds until held back state can be sent, or -1 if none
+    // is pending.
+    int flushGamepadState();
+
+    // Writes input event rates, coalescing and event-to-send latency since
+    // the last call to output. This may be called from any thread.
+    static
+    void stringifyInputStats(char* output, int length);
+
 #if SDL_VERSION_ATLEAST(2, 0, 14)
     void handleControllerSensorEvent(SDL_ControllerSensorEvent* event);
 
@@ -168,6 +205,25 @@ private:
         KeyComboMax
     };
 
+    enum InputClass {
+        InputClassKeyboard,
+        InputClassMouse,
+        InputClassGamepad,
+        InputClassGamepadMotion,
+        InputClassTouch,
+        InputClassMax
+    };
+
+    static
+    void countInputEvents(InputClass inputClass, int events = 1);
+
+    // Records a send to the host for input events that arrived at eventTime
+    static
+    void recordInputSend(InputClass inputClass, Uint32 eventTime);
+
+    static
+    void logInputStats();
+
     GamepadState*
     findStateForGamepad(SDL_JoystickID id);
 
@@ -175,6 +231,14 @@ private:
 
     void sendGamepadBatteryState(GamepadState* state, SDL_JoystickPowerLevel level);
 
+#if SDL_VERSION_ATLEAST(2, 0, 14)
+    void sendMotionSample(GamepadState* state, MotionSensorState* sensor, uint8_t motionType);
+
+    // Sends the pending motion sample if it's due. Returns the number of
+    // milliseconds until it will be due, or -1 if none is pending.
+    int flushMotionSample(GamepadState* state, MotionSensorState* sensor, uint8_t motionType, Uint32 now);
+#endif
+
     void handleAbsoluteFingerEvent(SDL_TouchFingerEvent* event);
 
     void emulateAbsoluteFingerEvent(SDL_TouchFingerEvent* event);
@@ -214,6 +278,8 @@ private:
 
     int m_GamepadMask;
     GamepadState m_GamepadState[MAX_GAMEPADS];
+    Uint32 m_GamepadSendIntervalMs;
+
     QSet<short> m_KeysDown;
     bool m_FakeCaptureActive;
     QString m_OldIgnoreDevices;
@@ -246,4 +312,9 @@ private:
     int m_NumFingersDown;
 
     static const int k_ButtonMap[];
+
+    // Input stats since the last stringifyInputStats() and for the whole session
+    static InputStats s_WindowInputStats[InputClassMax];
+    static InputStats s_SessionInputStats[InputClassMax];
+    static SDL_atomic_t s_WindowInputStatsStartTime;
 };
@@ -13,6 +13,121 @@
 #define VK_NUMPAD0 0x60
 #endif
 
+// Scancodes with their own VK_* code. Contiguous ranges are filled in
+// by getScancodeVkTable().
+static const struct {
+    SDL_Scancode scanCode;
+    short keyCode;
+} k_ScancodeVkMap[] = {
+    { SDL_SCANCODE_BACKSPACE, 0x08 },
+    { SDL_SCANCODE_TAB, 0x09 },
+    { SDL_SCANCODE_CLEAR, 0x0C },
+    { SDL_SCANCODE_KP_ENTER, 0x0D }, // FIXME: Is this correct?
+    { SDL_SCANCODE_RETURN, 0x0D },
+    { SDL_SCANCODE_PAUSE, 0x13 },
+    { SDL_SCANCODE_CAPSLOCK, 0x14 },
+    { SDL_SCANCODE_ESCAPE, 0x1B },
+    { SDL_SCANCODE_SPACE, 0x20 },
+    { SDL_SCANCODE_PAGEUP, 0x21 },
+    { SDL_SCANCODE_PAGEDOWN, 0x22 },
+    { SDL_SCANCODE_END, 0x23 },
+    { SDL_SCANCODE_HOME, 0x24 },
+    { SDL_SCANCODE_LEFT, 0x25 },
+    { SDL_SCANCODE_UP, 0x26 },
+    { SDL_SCANCODE_RIGHT, 0x27 },
+    { SDL_SCANCODE_DOWN, 0x28 },
+    { SDL_SCANCODE_SELECT, 0x29 },
+    { SDL_SCANCODE_EXECUTE, 0x2B },
+    { SDL_SCANCODE_PRINTSCREEN, 0x2C },
+    { SDL_SCANCODE_INSERT, 0x2D },
+    { SDL_SCANCODE_DELETE, 0x2E },
+    { SDL_SCANCODE_HELP, 0x2F },
+    // SDL defines SDL_SCANCODE_0 > SDL_SCANCODE_9 and SDL_SCANCODE_KP_0 > SDL_SCANCODE_KP_9,
+    // so these aren't part of the ranges with the other digits.
+    { SDL_SCANCODE_KP_0, VK_NUMPAD0 },
+    { SDL_SCANCODE_0, VK_0 },
+    { SDL_SCANCODE_KP_MULTIPLY, 0x6A },
+    { SDL_SCANCODE_KP_PLUS, 0x6B },
+    { SDL_SCANCODE_KP_COMMA, 0x6C },
+    { SDL_SCANCODE_KP_MINUS, 0x6D },
+    { SDL_SCANCODE_KP_PERIOD, 0x6E },
+    { SDL_SCANCODE_KP_DIVIDE, 0x6F },
+    { SDL_SCANCODE_NUMLOCKCLEAR, 0x90 },
+    { SDL_SCANCODE_SCROLLLOCK, 0x91 },
+    { SDL_SCANCODE_LSHIFT, 0xA0 },
+    { SDL_SCANCODE_RSHIFT, 0xA1 },
+    { SDL_SCANCODE_LCTRL, 0xA2 },
+    { SDL_SCANCODE_RCTRL, 0xA3 },
+    { SDL_SCANCODE_LALT, 0xA4 },
+    { SDL_SCANCODE_RALT, 0xA5 },
+    { SDL_SCANCODE_LGUI, 0x5B },
+    { SDL_SCANCODE_RGUI, 0x5C },
+    { SDL_SCANCODE_APPLICATION, 0x5D },
+    { SDL_SCANCODE_AC_BACK, 0xA6 },
+    { SDL_SCANCODE_AC_FORWARD, 0xA7 },
+    { SDL_SCANCODE_AC_REFRESH, 0xA8 },
+    { SDL_SCANCODE_AC_STOP, 0xA9 },
+    { SDL_SCANCODE_AC_SEARCH, 0xAA },
+    { SDL_SCANCODE_AC_BOOKMARKS, 0xAB },
+    { SDL_SCANCODE_AC_HOME, 0xAC },
+    { SDL_SCANCODE_SEMICOLON, 0xBA },
+    { SDL_SCANCODE_EQUALS, 0xBB },
+    { SDL_SCANCODE_COMMA, 0xBC },
+    { SDL_SCANCODE_MINUS, 0xBD },
+    { SDL_SCANCODE_PERIOD, 0xBE },
+    { SDL_SCANCODE_SLASH, 0xBF },
+    { SDL_SCANCODE_GRAVE, 0xC0 },
+    { SDL_SCANCODE_LEFTBRACKET, 0xDB },
+    { SDL_SCANCODE_INTERNATIONAL3, 0xDC },
+    { SDL_SCANCODE_BACKSLASH, 0xDC },
+    { SDL_SCANCODE_RIGHTBRACKET, 0xDD },
+    { SDL_SCANCODE_APOSTROPHE, 0xDE },
+    { SDL_SCANCODE_INTERNATIONAL1, 0xE2 },
+    { SDL_SCANCODE_NONUSBACKSLASH, 0xE2 },
+    { SDL_SCANCODE_LANG1, 0x1C },
+    { SDL_SCANCODE_LANG2, 0x1D },
+};
+
+// Returns the VK_* code for every SDL scancode, or 0 if it isn't mapped.
+// The table is built on first use, so key events only need a single lookup
+// instead of the range checks and switch this replaced. It's 1 KB (a short
+// for each of the SDL_NUM_SCANCODES scancodes), and only the entries for
+// keys actually pressed get pulled into cache. It's only ever read after
+// construction.
+static const short* getScancodeVkTable()
+{
+    static struct ScancodeVkTable {
+        short keyCodes[SDL_NUM_SCANCODES];
+
+        ScancodeVkTable()
+        {
+            SDL_zero(keyCodes);
+
+            for (int i = SDL_SCANCODE_1; i <= SDL_SCANCODE_9; i++) {
+                keyCodes[i] = (i - SDL_SCANCODE_1) + VK_0 + 1;
+            }
+            for (int i = SDL_SCANCODE_A; i <= SDL_SCANCODE_Z; i++) {
+                keyCodes[i] = (i - SDL_SCANCODE_A) + VK_A;
+            }
+            for (int i = SDL_SCANCODE_F1; i <= SDL_SCANCODE_F12; i++) {
+                keyCodes[i] = (i - SDL_SCANCODE_F1) + VK_F1;
+            }
+            for (int i = SDL_SCANCODE_F13; i <= SDL_SCANCODE_F24; i++) {
+                keyCodes[i] = (i - SDL_SCANCODE_F13) + VK_F13;
+            }
+            for (int i = SDL_SCANCODE_KP_1; i <= SDL_SCANCODE_KP_9; i++) {
+                keyCodes[i] = (i - SDL_SCANCODE_KP_1) + VK_NUMPAD0 + 1;
+            }
+
+            for (const auto& mapping : k_ScancodeVkMap) {
+                keyCodes[mapping.scanCode] = mapping.keyCode;
+            }
+        }
+    } table;
+
+    return table.keyCodes;
+}
+
 void SdlInputHandler::performSpecialKeyCombo(KeyCombo combo)
 {
     switch (combo) {
@@ -185,6 +300,12 @@ void SdlInputHandler::handleKeyEvent(SDL_KeyboardEvent* event)
         // any scancode tests to avoid issues in cases
         // where the SDLK for one shortcut collides with
         // the scancode of another.
+        //
+        // Unlike the scancode translation below, these are
+        // linear scans on purpose. They only run while all of
+        // Ctrl+Alt+Shift are held, and there are only
+        // KeyComboMax entries, so an index wouldn't pay for
+        // keeping it in sync with the enabled combos.
 
         for (int i = 0; i < KeyComboMax; i++) {
             if (m_SpecialKeyCombos[i].enabled && event->keysym.sym == m_SpecialKeyCombos[i].keyCode) {
@@ -221,230 +342,28 @@ void SdlInputHandler::handleKeyEvent(SDL_KeyboardEvent* event)
     // Set keycode. We explicitly use scancode here because GFE will try to correct
     // for AZERTY layouts on the host but it depends on receiving VK_ values matching
     // a QWERTY layout to work.
-    if (event->keysym.scancode >= SDL_SCANCODE_1 && event->keysym.scancode <= SDL_SCANCODE_9) {
-        // SDL defines SDL_SCANCODE_0 > SDL_SCANCODE_9, so we need to handle that manually
-        keyCode = (event->keysym.scancode - SDL_SCANCODE_1) + VK_0 + 1;
-    }
-    else if (event->keysym.scancode >= SDL_SCANCODE_A && event->keysym.scancode <= SDL_SCANCODE_Z) {
-        keyCode = (event->keysym.scancode - SDL_SCANCODE_A) + VK_A;
-    }
-    else if (event->keysym.scancode >= SDL_SCANCODE_F1 && event->keysym.scancode <= SDL_SCANCODE_F12) {
-        keyCode = (event->keysym.scancode - SDL_SCANCODE_F1) + VK_F1;
-    }
-    else if (event->keysym.scancode >= SDL_SCANCODE_F13 && event->keysym.scancode <= SDL_SCANCODE_F24) {
-        keyCode = (event->keysym.scancode - SDL_SCANCODE_F13) + VK_F13;
-    }
-    else if (event->keysym.scancode >= SDL_SCANCODE_KP_1 && event->keysym.scancode <= SDL_SCANCODE_KP_9) {
-        // SDL defines SDL_SCANCODE_KP_0 > SDL_SCANCODE_KP_9, so we need to handle that manually
-        keyCode = (event->keysym.scancode - SDL_SCANCODE_KP_1) + VK_NUMPAD0 + 1;
+    keyCode = event->keysym.scancode < SDL_NUM_SCANCODES ?
+                  getScancodeVkTable()[event->keysym.scancode] : 0;
+    if (keyCode == 0) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unhandled button event: %d",
+                     event->keysym.scancode);
+        return;
     }
-    else {
-        switch (event->keysym.scancode) {
-            case SDL_SCANCODE_BACKSPACE:
-                keyCode = 0x08;
-                break;
-            case SDL_SCANCODE_TAB:
-                keyCode = 0x09;
-                break;
-            case SDL_SCANCODE_CLEAR:
-                keyCode = 0x0C;
-                break;
-            case SDL_SCANCODE_KP_ENTER: // FIXME: Is this correct?
-            case SDL_SCANCODE_RETURN:
-                keyCode = 0x0D;
-                break;
-            case SDL_SCANCODE_PAUSE:
-                keyCode = 0x13;
-                break;
-            case SDL_SCANCODE_CAPSLOCK:
-                keyCode = 0x14;
-                break;
-            case SDL_SCANCODE_ESCAPE:
-                keyCode = 0x1B;
-                break;
-            case SDL_SCANCODE_SPACE:
-                keyCode = 0x20;
-                break;
-            case SDL_SCANCODE_PAGEUP:
-                keyCode = 0x21;
-                break;
-            case SDL_SCANCODE_PAGEDOWN:
-                keyCode = 0x22;
-                break;
-            case SDL_SCANCODE_END:
-                keyCode = 0x23;
-                break;
-            case SDL_SCANCODE_HOME:
-                keyCode = 0x24;
-                break;
-            case SDL_SCANCODE_LEFT:
-                keyCode = 0x25;
-                break;
-            case SDL_SCANCODE_UP:
-                keyCode = 0x26;
-                break;
-            case SDL_SCANCODE_RIGHT:
-                keyCode = 0x27;
-                break;
-            case SDL_SCANCODE_DOWN:
-                keyCode = 0x28;
-                break;
-            case SDL_SCANCODE_SELECT:
-                keyCode = 0x29;
-                break;
-            case SDL_SCANCODE_EXECUTE:
-                keyCode = 0x2B;
-                break;
-            case SDL_SCANCODE_PRINTSCREEN:
-                keyCode = 0x2C;
-                break;
-            case SDL_SCANCODE_INSERT:
-                keyCode = 0x2D;
-                break;
-            case SDL_SCANCODE_DELETE:
-                keyCode = 0x2E;
-                break;
-            case SDL_SCANCODE_HELP:
-                keyCode = 0x2F;
-                break;
-            case SDL_SCANCODE_KP_0:
-                // See comment above about why we only handle SDL_SCANCODE_KP_0 here
-                keyCode = VK_NUMPAD0;
-                break;
-            case SDL_SCANCODE_0:
-                // See comment above about why we only handle SDL_SCANCODE_0 here
-                keyCode = VK_0;
-                break;
-            case SDL_SCANCODE_KP_MULTIPLY:
-                keyCode = 0x6A;
-                break;
-            case SDL_SCANCODE_KP_PLUS:
-                keyCode = 0x6B;
-                break;
-            case SDL_SCANCODE_KP_COMMA:
-                keyCode = 0x6C;
-                break;
-            case SDL_SCANCODE_KP_MINUS:
-                keyCode = 0x6D;
-                break;
-            case SDL_SCANCODE_KP_PERIOD:
-                keyCode = 0x6E;
-                break;
-            case SDL_SCANCODE_KP_DIVIDE:
-                keyCode = 0x6F;
-                break;
-            case SDL_SCANCODE_NUMLOCKCLEAR:
-                keyCode = 0x90;
-                break;
-            case SDL_SCANCODE_SCROLLLOCK:
-                keyCode = 0x91;
-                break;
-            case SDL_SCANCODE_LSHIFT:
-                keyCode = 0xA0;
-                break;
-            case SDL_SCANCODE_RSHIFT:
-                keyCode = 0xA1;
-                break;
-            case SDL_SCANCODE_LCTRL:
-                keyCode = 0xA2;
-                break;
-            case SDL_SCANCODE_RCTRL:
-                keyCode = 0xA3;
-                break;
-            case SDL_SCANCODE_LALT:
-                keyCode = 0xA4;
-                break;
-            case SDL_SCANCODE_RALT:
-                keyCode = 0xA5;
-                break;
-            case SDL_SCANCODE_LGUI:
-                if (!isSystemKeyCaptureActive()) {
-                    return;
-                }
-                keyCode = 0x5B;
-                break;
-            case SDL_SCANCODE_RGUI:
-                if (!isSystemKeyCaptureActive()) {
-                    return;
-                }
-                keyCode = 0x5C;
-                break;
-            case SDL_SCANCODE_APPLICATION:
-                keyCode = 0x5D;
-                break;
-            case SDL_SCANCODE_AC_BACK:
-                keyCode = 0xA6;
-                break;
-            case SDL_SCANCODE_AC_FORWARD:
-                keyCode = 0xA7;
-                break;
-            case SDL_SCANCODE_AC_REFRESH:
-                keyCode = 0xA8;
-                break;
-            case SDL_SCANCODE_AC_STOP:
-                keyCode = 0xA9;
-                break;
-            case SDL_SCANCODE_AC_SEARCH:
-                keyCode = 0xAA;
-                break;
-            case SDL_SCANCODE_AC_BOOKMARKS:
-                keyCode = 0xAB;
-                break;
-            case SDL_SCANCODE_AC_HOME:
-                keyCode = 0xAC;
-                break;
-            case SDL_SCANCODE_SEMICOLON:
-                keyCode = 0xBA;
-                break;
-            case SDL_SCANCODE_EQUALS:
-                keyCode = 0xBB;
-                break;
-            case SDL_SCANCODE_COMMA:
-                keyCode = 0xBC;
-                break;
-            case SDL_SCANCODE_MINUS:
-                keyCode = 0xBD;
-                break;
-            case SDL_SCANCODE_PERIOD:
-                keyCode = 0xBE;
-                break;
-            case SDL_SCANCODE_SLASH:
-                keyCode = 0xBF;
-                break;
-            case SDL_SCANCODE_GRAVE:
-                keyCode = 0xC0;
-                break;
-            case SDL_SCANCODE_LEFTBRACKET:
-                keyCode = 0xDB;
-                break;
-            case SDL_SCANCODE_INTERNATIONAL3:
-                shouldNotConvertToScanCodeOnServer = true;
-            case SDL_SCANCODE_BACKSLASH:
-                keyCode = 0xDC;
-                break;
-            case SDL_SCANCODE_RIGHTBRACKET:
-                keyCode = 0xDD;
-                break;
-            case SDL_SCANCODE_APOSTROPHE:
-                keyCode = 0xDE;
-                break;
-            case SDL_SCANCODE_INTERNATIONAL1:
-                shouldNotConvertToScanCodeOnServer = true;
-            case SDL_SCANCODE_NONUSBACKSLASH:
-                keyCode = 0xE2;
-                break;
-            case SDL_SCANCODE_LANG1:
-                keyCode = 0x1C;
-                break;
-            case SDL_SCANCODE_LANG2:
-                keyCode = 0x1D;
-                break;
-            default:
-                SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
-                            "Unhandled button event: %d",
-                             event->keysym.scancode);
-                return;
+
+    switch (event->keysym.scancode) {
+    case SDL_SCANCODE_LGUI:
+    case SDL_SCANCODE_RGUI:
+        if (!isSystemKeyCaptureActive()) {
+            return;
         }
+        break;
+    case SDL_SCANCODE_INTERNATIONAL1:
+    case SDL_SCANCODE_INTERNATIONAL3:
+        shouldNotConvertToScanCodeOnServer = true;
+        break;
+    default:
+        break;
     }
 
     // Track the key state so we always know which keys are down
@@ -455,9 +374,11 @@ void SdlInputHandler::handleKeyEvent(SDL_KeyboardEvent* event)
         m_KeysDown.remove(keyCode);
     }
 
+    countInputEvents(InputClassKeyboard);
     LiSendKeyboardEvent2(0x8000 | keyCode,
                         event->state == SDL_PRESSED ?
                             KEY_ACTION_DOWN : KEY_ACTION_UP,
                         modifiers,
                         shouldNotConvertToScanCodeOnServer ? SS_KBE_FLAG_NON_NORMALIZED : 0);
+    recordInputSend(InputClassKeyboard, event->timestamp);
 }
@@ -4,6 +4,8 @@
 #include "SDL_compat.h"
 #include "streaming/streamutils.h"
 
+#include <climits>
+
 void SdlInputHandler::handleMouseButtonEvent(SDL_MouseButtonEvent* event)
 {
     int button;
@@ -62,10 +64,12 @@ void SdlInputHandler::handleMouseButtonEvent(SDL_MouseButtonEvent* event)
             button = BUTTON_RIGHT;
     }
 
+    countInputEvents(InputClassMouse);
     LiSendMouseButtonEvent(event->state == SDL_PRESSED ?
                                BUTTON_ACTION_PRESS :
                                BUTTON_ACTION_RELEASE,
                            button);
+    recordInputSend(InputClassMouse, event->timestamp);
 }
 
 void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
@@ -81,6 +85,8 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
 
     // Batch all pending mouse motion events to save CPU time
     Sint32 x = event->x, y = event->y, xrel = event->xrel, yrel = event->yrel;
+    Uint32 eventTime = event->timestamp;
+    int events = 1;
     SDL_Event nextEvent;
     while (SDL_PeepEvents(&nextEvent, 1, SDL_GETEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION) > 0) {
         event = &nextEvent.motion;
@@ -91,6 +97,7 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
             y = event->y;
             xrel += event->xrel;
             yrel += event->yrel;
+            events++;
         }
     }
 
@@ -134,7 +141,9 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
             }
         }
         if (mouseInVideoRegion || m_MouseWasInVideoRegion || m_PendingMouseButtonsAllUpOnVideoRegionLeave) {
+            countInputEvents(InputClassMouse, events);
             LiSendMousePositionEvent((short)x, (short)y, dst.w, dst.h);
+            recordInputSend(InputClassMouse, eventTime);
         }
 
         // Adjust the cursor visibility if applicable
@@ -150,7 +159,20 @@ void SdlInputHandler::handleMouseMotionEvent(SDL_MouseMotionEvent* event)
         m_MouseWasInVideoRegion = mouseInVideoRegion;
     }
     else {
-        LiSendMouseMoveEvent(xrel, yrel);
+        countInputEvents(InputClassMouse, events);
+
+        // Motion batched from many events can exceed the range of
+        // a single mouse move packet, so split it up rather than truncating.
+        while (xrel != 0 || yrel != 0) {
+            short x = (short)qBound(SHRT_MIN, xrel, SHRT_MAX);
+            short y = (short)qBound(SHRT_MIN, yrel, SHRT_MAX);
+
+            LiSendMouseMoveEvent(x, y);
+            xrel -= x;
+            yrel -= y;
+        }
+
+        recordInputSend(InputClassMouse, eventTime);
     }
 }
 
@@ -174,6 +196,8 @@ void SdlInputHandler::handleMouseWheelEvent(SDL_MouseWheelEvent* event)
         }
     }
 
+    countInputEvents(InputClassMouse);
+
 #if SDL_VERSION_ATLEAST(2, 0, 18)
     if (event->preciseY != 0.0f) {
         // Invert the scroll direction if needed
@@ -233,6 +257,8 @@ void SdlInputHandler::handleMouseWheelEvent(SDL_MouseWheelEvent* event)
         LiSendHScrollEvent((signed char)event->x);
     }
 #endif
+
+    recordInputSend(InputClassMouse, event->timestamp);
 }
 
 bool SdlInputHandler::isMouseInVideoRegion(int mouseX, int mouseY, int windowWidth, int windowHeight)
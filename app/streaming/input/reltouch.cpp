@@ -101,6 +101,7 @@ void SdlInputHandler::handleRelativeFingerEvent(SDL_TouchFingerEvent* event)
         short deltaY = static_cast<short>(event->dy * m_StreamHeight);
         if (deltaX != 0 || deltaY != 0) {
             LiSendMouseMoveEvent(deltaX, deltaY);
+            recordInputSend(InputClassTouch, event->timestamp);
         }
     }
 
@@ -0,0 +1,360 @@
+#include "metricsexporter.h"
+#include "ratelimitedlog.h"
+
+#include <QDateTime>
+#include <QSaveFile>
+
+#define DEFAULT_EXPORT_INTERVAL_MS 5000
+#define MIN_EXPORT_INTERVAL_MS 100
+
+// Keeps the escaped names within our output buffers
+#define MAX_NAME_LENGTH 128
+
+SDL_atomic_t MetricsExporter::s_Enabled;
+QByteArray MetricsExporter::s_HostName;
+QByteArray MetricsExporter::s_AppName;
+QString MetricsExporter::s_JsonFileName;
+QString MetricsExporter::s_PrometheusFileName;
+int MetricsExporter::s_IntervalMs = DEFAULT_EXPORT_INTERVAL_MS;
+SDL_Thread* MetricsExporter::s_ExportThread = nullptr;
+SDL_sem* MetricsExporter::s_StopSem = nullptr;
+SDL_atomic_t MetricsExporter::s_ConnectionStatus;
+SDL_SpinLock MetricsExporter::s_MetricsLock = 0;
+MetricsExporter::VideoMetrics MetricsExporter::s_Metrics;
+int MetricsExporter::s_MetricsSequence = 0;
+
+static float average(uint32_t total, uint32_t count)
+{
+    return count != 0 ? (float)total / count : 0;
+}
+
+static QByteArray escapeJsonString(const char* str)
+{
+    QByteArray escaped;
+
+    for (const char* c = str; *c != 0; c++) {
+        switch (*c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            if ((unsigned char)*c < 0x20) {
+                char controlChar[8];
+                SDL_snprintf(controlChar, sizeof(controlChar), "\\u%04x", (unsigned char)*c);
+                escaped += controlChar;
+            }
+            else {
+                escaped += *c;
+            }
+            break;
+        }
+    }
+
+    return escaped;
+}
+
+static QByteArray escapePrometheusLabel(const char* str)
+{
+    QByteArray escaped;
+
+    for (const char* c = str; *c != 0; c++) {
+        switch (*c) {
+        case '"':
+            escaped += "\\\"";
+            break;
+        case '\\':
+            escaped += "\\\\";
+            break;
+        case '\n':
+            escaped += "\\n";
+            break;
+        default:
+            escaped += *c;
+            break;
+        }
+    }
+
+    return escaped;
+}
+
+void MetricsExporter::startSession(const QString& hostName, const QString& appName)
+{
+    SDL_assert(!isEnabled());
+
+    s_JsonFileName = QString::fromLocal8Bit(qgetenv("METRICS_JSON_FILE"));
+    s_PrometheusFileName = QString::fromLocal8Bit(qgetenv("METRICS_PROMETHEUS_FILE"));
+    if (s_JsonFileName.isEmpty() && s_PrometheusFileName.isEmpty()) {
+        return;
+    }
+
+    bool ok;
+    s_IntervalMs = qEnvironmentVariableIntValue("METRICS_INTERVAL_MS", &ok);
+    if (!ok) {
+        s_IntervalMs = DEFAULT_EXPORT_INTERVAL_MS;
+    }
+    s_IntervalMs = qMax(s_IntervalMs, MIN_EXPORT_INTERVAL_MS);
+
+    s_HostName = hostName.left(MAX_NAME_LENGTH).toUtf8();
+    s_AppName = appName.left(MAX_NAME_LENGTH).toUtf8();
+
+    SDL_AtomicSet(&s_ConnectionStatus, CONN_STATUS_OKAY);
+
+    SDL_AtomicLock(&s_MetricsLock);
+    SDL_zero(s_Metrics);
+    s_MetricsSequence = 0;
+    SDL_AtomicUnlock(&s_MetricsLock);
+
+    s_StopSem = SDL_CreateSemaphore(0);
+    if (s_StopSem == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "SDL_CreateSemaphore() failed: %s",
+                     SDL_GetError());
+        return;
+    }
+
+    s_ExportThread = SDL_CreateThread(MetricsExporter::exportThreadProc, "MetricsExport", nullptr);
+    if (s_ExportThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "SDL_CreateThread() failed: %s",
+                     SDL_GetError());
+        SDL_DestroySemaphore(s_StopSem);
+        s_StopSem = nullptr;
+        return;
+    }
+
+    SDL_AtomicSet(&s_Enabled, 1);
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Exporting metrics every %d ms",
+                s_IntervalMs);
+}
+
+void MetricsExporter::endSession()
+{
+    if (SDL_AtomicSet(&s_Enabled, 0) == 0) {
+        return;
+    }
+
+    // Wake the export thread for its final write
+    SDL_SemPost(s_StopSem);
+    SDL_WaitThread(s_ExportThread, nullptr);
+    s_ExportThread = nullptr;
+
+    SDL_DestroySemaphore(s_StopSem);
+    s_StopSem = nullptr;
+}
+
+void MetricsExporter::updateVideoStats(const VIDEO_STATS& windowStats,
+                                       const VIDEO_STATS& sessionStats,
+                                       const char* codec,
+                                       int width, int height,
+                                       const char* decoder,
+                                       const char* renderer)
+{
+    SDL_AtomicLock(&s_MetricsLock);
+    s_Metrics.windowStats = windowStats;
+    s_Metrics.sessionStats = sessionStats;
+    s_Metrics.width = width;
+    s_Metrics.height = height;
+    SDL_strlcpy(s_Metrics.codec, codec, sizeof(s_Metrics.codec));
+    SDL_strlcpy(s_Metrics.decoder, decoder, sizeof(s_Metrics.decoder));
+    SDL_strlcpy(s_Metrics.renderer, renderer, sizeof(s_Metrics.renderer));
+    s_MetricsSequence++;
+    SDL_AtomicUnlock(&s_MetricsLock);
+}
+
+void MetricsExporter::updateConnectionStatus(int connectionStatus)
+{
+    SDL_AtomicSet(&s_ConnectionStatus, connectionStatus);
+}
+
+int MetricsExporter::exportThreadProc(void*)
+{
+    QFile jsonFile(s_JsonFileName);
+    int lastSequence = 0;
+
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    if (!s_JsonFileName.isEmpty() && !jsonFile.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to open metrics file: %s",
+                    qPrintable(jsonFile.errorString()));
+    }
+
+    for (;;) {
+        // The semaphore is only posted when the session is ending
+        bool stopping = SDL_SemWaitTimeout(s_StopSem, s_IntervalMs) == 0;
+
+        VideoMetrics metrics;
+        int sequence;
+
+        SDL_AtomicLock(&s_MetricsLock);
+        metrics = s_Metrics;
+        sequence = s_MetricsSequence;
+        SDL_AtomicUnlock(&s_MetricsLock);
+
+        int connectionStatus = SDL_AtomicGet(&s_ConnectionStatus);
+
+        // Only append a line when the decoder has completed a new stats window
+        if (jsonFile.isOpen() && sequence != lastSequence) {
+            writeJsonLine(jsonFile, metrics, connectionStatus);
+        }
+
+        // The textfile collector exports whatever is in the file until it
+        // changes, so mark the stream inactive rather than leaving stale data.
+        if (!s_PrometheusFileName.isEmpty()) {
+            writePrometheusFile(metrics, connectionStatus, !stopping);
+        }
+
+        lastSequence = sequence;
+
+        if (stopping) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+void MetricsExporter::writeJsonLine(QFile& file, const VideoMetrics& metrics, int connectionStatus)
+{
+    const VIDEO_STATS& stats = metrics.windowStats;
+    char line[4096];
+
+    int length = SDL_snprintf(line, sizeof(line),
+                              "{\"timestamp\":%lld,"
+                              "\"host\":\"%s\",\"app\":\"%s\","
+                              "\"connectionStatus\":\"%s\","
+                              "\"rttMs\":%u,\"rttVarianceMs\":%u,"
+                              "\"codec\":\"%s\",\"width\":%d,\"height\":%d,"
+                              "\"decoder\":\"%s\",\"renderer\":\"%s\","
+                              "\"window\":{"
+                              "\"totalFrames\":%u,\"receivedFrames\":%u,\"decodedFrames\":%u,\"renderedFrames\":%u,"
+                              "\"networkDroppedFrames\":%u,\"pacerDroppedFrames\":%u,"
+                              "\"totalFps\":%.2f,\"receivedFps\":%.2f,\"decodedFps\":%.2f,\"renderedFps\":%.2f,"
+                              "\"minHostProcessingLatencyMs\":%.1f,\"maxHostProcessingLatencyMs\":%.1f,\"avgHostProcessingLatencyMs\":%.1f,"
+                              "\"avgReassemblyTimeMs\":%.2f,\"avgDecodeTimeMs\":%.2f,\"avgPacerTimeMs\":%.2f,\"avgRenderTimeMs\":%.2f},"
+                              "\"session\":{"
+                              "\"totalFrames\":%u,\"receivedFrames\":%u,\"decodedFrames\":%u,\"renderedFrames\":%u,"
+                              "\"networkDroppedFrames\":%u,\"pacerDroppedFrames\":%u}}\n",
+                              (long long)QDateTime::currentMSecsSinceEpoch(),
+                              escapeJsonString(s_HostName.constData()).constData(),
+                              escapeJsonString(s_AppName.constData()).constData(),
+                              connectionStatus == CONN_STATUS_POOR ? "poor" : "okay",
+                              stats.lastRtt, stats.lastRttVariance,
+                              escapeJsonString(metrics.codec).constData(), metrics.width, metrics.height,
+                              escapeJsonString(metrics.decoder).constData(),
+                              escapeJsonString(metrics.renderer).constData(),
+                              stats.totalFrames, stats.receivedFrames, stats.decodedFrames, stats.renderedFrames,
+                              stats.networkDroppedFrames, stats.pacerDroppedFrames,
+                              stats.totalFps, stats.receivedFps, stats.decodedFps, stats.renderedFps,
+                              (float)stats.minHostProcessingLatency / 10,
+                              (float)stats.maxHostProcessingLatency / 10,
+                              average(stats.totalHostProcessingLatency, stats.framesWithHostProcessingLatency) / 10,
+                              average(stats.totalReassemblyTime, stats.receivedFrames),
+                              average(stats.totalDecodeTime, stats.decodedFrames),
+                              average(stats.totalPacerTime, stats.renderedFrames),
+                              average(stats.totalRenderTime, stats.renderedFrames),
+                              metrics.sessionStats.totalFrames,
+                              metrics.sessionStats.receivedFrames,
+                              metrics.sessionStats.decodedFrames,
+                              metrics.sessionStats.renderedFrames,
+                              metrics.sessionStats.networkDroppedFrames,
+                              metrics.sessionStats.pacerDroppedFrames);
+    if (length < 0 || length >= (int)sizeof(line)) {
+        SDL_assert(false);
+        return;
+    }
+
+    file.write(line, length);
+
+    // Make each record visible to tailing readers right away
+    file.flush();
+}
+
+bool MetricsExporter::writePrometheusFile(const VideoMetrics& metrics, int connectionStatus, bool active)
+{
+    const VIDEO_STATS& stats = metrics.windowStats;
+    const VIDEO_STATS& session = metrics.sessionStats;
+    char output[8192];
+
+    int length = SDL_snprintf(output, sizeof(output),
+                              "# HELP moonlight_stream_active Whether a stream is running\n"
+                              "# TYPE moonlight_stream_active gauge\n"
+                              "moonlight_stream_active %d\n"
+                              "# HELP moonlight_stream_info Video stream configuration\n"
+                              "# TYPE moonlight_stream_info gauge\n"
+                              "moonlight_stream_info{host=\"%s\",app=\"%s\",codec=\"%s\",decoder=\"%s\",renderer=\"%s\",width=\"%d\",height=\"%d\"} 1\n"
+                              "# HELP moonlight_connection_poor Whether the host reported a poor connection\n"
+                              "# TYPE moonlight_connection_poor gauge\n"
+                              "moonlight_connection_poor %d\n"
+                              "# HELP moonlight_rtt_ms Estimated network round trip time\n"
+                              "# TYPE moonlight_rtt_ms gauge\n"
+                              "moonlight_rtt_ms %u\n"
+                              "# HELP moonlight_rtt_variance_ms Estimated network round trip time variance\n"
+                              "# TYPE moonlight_rtt_variance_ms gauge\n"
+                              "moonlight_rtt_variance_ms %u\n"
+                              "# HELP moonlight_fps Frame rate over the last stats window\n"
+                              "# TYPE moonlight_fps gauge\n"
+                              "moonlight_fps{stage=\"total\"} %.2f\n"
+                              "moonlight_fps{stage=\"received\"} %.2f\n"
+                              "moonlight_fps{stage=\"decoded\"} %.2f\n"
+                              "moonlight_fps{stage=\"rendered\"} %.2f\n"
+                              "# HELP moonlight_stage_time_ms Average time per frame over the last stats window\n"
+                              "# TYPE moonlight_stage_time_ms gauge\n"
+                              "moonlight_stage_time_ms{stage=\"host_processing\"} %.1f\n"
+                              "moonlight_stage_time_ms{stage=\"reassembly\"} %.2f\n"
+                              "moonlight_stage_time_ms{stage=\"decode\"} %.2f\n"
+                              "moonlight_stage_time_ms{stage=\"pacer\"} %.2f\n"
+                              "moonlight_stage_time_ms{stage=\"render\"} %.2f\n"
+                              "# HELP moonlight_frames_total Frames handled since the decoder started\n"
+                              "# TYPE moonlight_frames_total counter\n"
+                              "moonlight_frames_total{stage=\"total\"} %u\n"
+                              "moonlight_frames_total{stage=\"received\"} %u\n"
+                              "moonlight_frames_total{stage=\"decoded\"} %u\n"
+                              "moonlight_frames_total{stage=\"rendered\"} %u\n"
+                              "# HELP moonlight_frames_dropped_total Frames dropped since the decoder started\n"
+                              "# TYPE moonlight_frames_dropped_total counter\n"
+                              "moonlight_frames_dropped_total{reason=\"network\"} %u\n"
+                              "moonlight_frames_dropped_total{reason=\"pacer\"} %u\n",
+                              active ? 1 : 0,
+                              escapePrometheusLabel(s_HostName.constData()).constData(),
+                              escapePrometheusLabel(s_AppName.constData()).constData(),
+                              escapePrometheusLabel(metrics.codec).constData(),
+                              escapePrometheusLabel(metrics.decoder).constData(),
+                              escapePrometheusLabel(metrics.renderer).constData(),
+                              metrics.width, metrics.height,
+                              connectionStatus == CONN_STATUS_POOR ? 1 : 0,
+                              stats.lastRtt,
+                              stats.lastRttVariance,
+                              stats.totalFps, stats.receivedFps, stats.decodedFps, stats.renderedFps,
+                              average(stats.totalHostProcessingLatency, stats.framesWithHostProcessingLatency) / 10,
+                              average(stats.totalReassemblyTime, stats.receivedFrames),
+                              average(stats.totalDecodeTime, stats.decodedFrames),
+                              average(stats.totalPacerTime, stats.renderedFrames),
+                              average(stats.totalRenderTime, stats.renderedFrames),
+                              session.totalFrames, session.receivedFrames, session.decodedFrames, session.renderedFrames,
+                              session.networkDroppedFrames, session.pacerDroppedFrames);
+    if (length < 0 || length >= (int)sizeof(output)) {
+        SDL_assert(false);
+        return false;
+    }
+
+    // The collector may read the file at any time, so replace it atomically
+    QSaveFile file(s_PrometheusFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        RATE_LIMITED_LOG_WARN(SDL_LOG_CATEGORY_APPLICATION,
+                              "Unable to open metrics file: %s",
+                              qPrintable(file.errorString()));
+        return false;
+    }
+
+    file.write(output, length);
+    return file.commit();
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+#include "SDL_compat.h"
+#include "video/decoder.h"
+
+// Periodically writes streaming metrics in machine-readable form for
+// monitoring tools that would otherwise have to scrape the log.
+//
+// Set METRICS_JSON_FILE to append one JSON object per interval to a file
+// and/or METRICS_PROMETHEUS_FILE to maintain a file for the Prometheus
+// node_exporter textfile collector. METRICS_INTERVAL_MS sets how often
+// they are written (default 5000 ms).
+//
+// The decoder publishes each completed video stats window into a snapshot
+// under a spinlock. All formatting and file I/O happens on a separate low
+// priority thread, so the streaming threads never wait on the disk.
+class MetricsExporter
+{
+public:
+    static void startSession(const QString& hostName, const QString& appName);
+
+    static void endSession();
+
+    static bool isEnabled()
+    {
+        return SDL_AtomicGet(&s_Enabled) != 0;
+    }
+
+    static void updateVideoStats(const VIDEO_STATS& windowStats,
+                                 const VIDEO_STATS& sessionStats,
+                                 const char* codec,
+                                 int width, int height,
+                                 const char* decoder,
+                                 const char* renderer);
+
+    static void updateConnectionStatus(int connectionStatus);
+
+private:
+    struct VideoMetrics {
+        VIDEO_STATS windowStats;
+        VIDEO_STATS sessionStats;
+        int width;
+        int height;
+        char codec[32];
+        char decoder[32];
+        char renderer[64];
+    };
+
+    static int exportThreadProc(void* context);
+
+    static void writeJsonLine(QFile& file, const VideoMetrics& metrics, int connectionStatus);
+
+    static bool writePrometheusFile(const VideoMetrics& metrics, int connectionStatus, bool active);
+
+    static SDL_atomic_t s_Enabled;
+    static QByteArray s_HostName;
+    static QByteArray s_AppName;
+    static QString s_JsonFileName;
+    static QString s_PrometheusFileName;
+    static int s_IntervalMs;
+    static SDL_Thread* s_ExportThread;
+    static SDL_sem* s_StopSem;
+    static SDL_atomic_t s_ConnectionStatus;
+
+    // Latest snapshot from the decoder, protected by s_MetricsLock.
+    // s_MetricsSequence is bumped on each update so the export thread
+    // can tell whether anything new arrived since its last write.
+    static SDL_SpinLock s_MetricsLock;
+    static VideoMetrics s_Metrics;
+    static int s_MetricsSequence;
+};
@@ -0,0 +1,75 @@
+#include "ratelimitedlog.h"
+
+SDL_SpinLock RateLimitedLog::s_ListLock = 0;
+RateLimitedLog* RateLimitedLog::s_ListHead = nullptr;
+
+bool RateLimitedLog::shouldLog(int category, SDL_LogPriority priority, int& suppressed)
+{
+    Uint32 now = SDL_GetTicks();
+    bool needsListing = false;
+
+    suppressed = 0;
+
+    SDL_AtomicLock(&m_Lock);
+
+    // Refill the budget for each interval that has passed
+    Uint32 refills = (now - m_LastRefillTime) / RATE_LIMITED_LOG_INTERVAL_MS;
+    if (refills != 0) {
+        m_Tokens = (int)SDL_min((Uint32)RATE_LIMITED_LOG_BURST, m_Tokens + refills);
+        m_LastRefillTime += refills * RATE_LIMITED_LOG_INTERVAL_MS;
+    }
+
+    if (m_Tokens == 0) {
+        m_Suppressed++;
+        m_Category = category;
+        m_Priority = priority;
+        needsListing = !m_Listed;
+        m_Listed = true;
+        SDL_AtomicUnlock(&m_Lock);
+
+        // Make sure the count is logged if no message gets through again
+        if (needsListing) {
+            SDL_AtomicLock(&s_ListLock);
+            m_Next = s_ListHead;
+            s_ListHead = this;
+            SDL_AtomicUnlock(&s_ListLock);
+        }
+
+        return false;
+    }
+
+    m_Tokens--;
+    suppressed = m_Suppressed;
+    m_Suppressed = 0;
+
+    SDL_AtomicUnlock(&m_Lock);
+
+    return true;
+}
+
+void RateLimitedLog::logSuppressed(int category, SDL_LogPriority priority, int suppressed)
+{
+    if (suppressed != 0) {
+        SDL_LogMessage(category, priority,
+                       "Suppressed %d similar messages before the one above",
+                       suppressed);
+    }
+}
+
+void RateLimitedLog::flushAll()
+{
+    SDL_AtomicLock(&s_ListLock);
+    for (RateLimitedLog* log = s_ListHead; log != nullptr; log = log->m_Next) {
+        SDL_AtomicLock(&log->m_Lock);
+        int suppressed = log->m_Suppressed;
+        log->m_Suppressed = 0;
+        SDL_AtomicUnlock(&log->m_Lock);
+
+        if (suppressed != 0) {
+            SDL_LogMessage(log->m_Category, log->m_Priority,
+                           "Suppressed %d similar messages from %s:%d",
+                           suppressed, log->m_File, log->m_Line);
+        }
+    }
+    SDL_AtomicUnlock(&s_ListLock);
+}
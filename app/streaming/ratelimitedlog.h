@@ -0,0 +1,83 @@
+#pragma once
+
+#include "SDL_compat.h"
+
+#include <errno.h>
+
+// Allow a burst of this many messages from a call site, then refill
+// the budget at a rate of one message per interval.
+#define RATE_LIMITED_LOG_BURST 5
+#define RATE_LIMITED_LOG_INTERVAL_MS 1000
+
+// Limits how often a single log call site can print, so errors that repeat
+// on every frame don't flood the log and slow down the thread reporting
+// them. Each call site has its own token bucket. When a message gets
+// through after others were suppressed, a count of the suppressed
+// messages is logged after it. Counts still pending when the errors stop
+// are logged by flushAll() at the end of the session.
+class RateLimitedLog
+{
+public:
+    // Constant initialized so call site statics don't need a guard
+    constexpr RateLimitedLog(const char* file, int line)
+        : m_Lock(0),
+          m_Tokens(RATE_LIMITED_LOG_BURST),
+          m_LastRefillTime(0),
+          m_Suppressed(0),
+          m_Category(SDL_LOG_CATEGORY_APPLICATION),
+          m_Priority(SDL_LOG_PRIORITY_ERROR),
+          m_File(file),
+          m_Line(line),
+          m_Listed(false),
+          m_Next(nullptr)
+    {
+    }
+
+    // Returns true if the caller should log its message. The number of
+    // messages suppressed before this one is returned in suppressed.
+    bool shouldLog(int category, SDL_LogPriority priority, int& suppressed);
+
+    // Logs the count returned by shouldLog() if it's non-zero
+    static void logSuppressed(int category, SDL_LogPriority priority, int suppressed);
+
+    // Logs the counts of messages that were suppressed since the last
+    // message from each call site got through
+    static void flushAll();
+
+private:
+    SDL_SpinLock m_Lock;
+    int m_Tokens;
+    Uint32 m_LastRefillTime;
+    int m_Suppressed;
+    int m_Category;
+    SDL_LogPriority m_Priority;
+    const char* m_File;
+    int m_Line;
+
+    // Call sites that have suppressed messages, protected by s_ListLock
+    bool m_Listed;
+    RateLimitedLog* m_Next;
+
+    static SDL_SpinLock s_ListLock;
+    static RateLimitedLog* s_ListHead;
+};
+
+// The message arguments are evaluated after shouldLog(), so errno
+// is preserved for call sites that format it.
+#define RATE_LIMITED_LOG(category, priority, ...) \
+    do { \
+        static RateLimitedLog s_RateLimitedLog(__FILE__, __LINE__); \
+        int rateLimitedLogErrno = errno; \
+        int rateLimitedLogSuppressed; \
+        if (s_RateLimitedLog.shouldLog(category, priority, rateLimitedLogSuppressed)) { \
+            errno = rateLimitedLogErrno; \
+            SDL_LogMessage(category, priority, __VA_ARGS__); \
+            RateLimitedLog::logSuppressed(category, priority, rateLimitedLogSuppressed); \
+        } \
+    } while (0)
+
+#define RATE_LIMITED_LOG_ERROR(category, ...) \
+    RATE_LIMITED_LOG(category, SDL_LOG_PRIORITY_ERROR, __VA_ARGS__)
+
+#define RATE_LIMITED_LOG_WARN(category, ...) \
+    RATE_LIMITED_LOG(category, SDL_LOG_PRIORITY_WARN, __VA_ARGS__)
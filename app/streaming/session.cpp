@@ -1,7 +1,12 @@
 #include "session.h"
 #include "settings/streamingpreferences.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
+#include "streaming/metricsexporter.h"
+#include "streaming/ratelimitedlog.h"
+#include "startuptracer.h"
 #include "backend/richpresencemanager.h"
+#include "backend/systemproperties.h"
 
 #include <Limelight.h>
 #include "SDL_compat.h"
@@ -9,6 +14,7 @@
 
 #ifdef HAVE_FFMPEG
 #include "video/ffmpeg.h"
+#include "video/syntheticstream.h"
 #endif
 
 #ifdef HAVE_SLVIDEO
@@ -47,6 +53,7 @@
 #include <QtEndian>
 #include <QCoreApplication>
 #include <QThreadPool>
+#include <QTimer>
 #include <QSvgRenderer>
 #include <QPainter>
 #include <QImage>
@@ -59,7 +66,7 @@
 
 CONNECTION_LISTENER_CALLBACKS Session::k_ConnCallbacks = {
     Session::clStageStarting,
-    nullptr,
+    Session::clStageComplete,
     Session::clStageFailed,
     nullptr,
     Session::clConnectionTerminated,
@@ -74,6 +81,7 @@ CONNECTION_LISTENER_CALLBACKS Session::k_ConnCallbacks = {
 };
 
 Session* Session::s_ActiveSession;
+Session::WarmDecoder Session::s_WarmDecoder;
 QSemaphore Session::s_ActiveSessionSemaphore(1);
 
 void Session::clStageStarting(int stage)
@@ -81,11 +89,19 @@ void Session::clStageStarting(int stage)
     // We know this is called on the same thread as LiStartConnection()
     // which happens to be the main thread, so it's cool to interact
     // with the GUI in these callbacks.
+    STARTUP_TRACE_BEGIN(LiGetStageName(stage));
     emit s_ActiveSession->stageStarting(QString::fromLocal8Bit(LiGetStageName(stage)));
 }
 
+void Session::clStageComplete(int stage)
+{
+    STARTUP_TRACE_END(LiGetStageName(stage));
+}
+
 void Session::clStageFailed(int stage, int errorCode)
 {
+    STARTUP_TRACE_END(LiGetStageName(stage));
+
     // Perform the port test now, while we're on the async connection thread and not blocking the UI.
     unsigned int portFlags = LiGetPortFlagsFromStage(stage);
     s_ActiveSession->m_PortTestResults = LiTestClientConnectivity(CONN_TEST_SERVER, 443, portFlags);
@@ -185,6 +201,8 @@ void Session::clConnectionStatusUpdate(int connectionStatus)
                 "Connection status update: %d",
                 connectionStatus);
 
+    MetricsExporter::updateConnectionStatus(connectionStatus);
+
     if (!s_ActiveSession->m_Preferences->connectionWarnings) {
         return;
     }
@@ -287,7 +305,8 @@ void Session::clSetAdaptiveTriggers(uint16_t controllerNumber, uint8_t eventFlag
 
 bool Session::chooseDecoder(StreamingPreferences::VideoDecoderSelection vds,
                             SDL_Window* window, int videoFormat, int width, int height,
-                            int frameRate, bool enableVsync, bool enableFramePacing, bool testOnly, IVideoDecoder*& chosenDecoder)
+                            int frameRate, bool enableVsync, bool enableFramePacing, bool testOnly, IVideoDecoder*& chosenDecoder,
+                            bool deferDecoding)
 {
     DECODER_PARAMETERS params;
 
@@ -304,6 +323,7 @@ bool Session::chooseDecoder(StreamingPreferences::VideoDecoderSelection vds,
     params.enableVsync = enableVsync;
     params.enableFramePacing = enableFramePacing;
     params.testOnly = testOnly;
+    params.deferDecoding = deferDecoding;
     params.vds = vds;
 
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
@@ -355,13 +375,37 @@ int Session::drSetup(int videoFormat, int width, int height, int frameRate, void
     s_ActiveSession->m_ActiveVideoHeight = height;
     s_ActiveSession->m_ActiveVideoFrameRate = frameRate;
 
-    // Defer decoder setup until we've started streaming so we
-    // don't have to hide and show the SDL window (which seems to
-    // cause pointer hiding to break on Windows).
-
     SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Video stream is %dx%dx%d (format 0x%x)",
                 width, height, frameRate, videoFormat);
 
+    // Adopt the decoder we prepared during the launch if it matches the
+    // stream. This waits for preparation to finish if it's still going.
+    // Otherwise, decoder setup is deferred until the streaming window is
+    // shown.
+    s_ActiveSession->m_PreparedDecoderLock.lock();
+    if (s_ActiveSession->m_PreparedDecoder != nullptr) {
+        const STREAM_CONFIGURATION& config = s_ActiveSession->m_StreamConfig;
+
+        if (videoFormat == config.supportedVideoFormats &&
+                width == config.width && height == config.height &&
+                frameRate == config.fps) {
+            SDL_AtomicLock(&s_ActiveSession->m_DecoderLock);
+            s_ActiveSession->m_VideoDecoder = s_ActiveSession->m_PreparedDecoder;
+            SDL_AtomicUnlock(&s_ActiveSession->m_DecoderLock);
+
+            s_ActiveSession->m_PreparedDecoder = nullptr;
+
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Using video decoder prepared during launch");
+        }
+        else {
+            // The prepared decoder must be destroyed on the main thread
+            SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                        "Prepared video decoder doesn't match the stream");
+        }
+    }
+    s_ActiveSession->m_PreparedDecoderLock.unlock();
+
     return 0;
 }
 
@@ -571,15 +615,22 @@ Session::Session(NvComputer* computer, NvApp& app, StreamingPreferences *prefere
       m_Window(nullptr),
       m_VideoDecoder(nullptr),
       m_DecoderLock(0),
+      m_PreparedWindow(nullptr),
+      m_PreparedDecoder(nullptr),
       m_AudioMuted(false),
       m_QtWindow(nullptr),
       m_UnexpectedTermination(true), // Failure prior to streaming is unexpected
       m_InputHandler(nullptr),
       m_MouseEmulationRefCount(0),
       m_FlushingWindowEventsRef(0),
+      m_EventLoopWakeSem(nullptr),
+      m_EventLoopThreadId(0),
+      m_EventLoopIdlePolls(0),
       m_ShouldExitAfterQuit(false),
       m_AsyncConnectionSuccess(false),
       m_PortTestResults(0),
+      m_UseSyntheticVideoStream(qEnvironmentVariableIntValue("SYNTHETIC_VIDEO_STREAM") != 0),
+      m_SyntheticVideoStream(nullptr),
       m_OpusDecoder(nullptr),
       m_AudioRenderer(nullptr),
       m_AudioSampleCount(0),
@@ -911,7 +962,9 @@ bool Session::initialize()
 
     // Check for validation errors/warnings and emit
     // signals for them, if appropriate
+    STARTUP_TRACE_BEGIN("Validate launch");
     bool ret = validateLaunch(testWindow);
+    STARTUP_TRACE_END("Validate launch");
 
     if (ret) {
         // Video format is now locked in
@@ -919,7 +972,9 @@ bool Session::initialize()
 
         // Populate decoder-dependent properties.
         // Must be done after validateLaunch() since m_StreamConfig is finalized.
+        STARTUP_TRACE_BEGIN("Decoder probe");
         ret = populateDecoderProperties(testWindow);
+        STARTUP_TRACE_END("Decoder probe");
     }
 
     SDL_DestroyWindow(testWindow);
@@ -1253,6 +1308,7 @@ private:
     {
         // Only quit the running app if our session terminated gracefully
         bool shouldQuit =
+                !m_Session->m_UseSyntheticVideoStream &&
                 !m_Session->m_UnexpectedTermination &&
                 (m_Session->m_Preferences->quitAppAfter ||
                  m_Session->m_ShouldExitAfterQuit);
@@ -1271,7 +1327,16 @@ private:
         SDL_assert(m_Session->m_VideoDecoder == nullptr);
 
         // Finish cleanup of the connection state
-        LiStopConnection();
+        if (!m_Session->m_UseSyntheticVideoStream) {
+            LiStopConnection();
+        }
+
+        // All streaming threads are gone now, so write out the trace
+        FrameTracer::endSession();
+        MetricsExporter::endSession();
+
+        // Report errors that were still being suppressed when they stopped
+        RateLimitedLog::flushAll();
 
         // Perform a best-effort app quit
         if (shouldQuit) {
@@ -1383,6 +1448,382 @@ void Session::getWindowDimensions(int& x, int& y,
     x = y = SDL_WINDOWPOS_CENTERED_DISPLAY(displayIndex);
 }
 
+SDL_Window* Session::createStreamWindow(Uint32 extraFlags)
+{
+    int x, y, width, height;
+    getWindowDimensions(x, y, width, height);
+
+    // Request at least 8 bits per color for GL
+    SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
+    SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
+    SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
+
+    // We always want a resizable window with High DPI enabled
+    Uint32 defaultWindowFlags = SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE | extraFlags;
+
+    // If we're starting in windowed mode and the Moonlight GUI is maximized or
+    // minimized, match that with the streaming window.
+    if (!m_IsFullScreen && m_QtWindow != nullptr) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        // Qt 5.10+ can propagate multiple states together
+        if (m_QtWindow->windowStates() & Qt::WindowMaximized) {
+            defaultWindowFlags |= SDL_WINDOW_MAXIMIZED;
+        }
+        if (m_QtWindow->windowStates() & Qt::WindowMinimized) {
+            defaultWindowFlags |= SDL_WINDOW_MINIMIZED;
+        }
+#else
+        // Qt 5.9 only supports a single state at a time
+        if (m_QtWindow->windowState() == Qt::WindowMaximized) {
+            defaultWindowFlags |= SDL_WINDOW_MAXIMIZED;
+        }
+        else if (m_QtWindow->windowState() == Qt::WindowMinimized) {
+            defaultWindowFlags |= SDL_WINDOW_MINIMIZED;
+        }
+#endif
+    }
+
+    // We use only the computer name on macOS to match Apple conventions where the
+    // app name is featured in the menu bar and the document name is in the title bar.
+#ifdef Q_OS_DARWIN
+    std::string windowName = QString(m_Computer->name).toStdString();
+#else
+    std::string windowName = QString(m_Computer->name + " - Moonlight").toStdString();
+#endif
+
+    SDL_Window* window = SDL_CreateWindow(windowName.c_str(),
+                                          x,
+                                          y,
+                                          width,
+                                          height,
+                                          defaultWindowFlags | StreamUtils::getPlatformWindowFlags());
+    if (!window) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "SDL_CreateWindow() failed with platform flags: %s",
+                    SDL_GetError());
+
+        window = SDL_CreateWindow(windowName.c_str(),
+                                  x,
+                                  y,
+                                  width,
+                                  height,
+                                  defaultWindowFlags);
+        if (!window) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "SDL_CreateWindow() failed: %s",
+                         SDL_GetError());
+            return nullptr;
+        }
+    }
+
+    // HACK: Remove once proper Dark Mode support lands in SDL
+#ifdef Q_OS_WIN32
+    if (m_QtWindow != nullptr) {
+        BOOL darkModeEnabled;
+
+        // Query whether dark mode is enabled for our Qt window (which tracks the OS dark mode state)
+        if (FAILED(DwmGetWindowAttribute((HWND)m_QtWindow->winId(), DWMWA_USE_IMMERSIVE_DARK_MODE, &darkModeEnabled, sizeof(darkModeEnabled))) &&
+            FAILED(DwmGetWindowAttribute((HWND)m_QtWindow->winId(), DWMWA_USE_IMMERSIVE_DARK_MODE_OLD, &darkModeEnabled, sizeof(darkModeEnabled)))) {
+            darkModeEnabled = FALSE;
+        }
+
+        SDL_SysWMinfo info;
+        SDL_VERSION(&info.version);
+
+        if (SDL_GetWindowWMInfo(window, &info) && info.subsystem == SDL_SYSWM_WINDOWS) {
+            // If dark mode is enabled, propagate that to our SDL window
+            if (darkModeEnabled) {
+                if (FAILED(DwmSetWindowAttribute(info.info.win.window, DWMWA_USE_IMMERSIVE_DARK_MODE, &darkModeEnabled, sizeof(darkModeEnabled)))) {
+                    DwmSetWindowAttribute(info.info.win.window, DWMWA_USE_IMMERSIVE_DARK_MODE_OLD, &darkModeEnabled, sizeof(darkModeEnabled));
+                }
+
+                // Toggle non-client rendering off and back on to ensure dark mode takes effect on Windows 10.
+                // DWM doesn't seem to correctly invalidate the non-client area after enabling dark mode.
+                DWMNCRENDERINGPOLICY ncPolicy = DWMNCRP_DISABLED;
+                DwmSetWindowAttribute(info.info.win.window, DWMWA_NCRENDERING_POLICY, &ncPolicy, sizeof(ncPolicy));
+                ncPolicy = DWMNCRP_ENABLED;
+                DwmSetWindowAttribute(info.info.win.window, DWMWA_NCRENDERING_POLICY, &ncPolicy, sizeof(ncPolicy));
+            }
+        }
+    }
+#endif
+
+    return window;
+}
+
+void Session::prepareDecoder()
+{
+    // Presenting to a hidden Wayland surface can block since it's never
+    // mapped, and exclusive full-screen may change the display refresh rate
+    // that Pacer was set up for. Pull renderers are fine because the
+    // decoder is created with deferDecoding and started in execInternal().
+    if (m_UseSyntheticVideoStream ||
+            strcmp(SDL_GetCurrentVideoDriver(), "wayland") == 0 ||
+            (m_IsFullScreen && m_FullScreenFlag == SDL_WINDOW_FULLSCREEN)) {
+        return;
+    }
+
+#ifdef STEAM_LINK
+    // SLVideo draws directly to the display, regardless of our window
+    return;
+#endif
+
+    STARTUP_TRACE_BEGIN("Prepare decoder");
+
+    // Reuse the decoder kept from the last session if we can
+    if (adoptWarmDecoder()) {
+        STARTUP_TRACE_END("Prepare decoder");
+        return;
+    }
+
+    // The window stays hidden until the connection is established, so the
+    // UI is still visible to show launch progress and errors.
+    m_PreparedWindow = createStreamWindow(SDL_WINDOW_HIDDEN);
+    if (m_PreparedWindow == nullptr) {
+        STARTUP_TRACE_END("Prepare decoder");
+        return;
+    }
+
+    // Decoder creation can take a while, so let the UI catch up first
+    processUiEvents();
+
+    // Apply the same V-sync rules as when the decoder is created normally
+    int displayHz = StreamUtils::getDisplayRefreshRate(m_PreparedWindow);
+    bool enableVsync = m_Preferences->enableVsync && displayHz + 5 >= m_StreamConfig.fps;
+
+    if (!chooseDecoder(m_Preferences->videoDecoderSelection,
+                       m_PreparedWindow, m_StreamConfig.supportedVideoFormats,
+                       m_StreamConfig.width, m_StreamConfig.height, m_StreamConfig.fps,
+                       enableVsync,
+                       enableVsync && m_Preferences->framePacing,
+                       false,
+                       m_PreparedDecoder,
+                       true)) {
+        // We'll try again when the window is shown
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to prepare video decoder during launch");
+    }
+
+    STARTUP_TRACE_END("Prepare decoder");
+}
+
+void Session::processUiEvents()
+{
+    // Windows and decoders must be created on the main thread when we're
+    // not using threaded exec, so the UI can only update between steps.
+    // Otherwise, the main thread is already pumping the event loop.
+    if (!m_ThreadedExec) {
+        QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        QCoreApplication::sendPostedEvents();
+    }
+}
+
+bool Session::adoptWarmDecoder()
+{
+    if (s_WarmDecoder.decoder == nullptr) {
+        return false;
+    }
+
+    if (s_WarmDecoder.videoFormat != m_StreamConfig.supportedVideoFormats ||
+            s_WarmDecoder.width != m_StreamConfig.width ||
+            s_WarmDecoder.height != m_StreamConfig.height ||
+            s_WarmDecoder.frameRate != m_StreamConfig.fps ||
+            s_WarmDecoder.vds != m_Preferences->videoDecoderSelection ||
+            s_WarmDecoder.enableVsync != m_Preferences->enableVsync ||
+            s_WarmDecoder.enableFramePacing != m_Preferences->framePacing) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Warm video decoder doesn't match this session");
+        releaseWarmDecoder();
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Reusing warm video decoder from the last session");
+
+    m_PreparedWindow = s_WarmDecoder.window;
+    m_PreparedDecoder = s_WarmDecoder.decoder;
+    s_WarmDecoder.window = nullptr;
+    s_WarmDecoder.decoder = nullptr;
+
+    // Invalidate the pending expiration
+    s_WarmDecoder.generation++;
+
+    // The host may have a different name and the UI may have moved
+    // since the window was created. If the window changes size, the
+    // renderer will handle it when the window is shown.
+#ifdef Q_OS_DARWIN
+    SDL_SetWindowTitle(m_PreparedWindow, QString(m_Computer->name).toUtf8().constData());
+#else
+    SDL_SetWindowTitle(m_PreparedWindow, QString(m_Computer->name + " - Moonlight").toUtf8().constData());
+#endif
+
+    int x, y, width, height;
+    getWindowDimensions(x, y, width, height);
+    SDL_SetWindowPosition(m_PreparedWindow, x, y);
+    SDL_SetWindowSize(m_PreparedWindow, width, height);
+
+    m_PreparedDecoder->attachToSession();
+
+    // We have our own reference from initialize()
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    return true;
+}
+
+bool Session::canKeepDecoderWarm()
+{
+    if (m_Preferences->decoderKeepWarmSecs <= 0) {
+        return false;
+    }
+
+    // With threaded exec (every X11 and Wayland session), the renderer's
+    // GL/EGL context and the SDL window's event handling belong to the
+    // exec thread, which exits when the session ends. The next session
+    // runs on a new thread, so the decoder can't be reused there.
+    if (m_ThreadedExec) {
+        return false;
+    }
+
+    // KMSDRM only supports a single window, and SDL keeps DRM master
+    // while its video subsystem is initialized, so a parked window would
+    // stop Qt from drawing the UI on EGLFS/LinuxFB.
+    if (strcmp(SDL_GetCurrentVideoDriver(), "KMSDRM") == 0 ||
+            QGuiApplication::platformName() == "eglfs" ||
+            QGuiApplication::platformName() == "linuxfb") {
+        return false;
+    }
+
+    // The display mode is restored when the stream ends, so
+    // an exclusive full-screen window can't be parked as is.
+    if (m_IsFullScreen && m_FullScreenFlag == SDL_WINDOW_FULLSCREEN) {
+        return false;
+    }
+
+    // In practice, that leaves Windows and macOS, where the stream runs on the
+    // main thread alongside the Qt UI.
+    return true;
+}
+
+void Session::keepDecoderWarm(IVideoDecoder* decoder)
+{
+    // There shouldn't be one already, but make sure we don't leak it
+    releaseWarmDecoder();
+
+    if (SDL_GetWindowFlags(m_Window) & SDL_WINDOW_FULLSCREEN) {
+        SDL_SetWindowFullscreen(m_Window, 0);
+    }
+    SDL_HideWindow(m_Window);
+
+    s_WarmDecoder.window = m_Window;
+    s_WarmDecoder.decoder = decoder;
+    s_WarmDecoder.videoFormat = m_ActiveVideoFormat;
+    s_WarmDecoder.width = m_ActiveVideoWidth;
+    s_WarmDecoder.height = m_ActiveVideoHeight;
+    s_WarmDecoder.frameRate = m_ActiveVideoFrameRate;
+    s_WarmDecoder.vds = m_Preferences->videoDecoderSelection;
+    s_WarmDecoder.enableVsync = m_Preferences->enableVsync;
+    s_WarmDecoder.enableFramePacing = m_Preferences->framePacing;
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Keeping video decoder warm for %d seconds",
+                m_Preferences->decoderKeepWarmSecs);
+
+    // This runs on the main thread, so the timer fires there too
+    int generation = ++s_WarmDecoder.generation;
+    QTimer::singleShot(m_Preferences->decoderKeepWarmSecs * 1000, [generation]() {
+        if (s_WarmDecoder.generation == generation) {
+            releaseWarmDecoder();
+        }
+    });
+
+    static bool connectedToQuit = false;
+    if (!connectedToQuit) {
+        QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit,
+                         &Session::releaseWarmDecoder);
+        connectedToQuit = true;
+    }
+}
+
+void Session::releaseWarmDecoder()
+{
+    if (s_WarmDecoder.decoder == nullptr) {
+        return;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Releasing warm video decoder");
+
+    // The decoder must be deleted before its window
+    delete s_WarmDecoder.decoder;
+    SDL_DestroyWindow(s_WarmDecoder.window);
+    s_WarmDecoder.decoder = nullptr;
+    s_WarmDecoder.window = nullptr;
+    s_WarmDecoder.generation++;
+
+    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+}
+
+int SDLCALL Session::eventLoopWakeWatch(void* userdata, SDL_Event*)
+{
+    auto me = (Session*)userdata;
+
+    // Events queued by the event loop itself (while pumping) don't need
+    // a wakeup. Only keep one wakeup pending at a time.
+    //
+    // NB: Watches run just before the event is queued, so the loop can
+    // occasionally miss it and pick it up on its next poll instead.
+    if (SDL_ThreadID() != me->m_EventLoopThreadId && SDL_SemValue(me->m_EventLoopWakeSem) == 0) {
+        SDL_SemPost(me->m_EventLoopWakeSem);
+    }
+
+    return 0;
+}
+
+bool Session::waitForEvent(SDL_Event* event, Uint32 timeoutMs)
+{
+#if SDL_VERSION_ATLEAST(2, 0, 18) && !defined(STEAM_LINK)
+    // SDL 2.0.18 has a proper wait event implementation that uses platform
+    // support to block on events rather than polling on Windows, macOS, X11,
+    // and Wayland. It falls back to 1 ms polling with SDL_Delay() if a joystick
+    // is connected, so we do our own polling in that case below. Unlike
+    // SDL_Delay(), that wakes immediately for events from other threads.
+    //
+    // NB: This behavior was introduced in SDL 2.0.16, but had a few critical
+    // issues that could cause indefinite timeouts, delayed joystick detection,
+    // and other problems.
+    if (SDL_NumJoysticks() == 0) {
+        return SDL_WaitEventTimeout(event, timeoutMs);
+    }
+#endif
+
+    // We explicitly don't use SDL_WaitEvent() here because it has an internal
+    // SDL_Delay(10) on older SDL versions which blocks this thread too long for
+    // high polling rate mice and high refresh rate displays.
+#ifndef STEAM_LINK
+    const Uint32 pollIntervalMs = 1;
+#else
+    // Waking every 1 ms to process input is too much for the low performance
+    // ARM core in the Steam Link, so we will wait 10 ms instead.
+    const Uint32 pollIntervalMs = 10;
+#endif
+
+    Uint32 deadline = SDL_GetTicks() + timeoutMs;
+    for (;;) {
+        SDL_PumpEvents();
+        if (SDL_PeepEvents(event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) > 0) {
+            return true;
+        }
+        else if (SDL_TICKS_PASSED(SDL_GetTicks(), deadline)) {
+            return false;
+        }
+
+        // Input devices still need polling, but frame-ready events and
+        // timers from other threads will wake us up immediately.
+        if (SDL_SemWaitTimeout(m_EventLoopWakeSem, pollIntervalMs) == SDL_MUTEX_TIMEDOUT) {
+            m_EventLoopIdlePolls++;
+        }
+    }
+}
+
 void Session::updateOptimalWindowDisplayMode()
 {
     SDL_DisplayMode desktopMode, bestMode, mode;
@@ -1558,6 +1999,10 @@ bool Session::startConnectionAsync()
     Q_ASSERT(m_Computer->currentGameId == 0 ||
              m_Computer->currentGameId == m_App.id);
 
+    if (m_UseSyntheticVideoStream) {
+        return startSyntheticStream();
+    }
+
     bool enableGameOptimizations;
     if (m_Computer->isNvidiaServerSoftware) {
         // GFE will set all settings to 720p60 if it doesn't recognize
@@ -1585,6 +2030,7 @@ bool Session::startConnectionAsync()
 
     try {
         NvHTTP http(m_Computer);
+        STARTUP_TRACE_BEGIN("Start app");
         http.startApp(m_Computer->currentGameId != 0 ? "resume" : "launch",
                       m_Computer->isNvidiaServerSoftware,
                       m_App.id, &m_StreamConfig,
@@ -1593,6 +2039,7 @@ bool Session::startConnectionAsync()
                       m_InputHandler->getAttachedGamepadMask(),
                       !m_Preferences->multiController,
                       rtspSessionUrl);
+        STARTUP_TRACE_END("Start app");
     } catch (const GfeHttpResponseException& e) {
         emit displayLaunchError(tr("Host returned error: %1").arg(e.toQString()));
         return false;
@@ -1690,6 +2137,47 @@ bool Session::startConnectionAsync()
     return true;
 }
 
+// Called in a non-main thread
+bool Session::startSyntheticStream()
+{
+#ifdef HAVE_FFMPEG
+    if (!(m_VideoCallbacks.capabilities & CAPABILITY_PULL_RENDERER)) {
+        emit displayLaunchError(tr("Synthetic video streams require the FFmpeg decoder."));
+        return false;
+    }
+
+    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                "Streaming synthetic video instead of connecting to the host");
+
+    // Report the stream parameters as moonlight-common-c would
+    drSetup(m_StreamConfig.supportedVideoFormats,
+            m_StreamConfig.width,
+            m_StreamConfig.height,
+            m_StreamConfig.fps,
+            nullptr, 0);
+
+    m_SyntheticVideoStream = new SyntheticVideoStream(m_StreamConfig.supportedVideoFormats,
+                                                      m_StreamConfig.width,
+                                                      m_StreamConfig.height,
+                                                      m_StreamConfig.fps,
+                                                      m_StreamConfig.bitrate,
+                                                      (m_VideoCallbacks.capabilities >> 24) & 0xFF);
+    if (!m_SyntheticVideoStream->initialize() || !m_SyntheticVideoStream->start()) {
+        delete m_SyntheticVideoStream;
+        m_SyntheticVideoStream = nullptr;
+
+        emit displayLaunchError(tr("Unable to start the synthetic video stream. Check the log for details."));
+        return false;
+    }
+
+    emit connectionStarted();
+    return true;
+#else
+    emit displayLaunchError(tr("Synthetic video streams require the FFmpeg decoder."));
+    return false;
+#endif
+}
+
 void Session::flushWindowEvents()
 {
     // Pump events to ensure all pending OS events are posted
@@ -1732,6 +2220,13 @@ public:
 
 void Session::exec(QWindow* qtWindow)
 {
+    // The stream timeline ends when the first frame is rendered
+    STARTUP_TRACE_START("stream");
+
+    // Session::initialize() and SdlInputHandler initialize SDL subsystems,
+    // possibly on another thread, so SystemProperties must be done with SDL.
+    SystemProperties::waitForBackgroundSdlQueries();
+
     m_QtWindow = qtWindow;
 
     // Use a separate thread for the streaming session on X11 or Wayland
@@ -1772,11 +2267,13 @@ void Session::execInternal()
     //
     // NB: This initializes the SDL video subsystem, so it must be
     // called on the main thread.
+    STARTUP_TRACE_BEGIN("Session init");
     if (!initialize()) {
         emit sessionFinished(0);
         emit readyForDeletion();
         return;
     }
+    STARTUP_TRACE_END("Session init");
 
     // Wait for any old session to finish cleanup
     s_ActiveSessionSemaphore.acquire();
@@ -1784,14 +2281,32 @@ void Session::execInternal()
     // We're now active
     s_ActiveSession = this;
 
+    // Start recording pipeline events if requested
+    FrameTracer::startSession();
+    FRAME_TRACE_THREAD_NAME("SessionMain");
+
+    // Start exporting metrics if requested
+    MetricsExporter::startSession(m_Computer->name, m_App.name);
+
     // Initialize the gamepad code with our preferences
     // NB: m_InputHandler must be initialize before starting the connection.
     m_InputHandler = new SdlInputHandler(*m_Preferences, m_StreamConfig.width, m_StreamConfig.height);
 
+    // Kick off the async connection thread. drSetup() will wait for the
+    // decoder we prepare here, so we must hold the lock before it starts.
     AsyncConnectionStartThread asyncConnThread(this);
+    m_PreparedDecoderLock.lock();
+    asyncConnThread.start();
+
+    // Show the launch progress before preparation blocks the main thread
+    processUiEvents();
+
+    // Prepare the decoder while the host launches the app
+    prepareDecoder();
+    m_PreparedDecoderLock.unlock();
+
     if (!m_ThreadedExec) {
-        // Kick off the async connection thread while we sit here and pump the event loop
-        asyncConnThread.start();
+        // Pump the event loop while we wait for the connection
         while (!asyncConnThread.wait(10)) {
             QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
             QCoreApplication::sendPostedEvents();
@@ -1803,91 +2318,55 @@ void Session::execInternal()
         QCoreApplication::sendPostedEvents();
     }
     else {
-        // We're already in a separate thread so run the connection operations
-        // synchronously and don't pump the event loop. The main thread is already
-        // pumping the event loop for us.
-        asyncConnThread.run();
+        // We're already in a separate thread, so don't pump the event loop.
+        // The main thread is already pumping the event loop for us.
+        asyncConnThread.wait();
     }
 
+    // Destroy the prepared decoder if it wasn't adopted by drSetup()
+    delete m_PreparedDecoder;
+    m_PreparedDecoder = nullptr;
+
     // If the connection failed, clean up and abort the connection.
     if (!m_AsyncConnectionSuccess) {
         delete m_InputHandler;
         m_InputHandler = nullptr;
+
+        // The connection may have failed after adopting the prepared decoder
+        SDL_AtomicLock(&m_DecoderLock);
+        delete m_VideoDecoder;
+        m_VideoDecoder = nullptr;
+        SDL_AtomicUnlock(&m_DecoderLock);
+
+        if (m_PreparedWindow != nullptr) {
+            SDL_DestroyWindow(m_PreparedWindow);
+            m_PreparedWindow = nullptr;
+        }
+
         SDL_QuitSubSystem(SDL_INIT_VIDEO);
         QThreadPool::globalInstance()->start(new DeferredSessionCleanupTask(this));
         return;
     }
 
-    int x, y, width, height;
-    getWindowDimensions(x, y, width, height);
-
-#ifdef STEAM_LINK
-    // We need a little delay before creating the window or we will trigger some kind
-    // of graphics driver bug on Steam Link that causes a jagged overlay to appear in
-    // the top right corner randomly.
-    SDL_Delay(500);
-#endif
-
-    // Request at least 8 bits per color for GL
-    SDL_GL_SetAttribute(SDL_GL_RED_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
-    SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
-
-    // We always want a resizable window with High DPI enabled
-    Uint32 defaultWindowFlags = SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_RESIZABLE;
-
-    // If we're starting in windowed mode and the Moonlight GUI is maximized or
-    // minimized, match that with the streaming window.
-    if (!m_IsFullScreen && m_QtWindow != nullptr) {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
-        // Qt 5.10+ can propagate multiple states together
-        if (m_QtWindow->windowStates() & Qt::WindowMaximized) {
-            defaultWindowFlags |= SDL_WINDOW_MAXIMIZED;
-        }
-        if (m_QtWindow->windowStates() & Qt::WindowMinimized) {
-            defaultWindowFlags |= SDL_WINDOW_MINIMIZED;
-        }
-#else
-        // Qt 5.9 only supports a single state at a time
-        if (m_QtWindow->windowState() == Qt::WindowMaximized) {
-            defaultWindowFlags |= SDL_WINDOW_MAXIMIZED;
-        }
-        else if (m_QtWindow->windowState() == Qt::WindowMinimized) {
-            defaultWindowFlags |= SDL_WINDOW_MINIMIZED;
-        }
-#endif
+    bool windowPrepared = m_PreparedWindow != nullptr;
+    if (windowPrepared) {
+        // Use the hidden window that the decoder was prepared on
+        m_Window = m_PreparedWindow;
+        m_PreparedWindow = nullptr;
     }
-
-    // We use only the computer name on macOS to match Apple conventions where the
-    // app name is featured in the menu bar and the document name is in the title bar.
-#ifdef Q_OS_DARWIN
-    std::string windowName = QString(m_Computer->name).toStdString();
-#else
-    std::string windowName = QString(m_Computer->name + " - Moonlight").toStdString();
+    else {
+#ifdef STEAM_LINK
+        // We need a little delay before creating the window or we will trigger some kind
+        // of graphics driver bug on Steam Link that causes a jagged overlay to appear in
+        // the top right corner randomly.
+        SDL_Delay(500);
 #endif
 
-    m_Window = SDL_CreateWindow(windowName.c_str(),
-                                x,
-                                y,
-                                width,
-                                height,
-                                defaultWindowFlags | StreamUtils::getPlatformWindowFlags());
-    if (!m_Window) {
-        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                    "SDL_CreateWindow() failed with platform flags: %s",
-                    SDL_GetError());
+        STARTUP_TRACE_BEGIN("Create window");
+        m_Window = createStreamWindow(0);
+        STARTUP_TRACE_END("Create window");
 
-        m_Window = SDL_CreateWindow(windowName.c_str(),
-                                    x,
-                                    y,
-                                    width,
-                                    height,
-                                    defaultWindowFlags);
         if (!m_Window) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "SDL_CreateWindow() failed: %s",
-                         SDL_GetError());
-
             delete m_InputHandler;
             m_InputHandler = nullptr;
             SDL_QuitSubSystem(SDL_INIT_VIDEO);
@@ -1896,38 +2375,6 @@ void Session::execInternal()
         }
     }
 
-    // HACK: Remove once proper Dark Mode support lands in SDL
-#ifdef Q_OS_WIN32
-    if (m_QtWindow != nullptr) {
-        BOOL darkModeEnabled;
-
-        // Query whether dark mode is enabled for our Qt window (which tracks the OS dark mode state)
-        if (FAILED(DwmGetWindowAttribute((HWND)m_QtWindow->winId(), DWMWA_USE_IMMERSIVE_DARK_MODE, &darkModeEnabled, sizeof(darkModeEnabled))) &&
-            FAILED(DwmGetWindowAttribute((HWND)m_QtWindow->winId(), DWMWA_USE_IMMERSIVE_DARK_MODE_OLD, &darkModeEnabled, sizeof(darkModeEnabled)))) {
-            darkModeEnabled = FALSE;
-        }
-
-        SDL_SysWMinfo info;
-        SDL_VERSION(&info.version);
-
-        if (SDL_GetWindowWMInfo(m_Window, &info) && info.subsystem == SDL_SYSWM_WINDOWS) {
-            // If dark mode is enabled, propagate that to our SDL window
-            if (darkModeEnabled) {
-                if (FAILED(DwmSetWindowAttribute(info.info.win.window, DWMWA_USE_IMMERSIVE_DARK_MODE, &darkModeEnabled, sizeof(darkModeEnabled)))) {
-                    DwmSetWindowAttribute(info.info.win.window, DWMWA_USE_IMMERSIVE_DARK_MODE_OLD, &darkModeEnabled, sizeof(darkModeEnabled));
-                }
-
-                // Toggle non-client rendering off and back on to ensure dark mode takes effect on Windows 10.
-                // DWM doesn't seem to correctly invalidate the non-client area after enabling dark mode.
-                DWMNCRENDERINGPOLICY ncPolicy = DWMNCRP_DISABLED;
-                DwmSetWindowAttribute(info.info.win.window, DWMWA_NCRENDERING_POLICY, &ncPolicy, sizeof(ncPolicy));
-                ncPolicy = DWMNCRP_ENABLED;
-                DwmSetWindowAttribute(info.info.win.window, DWMWA_NCRENDERING_POLICY, &ncPolicy, sizeof(ncPolicy));
-            }
-        }
-    }
-#endif
-
     m_InputHandler->setWindow(m_Window);
 
     QSvgRenderer svgIconRenderer(QString(":/res/moonlight.svg"));
@@ -1955,6 +2402,10 @@ void Session::execInternal()
     // for if/when we enter full-screen mode.
     updateOptimalWindowDisplayMode();
 
+    if (windowPrepared) {
+        SDL_ShowWindow(m_Window);
+    }
+
     // Enter full screen if requested
     if (m_IsFullScreen) {
         SDL_SetWindowFullscreen(m_Window, m_FullScreenFlag);
@@ -1976,6 +2427,36 @@ void Session::execInternal()
         needsPostDecoderCreationCapture = true;
     }
 
+    // If drSetup() adopted the prepared decoder, finish setting it up now
+    // since we won't go through decoder creation for the shown event.
+    if (m_VideoDecoder != nullptr) {
+        IVideoDecoder* failedDecoder = nullptr;
+
+        SDL_AtomicLock(&m_DecoderLock);
+
+        // Prepared decoders are created with deferDecoding, so pull
+        // renderers don't touch the connection before it's established.
+        // Now that we're connected, the decoder can start pulling frames.
+        if (m_VideoDecoder->startDecoding()) {
+            m_VideoDecoder->setHdrMode(LiGetCurrentHostDisplayHdrMode());
+        }
+        else {
+            // We'll create a new one for the shown event instead
+            failedDecoder = m_VideoDecoder;
+            m_VideoDecoder = nullptr;
+        }
+
+        SDL_AtomicUnlock(&m_DecoderLock);
+
+        // Don't make other threads spin on the lock while this is torn down
+        delete failedDecoder;
+
+        if (m_VideoDecoder != nullptr && needsPostDecoderCreationCapture) {
+            m_InputHandler->setCaptureActive(true);
+            needsPostDecoderCreationCapture = false;
+        }
+    }
+
     // Stop text input. SDL enables it by default
     // when we initialize the video subsystem, but this
     // causes an IME popup when certain keys are held down
@@ -1997,6 +2478,7 @@ void Session::execInternal()
     SDL_SetHint(SDL_HINT_TIMER_RESOLUTION, "1");
 
     int currentDisplayIndex = SDL_GetWindowDisplayIndex(m_Window);
+    int recoveryTier = RECOVERY_TIER_FULL;
 
     // Now that we're about to stream, any SDL_QUIT event is expected
     // unless it comes from the connection termination callback where
@@ -2009,41 +2491,33 @@ void Session::execInternal()
     // Toggle the stats overlay if requested by the user
     m_OverlayManager.setOverlayState(Overlay::OverlayDebug, m_Preferences->showPerformanceOverlay);
 
+    // Wake the event loop as soon as other threads queue events for us
+    m_EventLoopWakeSem = SDL_CreateSemaphore(0);
+    m_EventLoopThreadId = SDL_ThreadID();
+    m_EventLoopIdlePolls = 0;
+    SDL_AddEventWatch(eventLoopWakeWatch, this);
+
+    Uint32 eventLoopStartTime = SDL_GetTicks();
+    Uint32 eventLoopEvents = 0;
+
     // Hijack this thread to be the SDL main thread. We have to do this
     // because we want to suspend all Qt processing until the stream is over.
     SDL_Event event;
     for (;;) {
-#if SDL_VERSION_ATLEAST(2, 0, 18) && !defined(STEAM_LINK)
-        // SDL 2.0.18 has a proper wait event implementation that uses platform
-        // support to block on events rather than polling on Windows, macOS, X11,
-        // and Wayland. It will fall back to 1 ms polling if a joystick is
-        // connected, so we don't use it for STEAM_LINK to ensure we only poll
-        // every 10 ms.
-        //
-        // NB: This behavior was introduced in SDL 2.0.16, but had a few critical
-        // issues that could cause indefinite timeouts, delayed joystick detection,
-        // and other problems.
-        if (!SDL_WaitEventTimeout(&event, 1000)) {
-            presence.runCallbacks();
-            continue;
-        }
-#else
-        // We explicitly use SDL_PollEvent() and SDL_Delay() because
-        // SDL_WaitEvent() has an internal SDL_Delay(10) inside which
-        // blocks this thread too long for high polling rate mice and high
-        // refresh rate displays.
-        if (!SDL_PollEvent(&event)) {
-#ifndef STEAM_LINK
-            SDL_Delay(1);
-#else
-            // Waking every 1 ms to process input is too much for the low performance
-            // ARM core in the Steam Link, so we will wait 10 ms instead.
-            SDL_Delay(10);
-#endif
-            presence.runCallbacks();
-            continue;
+        if (SDL_PeepEvents(&event, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) <= 0) {
+            // The queue is drained, so send gamepad state changed by the events
+            // we just handled. If some is held back by the send rate limit, we
+            // wake up again once it can be sent.
+            int gamepadDelayMs = m_InputHandler->flushGamepadState();
+
+            if (!waitForEvent(&event, gamepadDelayMs >= 0 ? gamepadDelayMs : 1000)) {
+                presence.runCallbacks();
+                continue;
+            }
         }
-#endif
+
+        eventLoopEvents++;
+
         switch (event.type) {
         case SDL_QUIT:
             SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
@@ -2157,6 +2631,9 @@ void Session::execInternal()
                 break;
             }
 
+            // Rebuilding just the frontend renderer is enough for most window changes
+            recoveryTier = RECOVERY_TIER_FRONTEND;
+
             // Allow the renderer to handle the state change without being recreated
             if (m_VideoDecoder) {
                 bool forceRecreation = false;
@@ -2188,6 +2665,7 @@ void Session::execInternal()
                         SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
                                     "Forcing renderer recreation due to refresh rate change between displays");
                         forceRecreation = true;
+                        recoveryTier = RECOVERY_TIER_FULL;
                     }
                 }
 
@@ -2217,72 +2695,114 @@ void Session::execInternal()
                 SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
                             "Recreating renderer by internal request: %d",
                             event.type);
+
+                // Losing render targets leaves the device intact, but a device
+                // reset (or one the decoder requested) needs a full rebuild.
+                recoveryTier = event.type == SDL_RENDER_TARGETS_RESET ?
+                            RECOVERY_TIER_FRONTEND : RECOVERY_TIER_FULL;
             }
 
             SDL_AtomicLock(&m_DecoderLock);
 
-            // Destroy the old decoder
-            delete m_VideoDecoder;
+            {
+                RECOVERY_INFO recoveryInfo = {};
+                recoveryInfo.tier = recoveryTier;
+                recoveryInfo.startTime = SDL_GetTicks();
+
+                // Try to recover without recreating the decoder first
+                bool isRecovery = m_VideoDecoder != nullptr;
+                bool recovered = isRecovery && m_VideoDecoder->recover(&recoveryInfo);
+                if (!recovered) {
+                    // Destroy the old decoder
+                    delete m_VideoDecoder;
+                    m_VideoDecoder = nullptr;
+                    recoveryInfo.tier = RECOVERY_TIER_FULL;
+                }
 
-            // Insert a barrier to discard any additional window events
-            // that could cause the renderer to be and recreated again.
-            // We don't use SDL_FlushEvent() here because it could cause
-            // important events to be lost.
-            flushWindowEvents();
+                // Insert a barrier to discard any additional window events
+                // that could cause the renderer to be and recreated again.
+                // We don't use SDL_FlushEvent() here because it could cause
+                // important events to be lost.
+                flushWindowEvents();
+
+                // Update the window display mode based on our current monitor
+                // NB: Avoid a useless modeset by only doing this if it changed.
+                if (currentDisplayIndex != SDL_GetWindowDisplayIndex(m_Window)) {
+                    currentDisplayIndex = SDL_GetWindowDisplayIndex(m_Window);
+                    updateOptimalWindowDisplayMode();
+                }
 
-            // Update the window display mode based on our current monitor
-            // NB: Avoid a useless modeset by only doing this if it changed.
-            if (currentDisplayIndex != SDL_GetWindowDisplayIndex(m_Window)) {
-                currentDisplayIndex = SDL_GetWindowDisplayIndex(m_Window);
-                updateOptimalWindowDisplayMode();
-            }
+                // Now that the old decoder is dead or recovered, flush any
+                // events it may have queued to reset itself (if this reset
+                // was the result of state loss).
+                SDL_PumpEvents();
+                SDL_FlushEvent(SDL_RENDER_DEVICE_RESET);
+                SDL_FlushEvent(SDL_RENDER_TARGETS_RESET);
+
+                if (!recovered) {
+                    // If the stream exceeds the display refresh rate (plus some slack),
+                    // forcefully disable V-sync to allow the stream to render faster
+                    // than the display.
+                    int displayHz = StreamUtils::getDisplayRefreshRate(m_Window);
+                    bool enableVsync = m_Preferences->enableVsync;
+                    if (displayHz + 5 < m_StreamConfig.fps) {
+                        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                                    "Disabling V-sync because refresh rate limit exceeded");
+                        enableVsync = false;
+                    }
 
-            // Now that the old decoder is dead, flush any events it may
-            // have queued to reset itself (if this reset was the result
-            // of state loss).
-            SDL_PumpEvents();
-            SDL_FlushEvent(SDL_RENDER_DEVICE_RESET);
-            SDL_FlushEvent(SDL_RENDER_TARGETS_RESET);
+                    // Choose a new decoder (hopefully the same one, but possibly
+                    // not if a GPU was removed or something).
+                    STARTUP_TRACE_BEGIN("Decoder init");
+                    bool decoderOk = chooseDecoder(m_Preferences->videoDecoderSelection,
+                                                   m_Window, m_ActiveVideoFormat, m_ActiveVideoWidth,
+                                                   m_ActiveVideoHeight, m_ActiveVideoFrameRate,
+                                                   enableVsync,
+                                                   enableVsync && m_Preferences->framePacing,
+                                                   false,
+                                                   s_ActiveSession->m_VideoDecoder);
+                    STARTUP_TRACE_END("Decoder init");
+                    if (!decoderOk) {
+                        SDL_AtomicUnlock(&m_DecoderLock);
+                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                                     "Failed to recreate decoder after reset");
+                        emit displayLaunchError(tr("Unable to initialize video decoder. Please check your streaming settings and try again."));
+                        goto DispatchDeferredCleanup;
+                    }
 
-            {
-                // If the stream exceeds the display refresh rate (plus some slack),
-                // forcefully disable V-sync to allow the stream to render faster
-                // than the display.
-                int displayHz = StreamUtils::getDisplayRefreshRate(m_Window);
-                bool enableVsync = m_Preferences->enableVsync;
-                if (displayHz + 5 < m_StreamConfig.fps) {
-                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                                "Disabling V-sync because refresh rate limit exceeded");
-                    enableVsync = false;
-                }
+                    // Let the new decoder report when it has recovered
+                    if (isRecovery) {
+                        m_VideoDecoder->continueRecovery(&recoveryInfo);
+                    }
 
-                // Choose a new decoder (hopefully the same one, but possibly
-                // not if a GPU was removed or something).
-                if (!chooseDecoder(m_Preferences->videoDecoderSelection,
-                                   m_Window, m_ActiveVideoFormat, m_ActiveVideoWidth,
-                                   m_ActiveVideoHeight, m_ActiveVideoFrameRate,
-                                   enableVsync,
-                                   enableVsync && m_Preferences->framePacing,
-                                   false,
-                                   s_ActiveSession->m_VideoDecoder)) {
-                    SDL_AtomicUnlock(&m_DecoderLock);
-                    SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                 "Failed to recreate decoder after reset");
-                    emit displayLaunchError(tr("Unable to initialize video decoder. Please check your streaming settings and try again."));
-                    goto DispatchDeferredCleanup;
+                    // As of SDL 2.0.12, SDL_RecreateWindow() doesn't carry over mouse capture
+                    // or mouse hiding state to the new window. By capturing after the decoder
+                    // is set up, this ensures the window re-creation is already done.
+                    if (needsPostDecoderCreationCapture) {
+                        m_InputHandler->setCaptureActive(true);
+                        needsPostDecoderCreationCapture = false;
+                    }
                 }
 
-                // As of SDL 2.0.12, SDL_RecreateWindow() doesn't carry over mouse capture
-                // or mouse hiding state to the new window. By capturing after the decoder
-                // is set up, this ensures the window re-creation is already done.
-                if (needsPostDecoderCreationCapture) {
-                    m_InputHandler->setCaptureActive(true);
-                    needsPostDecoderCreationCapture = false;
+                if (isRecovery) {
+                    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                                "Reset handled by %s in %u ms",
+                                recoveryInfo.tier == RECOVERY_TIER_FRONTEND ?
+                                    "rebuilding the frontend renderer" : "rebuilding the decoder",
+                                SDL_GetTicks() - recoveryInfo.startTime);
                 }
             }
 
             // Request an IDR frame to complete the reset
-            LiRequestIdrFrame();
+#ifdef HAVE_FFMPEG
+            if (m_SyntheticVideoStream != nullptr) {
+                m_SyntheticVideoStream->requestIdrFrame();
+            }
+            else
+#endif
+            {
+                LiRequestIdrFrame();
+            }
 
             // Set HDR mode. We may miss the callback if we're in the middle
             // of recreating our decoder at the time the HDR transition happens.
@@ -2349,6 +2869,18 @@ void Session::execInternal()
     }
 
 DispatchDeferredCleanup:
+    SDL_DelEventWatch(eventLoopWakeWatch, this);
+    SDL_DestroySemaphore(m_EventLoopWakeSem);
+    m_EventLoopWakeSem = nullptr;
+
+    {
+        Uint32 eventLoopSecs = qMax((SDL_GetTicks() - eventLoopStartTime) / 1000, 1U);
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Event loop handled %u events/sec and polled %u times/sec without events",
+                    eventLoopEvents / eventLoopSecs,
+                    m_EventLoopIdlePolls / eventLoopSecs);
+    }
+
     // Uncapture the mouse and hide the window immediately,
     // so we can return to the Qt GUI ASAP.
     m_InputHandler->setCaptureActive(false);
@@ -2367,14 +2899,29 @@ DispatchDeferredCleanup:
     delete m_InputHandler;
     m_InputHandler = nullptr;
 
-    // Destroy the decoder, since this must be done on the main thread
+    // Destroy the decoder, since this must be done on the main thread,
+    // unless we can keep it warm for the next session.
     // NB: This must happen before LiStopConnection() for pull-based
     // decoders.
+    IVideoDecoder* warmDecoder = nullptr;
     SDL_AtomicLock(&m_DecoderLock);
-    delete m_VideoDecoder;
+    if (m_VideoDecoder != nullptr &&
+            canKeepDecoderWarm() &&
+            m_VideoDecoder->detachFromSession()) {
+        warmDecoder = m_VideoDecoder;
+    }
+    else {
+        delete m_VideoDecoder;
+    }
     m_VideoDecoder = nullptr;
     SDL_AtomicUnlock(&m_DecoderLock);
 
+#ifdef HAVE_FFMPEG
+    // The synthetic stream must outlive the decoder consuming it
+    delete m_SyntheticVideoStream;
+    m_SyntheticVideoStream = nullptr;
+#endif
+
     // Propagate state changes from the SDL window back to the Qt window
     //
     // NB: We're making a conscious decision not to propagate the maximized
@@ -2400,15 +2947,24 @@ DispatchDeferredCleanup:
 #endif
     }
 
-    // This must be called after the decoder is deleted, because
-    // the renderer may want to interact with the window
-    SDL_DestroyWindow(m_Window);
+    if (warmDecoder != nullptr) {
+        // The warm decoder takes over our window and video subsystem reference
+        keepDecoderWarm(warmDecoder);
+    }
+    else {
+        // This must be called after the decoder is deleted, because
+        // the renderer may want to interact with the window
+        SDL_DestroyWindow(m_Window);
+    }
+    m_Window = nullptr;
 
     if (iconSurface != nullptr) {
         SDL_FreeSurface(iconSurface);
     }
 
-    SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    if (warmDecoder == nullptr) {
+        SDL_QuitSubSystem(SDL_INIT_VIDEO);
+    }
 
     // Cleanup can take a while, so dispatch it to a worker thread.
     // When it is complete, it will release our s_ActiveSessionSemaphore
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <QMutex>
 #include <QSemaphore>
 #include <QWindow>
 
@@ -11,6 +12,8 @@
 #include "audio/renderers/renderer.h"
 #include "video/overlaymanager.h"
 
+class SyntheticVideoStream;
+
 class SupportedVideoFormatList : public QList<int>
 {
 public:
@@ -122,6 +125,11 @@ public:
         return m_OverlayManager;
     }
 
+    SyntheticVideoStream* getSyntheticVideoStream()
+    {
+        return m_SyntheticVideoStream;
+    }
+
     void flushWindowEvents();
 
     void setShouldExitAfterQuit();
@@ -151,6 +159,8 @@ private:
 
     bool startConnectionAsync();
 
+    bool startSyntheticStream();
+
     bool validateLaunch(SDL_Window* testWindow);
 
     void emitLaunchWarning(QString text);
@@ -168,12 +178,32 @@ private:
     void getWindowDimensions(int& x, int& y,
                              int& width, int& height);
 
+    SDL_Window* createStreamWindow(Uint32 extraFlags);
+
+    void prepareDecoder();
+
+    void processUiEvents();
+
+    bool adoptWarmDecoder();
+
+    bool canKeepDecoderWarm();
+
+    void keepDecoderWarm(IVideoDecoder* decoder);
+
+    static
+    void releaseWarmDecoder();
+
     void toggleFullscreen();
 
     void notifyMouseEmulationMode(bool enabled);
 
     void updateOptimalWindowDisplayMode();
 
+    bool waitForEvent(SDL_Event* event, Uint32 timeoutMs);
+
+    static
+    int SDLCALL eventLoopWakeWatch(void* userdata, SDL_Event* event);
+
     enum class DecoderAvailability {
         None,
         Software,
@@ -190,11 +220,15 @@ private:
                        SDL_Window* window, int videoFormat, int width, int height,
                        int frameRate, bool enableVsync, bool enableFramePacing,
                        bool testOnly,
-                       IVideoDecoder*& chosenDecoder);
+                       IVideoDecoder*& chosenDecoder,
+                       bool deferDecoding = false);
 
     static
     void clStageStarting(int stage);
 
+    static
+    void clStageComplete(int stage);
+
     static
     void clStageFailed(int stage, int errorCode);
 
@@ -256,6 +290,12 @@ private:
     SDL_Window* m_Window;
     IVideoDecoder* m_VideoDecoder;
     SDL_SpinLock m_DecoderLock;
+
+    // Hidden window and decoder prepared while the connection is starting.
+    // The lock is held until preparation is finished.
+    SDL_Window* m_PreparedWindow;
+    IVideoDecoder* m_PreparedDecoder;
+    QMutex m_PreparedDecoderLock;
     bool m_AudioDisabled;
     bool m_AudioMuted;
     Uint32 m_FullScreenFlag;
@@ -265,6 +305,12 @@ private:
     SdlInputHandler* m_InputHandler;
     int m_MouseEmulationRefCount;
     int m_FlushingWindowEventsRef;
+
+    // Signaled when another thread queues an event, so the event
+    // loop doesn't have to wait for its next poll to notice it.
+    SDL_sem* m_EventLoopWakeSem;
+    SDL_threadID m_EventLoopThreadId;
+    Uint32 m_EventLoopIdlePolls;
     QList<QString> m_LaunchWarnings;
     bool m_ShouldExitAfterQuit;
 
@@ -276,6 +322,9 @@ private:
     int m_ActiveVideoHeight;
     int m_ActiveVideoFrameRate;
 
+    bool m_UseSyntheticVideoStream;
+    SyntheticVideoStream* m_SyntheticVideoStream;
+
     OpusMSDecoder* m_OpusDecoder;
     IAudioRenderer* m_AudioRenderer;
     OPUS_MULTISTREAM_CONFIGURATION m_ActiveAudioConfig;
@@ -288,4 +337,21 @@ private:
     static CONNECTION_LISTENER_CALLBACKS k_ConnCallbacks;
     static Session* s_ActiveSession;
     static QSemaphore s_ActiveSessionSemaphore;
+
+    // Decoder and hidden window kept after a session ends, so the next
+    // session can skip decoder and renderer setup if its parameters match.
+    // Only accessed on the main thread.
+    struct WarmDecoder {
+        SDL_Window* window;
+        IVideoDecoder* decoder;
+        int videoFormat;
+        int width;
+        int height;
+        int frameRate;
+        StreamingPreferences::VideoDecoderSelection vds;
+        bool enableVsync;
+        bool enableFramePacing;
+        int generation;
+    };
+    static WarmDecoder s_WarmDecoder;
 };
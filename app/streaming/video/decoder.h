@@ -43,6 +43,7 @@ typedef struct _DECODER_PARAMETERS {
     bool enableVsync;
     bool enableFramePacing;
     bool testOnly;
+    bool deferDecoding;
 } DECODER_PARAMETERS, *PDECODER_PARAMETERS;
 
 #define WINDOW_STATE_CHANGE_SIZE 0x01
@@ -60,6 +61,21 @@ typedef struct _WINDOW_STATE_CHANGE_INFO {
     int displayIndex;
 } WINDOW_STATE_CHANGE_INFO, *PWINDOW_STATE_CHANGE_INFO;
 
+// Ways to recover from a reset, from least to most disruptive
+#define RECOVERY_TIER_FLUSH 0
+#define RECOVERY_TIER_FRONTEND 1
+#define RECOVERY_TIER_FULL 2
+
+typedef struct _RECOVERY_INFO {
+    int tier;
+
+    // SDL_GetTicks() when the recovery began
+    uint32_t startTime;
+
+    // Last frame decoded before the recovery began
+    int lastFrameNumber;
+} RECOVERY_INFO, *PRECOVERY_INFO;
+
 class IVideoDecoder {
 public:
     virtual ~IVideoDecoder() {}
@@ -75,4 +91,23 @@ public:
     virtual void renderFrameOnMainThread() = 0;
     virtual void setHdrMode(bool enabled) = 0;
     virtual bool notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info) = 0;
+
+    // Starts pulling frames for a decoder created with deferDecoding.
+    // This must not be called until the connection is established.
+    virtual bool startDecoding() { return true; }
+
+    // Tries to recover in place from a reset at info->tier. Returns false if
+    // the decoder must be destroyed and recreated. Either way, info is updated
+    // so the replacement decoder can report when the recovery completes.
+    virtual bool recover(PRECOVERY_INFO) { return false; }
+
+    // Called on a decoder created to replace one that couldn't recover
+    virtual void continueRecovery(PRECOVERY_INFO) {}
+
+    // Called when the session ends to keep this decoder for a later session
+    // with the same parameters. Returns false if the decoder can't be kept.
+    virtual bool detachFromSession() { return false; }
+
+    // Called when a kept decoder is adopted by a new session
+    virtual void attachToSession() {}
 };
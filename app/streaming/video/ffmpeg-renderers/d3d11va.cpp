@@ -6,7 +6,9 @@
 #include "path.h"
 
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
 #include "streaming/session.h"
+#include "streaming/ratelimitedlog.h"
 
 #include <SDL_syswm.h>
 #include <VersionHelpers.h>
@@ -659,15 +661,17 @@ void D3D11VARenderer::renderFrame(AVFrame* frame)
     }
 
     // Present according to the decoder parameters
+    FRAME_TRACE_BEGIN("Present", -1);
     hr = m_SwapChain->Present(0, flags);
+    FRAME_TRACE_END("Present");
 
     // Release the context lock
     unlockContext(this);
 
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "IDXGISwapChain::Present() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "IDXGISwapChain::Present() failed: %x",
+                               hr);
 
         // The card may have been removed or crashed. Reset the decoder.
         SDL_Event event;
@@ -68,7 +68,9 @@ extern "C" {
 #include <sys/mman.h>
 
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
 #include "streaming/session.h"
+#include "streaming/ratelimitedlog.h"
 
 #include <Limelight.h>
 
@@ -1257,10 +1259,10 @@ void DrmRenderer::renderFrame(AVFrame* frame)
                                     desiredValue);
                     }
                     else {
-                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                     "drmModeObjectSetProperty(%s) failed: %d",
-                                     m_ColorRangeProp->name,
-                                     errno);
+                        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                               "drmModeObjectSetProperty(%s) failed: %d",
+                                               m_ColorRangeProp->name,
+                                               errno);
                         // Non-fatal
                     }
 
@@ -1299,10 +1301,10 @@ void DrmRenderer::renderFrame(AVFrame* frame)
                                     desiredValue);
                     }
                     else {
-                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                     "drmModeObjectSetProperty(%s) failed: %d",
-                                     m_ColorEncodingProp->name,
-                                     errno);
+                        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                               "drmModeObjectSetProperty(%s) failed: %d",
+                                               m_ColorEncodingProp->name,
+                                               errno);
                         // Non-fatal
                     }
 
@@ -1325,16 +1327,18 @@ void DrmRenderer::renderFrame(AVFrame* frame)
     }
 
     // Update the overlay
+    FRAME_TRACE_BEGIN("Present", -1);
     err = drmModeSetPlane(m_DrmFd, m_PlaneId, m_CrtcId, m_CurrentFbId, 0,
                           dst.x, dst.y,
                           dst.w, dst.h,
                           0, 0,
                           frame->width << 16,
                           frame->height << 16);
+    FRAME_TRACE_END("Present");
     if (err < 0) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "drmModeSetPlane() failed: %d",
-                     errno);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "drmModeSetPlane() failed: %d",
+                               errno);
         drmModeRmFB(m_DrmFd, m_CurrentFbId);
         m_CurrentFbId = lastFbId;
         return;
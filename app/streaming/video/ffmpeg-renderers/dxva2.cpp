@@ -6,7 +6,9 @@
 #include "dxva2.h"
 #include "dxutil.h"
 #include "../ffmpeg.h"
+#include "streaming/ratelimitedlog.h"
 #include <streaming/streamutils.h>
+#include <streaming/frametracer.h>
 #include <streaming/session.h>
 
 #include <SDL_syswm.h>
@@ -941,25 +943,25 @@ void DXVA2Renderer::renderOverlay(Overlay::OverlayType type)
 
     hr = m_Device->SetTexture(0, overlayTexture.Get());
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "SetTexture() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "SetTexture() failed: %x",
+                               hr);
         return;
     }
 
     hr = m_Device->SetStreamSource(0, overlayVertexBuffer.Get(), 0, sizeof(VERTEX));
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "SetStreamSource() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "SetStreamSource() failed: %x",
+                               hr);
         return;
     }
 
     hr = m_Device->DrawPrimitive(D3DPT_TRIANGLEFAN, 0, 2);
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "DrawPrimitive() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "DrawPrimitive() failed: %x",
+                               hr);
         return;
     }
 }
@@ -1117,9 +1119,9 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
 
     hr = m_Device->Clear(0, nullptr, D3DCLEAR_TARGET, D3DCOLOR_ARGB(255, 0, 0, 0), 0.0f, 0);
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "Clear() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "Clear() failed: %x",
+                               hr);
         SDL_Event event;
         event.type = SDL_RENDER_TARGETS_RESET;
         SDL_PushEvent(&event);
@@ -1128,9 +1130,9 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
 
     hr = m_Device->BeginScene();
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "BeginScene() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "BeginScene() failed: %x",
+                               hr);
         SDL_Event event;
         event.type = SDL_RENDER_TARGETS_RESET;
         SDL_PushEvent(&event);
@@ -1140,9 +1142,9 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
     if (m_Processor) {
         hr = m_Processor->VideoProcessBlt(m_RenderTarget.Get(), &bltParams, &sample, 1, nullptr);
         if (FAILED(hr)) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "VideoProcessBlt() failed, falling back to StretchRect(): %x",
-                         hr);
+            RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                   "VideoProcessBlt() failed, falling back to StretchRect(): %x",
+                                   hr);
             m_Processor.Reset();
         }
     }
@@ -1154,9 +1156,9 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
         // This function doesn't trigger any of Intel's garbage video "enhancements"
         hr = m_Device->StretchRect(surface, &sample.SrcRect, m_RenderTarget.Get(), &sample.DstRect, D3DTEXF_NONE);
         if (FAILED(hr)) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "StretchRect() failed: %x",
-                         hr);
+            RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                   "StretchRect() failed: %x",
+                                   hr);
             SDL_Event event;
             event.type = SDL_RENDER_TARGETS_RESET;
             SDL_PushEvent(&event);
@@ -1171,15 +1173,16 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
 
     hr = m_Device->EndScene();
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "EndScene() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "EndScene() failed: %x",
+                               hr);
         SDL_Event event;
         event.type = SDL_RENDER_TARGETS_RESET;
         SDL_PushEvent(&event);
         return;
     }
 
+    FRAME_TRACE_BEGIN("Present", -1);
     do {
         // Use D3DPRESENT_DONOTWAIT if present may block in order to avoid holding the giant
         // lock around this D3D device for excessive lengths of time (blocking concurrent decoding tasks).
@@ -1188,10 +1191,11 @@ void DXVA2Renderer::renderFrame(AVFrame *frame)
             SDL_Delay(1);
         }
     } while (hr == D3DERR_WASSTILLDRAWING);
+    FRAME_TRACE_END("Present");
     if (FAILED(hr)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "PresentEx() failed: %x",
-                     hr);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "PresentEx() failed: %x",
+                               hr);
         SDL_Event event;
         event.type = SDL_RENDER_TARGETS_RESET;
         SDL_PushEvent(&event);
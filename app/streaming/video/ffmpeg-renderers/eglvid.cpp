@@ -4,6 +4,7 @@
 #include "path.h"
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
 
 #include <QDir>
 
@@ -882,7 +883,9 @@ void EGLRenderer::renderFrame(AVFrame* frame)
         renderOverlay((Overlay::OverlayType)i, drawableWidth, drawableHeight);
     }
 
+    FRAME_TRACE_BEGIN("Present", -1);
     SDL_GL_SwapWindow(m_Window);
+    FRAME_TRACE_END("Present");
 
     if (m_BlockingSwapBuffers) {
         // This glClear() requires the new back buffer to complete. This ensures
@@ -2,6 +2,7 @@
 
 #include "streaming/streamutils.h"
 #include "streaming/session.h"
+#include "streaming/ratelimitedlog.h"
 
 #include <Limelight.h>
 
@@ -357,9 +358,9 @@ void MmalRenderer::renderFrame(AVFrame* frame)
 
     status = mmal_port_send_buffer(m_InputPort, buffer);
     if (status != MMAL_SUCCESS) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "mmal_port_send_buffer() failed: %x (%s)",
-                     status, mmal_status_to_string(status));
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "mmal_port_send_buffer() failed: %x (%s)",
+                               status, mmal_status_to_string(status));
     }
     else {
         // Prevent the buffer from being freed during av_frame_free()
@@ -1,4 +1,5 @@
 #include "dxvsyncsource.h"
+#include "streaming/ratelimitedlog.h"
 
 // Useful references:
 // https://bugs.chromium.org/p/chromium/issues/detail?id=467617
@@ -138,9 +139,9 @@ void DxVsyncSource::waitForVsync()
 
     status = m_D3DKMTWaitForVerticalBlankEvent(&m_WaitForVblankEventParams);
     if (status != STATUS_SUCCESS) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "D3DKMTWaitForVerticalBlankEvent() failed: %x",
-                     status);
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "D3DKMTWaitForVerticalBlankEvent() failed: %x",
+                               status);
         return;
     }
 }
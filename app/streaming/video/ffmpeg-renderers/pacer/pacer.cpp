@@ -1,5 +1,7 @@
 #include "pacer.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
+#include "startuptracer.h"
 
 #ifdef Q_OS_WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -32,6 +34,7 @@ Pacer::Pacer(IFFmpegRenderer* renderer, PVIDEO_STATS videoStats) :
     m_RenderThread(nullptr),
     m_VsyncThread(nullptr),
     m_Stopping(false),
+    m_VsyncSuspended(false),
     m_VsyncSource(nullptr),
     m_VsyncRenderer(renderer),
     m_MaxVideoFps(0),
@@ -78,6 +81,55 @@ Pacer::~Pacer()
     }
 }
 
+void Pacer::flush()
+{
+    m_FrameQueueLock.lock();
+
+    while (!m_RenderQueue.isEmpty()) {
+        AVFrame* frame = m_RenderQueue.dequeue();
+        av_frame_free(&frame);
+    }
+    while (!m_PacingQueue.isEmpty()) {
+        AVFrame* frame = m_PacingQueue.dequeue();
+        av_frame_free(&frame);
+    }
+
+    m_RenderQueueHistory.clear();
+    m_PacingQueueHistory.clear();
+
+    m_FrameQueueLock.unlock();
+}
+
+void Pacer::suspend()
+{
+    // The render thread just sleeps on the empty render queue, but the
+    // V-sync thread would keep waking up every V-sync for no frames.
+    if (m_VsyncThread != nullptr) {
+        m_VsyncSuspended = true;
+        m_PacingQueueNotEmpty.wakeAll();
+        m_VsyncSignalled.wakeAll();
+        SDL_WaitThread(m_VsyncThread, nullptr);
+        m_VsyncThread = nullptr;
+    }
+
+    flush();
+}
+
+void Pacer::resume()
+{
+    if (!m_VsyncSuspended) {
+        return;
+    }
+
+    m_VsyncSuspended = false;
+    m_VsyncThread = SDL_CreateThread(Pacer::vsyncThread, "PacerVsync", this);
+    if (m_VsyncThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to restart V-sync thread: %s",
+                     SDL_GetError());
+    }
+}
+
 void Pacer::renderOnMainThread()
 {
     // Ignore this call for renderers that work on a dedicated render thread
@@ -102,6 +154,8 @@ int Pacer::vsyncThread(void *context)
 {
     Pacer* me = reinterpret_cast<Pacer*>(context);
 
+    FRAME_TRACE_THREAD_NAME("PacerVsync");
+
 #if SDL_VERSION_ATLEAST(2, 0, 9)
     SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
 #else
@@ -109,7 +163,7 @@ int Pacer::vsyncThread(void *context)
 #endif
 
     bool async = me->m_VsyncSource->isAsync();
-    while (!me->m_Stopping) {
+    while (!me->m_Stopping && !me->m_VsyncSuspended) {
         if (async) {
             // Wait for the VSync source to invoke signalVsync() or 100ms to elapse
             me->m_FrameQueueLock.lock();
@@ -121,7 +175,7 @@ int Pacer::vsyncThread(void *context)
             me->m_VsyncSource->waitForVsync();
         }
 
-        if (me->m_Stopping) {
+        if (me->m_Stopping || me->m_VsyncSuspended) {
             break;
         }
 
@@ -135,6 +189,8 @@ int Pacer::renderThread(void* context)
 {
     Pacer* me = reinterpret_cast<Pacer*>(context);
 
+    FRAME_TRACE_THREAD_NAME("PacerRender");
+
     if (SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) < 0) {
         SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
                     "Unable to set render thread to high priority: %s",
@@ -177,6 +233,7 @@ void Pacer::enqueueFrameForRenderingAndUnlock(AVFrame *frame)
 {
     dropFrameForEnqueue(m_RenderQueue);
     m_RenderQueue.enqueue(frame);
+    FRAME_TRACE_INSTANT("RenderEnqueue", m_RenderQueue.size());
 
     m_FrameQueueLock.unlock();
 
@@ -200,6 +257,8 @@ void Pacer::handleVsync(int timeUntilNextVsyncMillis)
     // Make sure initialize() has been called
     SDL_assert(m_MaxVideoFps != 0);
 
+    FRAME_TRACE_INSTANT("Vsync", -1);
+
     m_FrameQueueLock.lock();
 
     // If the queue length history entries are large, be strict
@@ -234,6 +293,7 @@ void Pacer::handleVsync(int timeUntilNextVsyncMillis)
         // Drop the lock while we call av_frame_free()
         m_FrameQueueLock.unlock();
         m_VideoStats->pacerDroppedFrames++;
+        FRAME_TRACE_INSTANT("PacerDrop", -1);
         av_frame_free(&frame);
         m_FrameQueueLock.lock();
     }
@@ -246,7 +306,7 @@ void Pacer::handleVsync(int timeUntilNextVsyncMillis)
             return;
         }
 
-        if (m_Stopping) {
+        if (m_Stopping || m_VsyncSuspended) {
             m_FrameQueueLock.unlock();
             return;
         }
@@ -337,13 +397,18 @@ void Pacer::renderFrame(AVFrame* frame)
     m_VideoStats->totalPacerTime += beforeRender - frame->pkt_dts;
 
     // Render it
+    FRAME_TRACE_BEGIN("RenderFrame", -1);
     m_VsyncRenderer->renderFrame(frame);
+    FRAME_TRACE_END("RenderFrame");
     Uint32 afterRender = SDL_GetTicks();
 
     m_VideoStats->totalRenderTime += afterRender - beforeRender;
     m_VideoStats->renderedFrames++;
     av_frame_free(&frame);
 
+    // Only the first frame of the stream is recorded. Later calls do nothing.
+    STARTUP_TRACE_FINISH("stream", "First frame rendered");
+
     // Drop frames if we have too many queued up for a while
     m_FrameQueueLock.lock();
 
@@ -380,6 +445,7 @@ void Pacer::renderFrame(AVFrame* frame)
         // Drop the lock while we call av_frame_free()
         m_FrameQueueLock.unlock();
         m_VideoStats->pacerDroppedFrames++;
+        FRAME_TRACE_INSTANT("PacerDrop", -1);
         av_frame_free(&frame);
         m_FrameQueueLock.lock();
     }
@@ -392,6 +458,7 @@ void Pacer::dropFrameForEnqueue(QQueue<AVFrame*>& queue)
     SDL_assert(queue.size() <= MAX_QUEUED_FRAMES);
     if (queue.size() == MAX_QUEUED_FRAMES) {
         AVFrame* frame = queue.dequeue();
+        FRAME_TRACE_INSTANT("PacerDrop", -1);
         av_frame_free(&frame);
     }
 }
@@ -406,6 +473,7 @@ void Pacer::submitFrame(AVFrame* frame)
     if (m_VsyncSource != nullptr) {
         dropFrameForEnqueue(m_PacingQueue);
         m_PacingQueue.enqueue(frame);
+        FRAME_TRACE_INSTANT("PacerEnqueue", m_PacingQueue.size());
         m_FrameQueueLock.unlock();
         m_PacingQueueNotEmpty.wakeOne();
     }
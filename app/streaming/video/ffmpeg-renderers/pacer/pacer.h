@@ -37,6 +37,15 @@ public:
 
     void renderOnMainThread();
 
+    // Drops all frames waiting to be paced or rendered
+    void flush();
+
+    // Stops and restarts V-sync handling while the decoder is parked
+    // between sessions. No frames may be submitted while suspended.
+    void suspend();
+
+    void resume();
+
 private:
     static int vsyncThread(void* context);
 
@@ -61,6 +70,7 @@ private:
     SDL_Thread* m_RenderThread;
     SDL_Thread* m_VsyncThread;
     bool m_Stopping;
+    bool m_VsyncSuspended;
 
     IVsyncSource* m_VsyncSource;
     IFFmpegRenderer* m_VsyncRenderer;
@@ -2,6 +2,8 @@
 
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
+#include "streaming/ratelimitedlog.h"
 
 // Implementation in plvk_c.c
 #define PL_LIBAV_IMPLEMENTATION 0
@@ -858,16 +860,19 @@ void PlVkRenderer::renderFrame(AVFrame *frame)
     targetFrame.num_overlays = (int)overlays.size();
     targetFrame.overlays = overlays.data();
     if (!pl_render_image(m_Renderer, &mappedFrame, &targetFrame, &pl_render_fast_params)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "pl_render_image() failed");
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "pl_render_image() failed");
         // NB: We must fallthrough to call pl_swapchain_submit_frame()
     }
 
     // Submit the frame for display and swap buffers
     m_HasPendingSwapchainFrame = false;
-    if (!pl_swapchain_submit_frame(m_Swapchain)) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "pl_swapchain_submit_frame() failed");
+    FRAME_TRACE_BEGIN("Present", -1);
+    bool submitted = pl_swapchain_submit_frame(m_Swapchain);
+    FRAME_TRACE_END("Present");
+    if (!submitted) {
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "pl_swapchain_submit_frame() failed");
 
         // Recreate the renderer
         SDL_Event event;
@@ -2,6 +2,8 @@
 
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
+#include "streaming/ratelimitedlog.h"
 
 #include <Limelight.h>
 
@@ -486,9 +488,9 @@ ReadbackRetry:
 
             err = SDL_LockTexture(m_Texture, nullptr, (void**)&pixels, &texturePitch);
             if (err < 0) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                             "SDL_LockTexture() failed: %s",
-                             SDL_GetError());
+                RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                       "SDL_LockTexture() failed: %s",
+                                       SDL_GetError());
                 goto Exit;
             }
 
@@ -535,9 +537,9 @@ ReadbackRetry:
 
         err = SDL_LockTexture(m_Texture, nullptr, (void**)&pixels, &texturePitch);
         if (err < 0) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "SDL_LockTexture() failed: %s",
-                         SDL_GetError());
+            RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                   "SDL_LockTexture() failed: %s",
+                                   SDL_GetError());
             goto Exit;
         }
 
@@ -560,9 +562,9 @@ ReadbackRetry:
 
         if (err < 0) {
             char string[AV_ERROR_MAX_STRING_SIZE];
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "sws_scale_frame() failed: %s",
-                         av_make_error_string(string, AV_ERROR_MAX_STRING_SIZE, err));
+            RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                   "sws_scale_frame() failed: %s",
+                                   av_make_error_string(string, AV_ERROR_MAX_STRING_SIZE, err));
             goto Exit;
         }
     }
@@ -593,7 +595,9 @@ ReadbackRetry:
         renderOverlay((Overlay::OverlayType)i);
     }
 
+    FRAME_TRACE_BEGIN("Present", -1);
     SDL_RenderPresent(m_Renderer);
+    FRAME_TRACE_END("Present");
 
 Exit:
     if (swFrame != nullptr) {
@@ -7,6 +7,7 @@
 
 #include "vaapi.h"
 #include "utils.h"
+#include "streaming/ratelimitedlog.h"
 #include <streaming/streamutils.h>
 
 #ifdef HAVE_LIBVA_DRM
@@ -843,9 +844,9 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
                 m_OverlaySubpicture[type] = 0;
             }
             else {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                             "vaAssociateSubpicture() failed: %d",
-                             status);
+                RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                       "vaAssociateSubpicture() failed: %d",
+                                       status);
             }
         }
 
@@ -876,9 +877,9 @@ VAAPIRenderer::renderFrame(AVFrame* frame)
             // Deassociate the subpicture so it can be safely destroyed/replaced
             status = vaDeassociateSubpicture(vaDeviceContext->display, associatedOverlaySubpictures[type], &surface, 1);
             if (status != VA_STATUS_SUCCESS) {
-                SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                             "vaDeassociateSubpicture() failed: %d",
-                             status);
+                RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                                       "vaDeassociateSubpicture() failed: %d",
+                                       status);
             }
 
             // If a new subpicture was populated while we were unlocked, free the old one we took ownership of
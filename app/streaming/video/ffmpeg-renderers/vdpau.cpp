@@ -1,5 +1,6 @@
 #include <streaming/session.h>
 #include "vdpau.h"
+#include "streaming/ratelimitedlog.h"
 #include <streaming/streamutils.h>
 #include <utils.h>
 
@@ -508,9 +509,9 @@ void VDPAURenderer::renderOverlay(VdpOutputSurface destination, Overlay::Overlay
     SDL_UnlockMutex(m_OverlayMutex);
 
     if (status != VDP_STATUS_OK) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "VdpOutputSurfaceRenderBitmapSurface() failed: %s",
-                     m_VdpGetErrorString(status));
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "VdpOutputSurfaceRenderBitmapSurface() failed: %s",
+                               m_VdpGetErrorString(status));
         return;
     }
 }
@@ -615,9 +616,9 @@ void VDPAURenderer::renderFrame(AVFrame* frame)
                                    0,
                                    nullptr);
     if (status != VDP_STATUS_OK) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "VdpVideoMixerRender() failed: %s",
-                     m_VdpGetErrorString(status));
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "VdpVideoMixerRender() failed: %s",
+                               m_VdpGetErrorString(status));
         return;
     }
 
@@ -629,9 +630,9 @@ void VDPAURenderer::renderFrame(AVFrame* frame)
     // Queue the frame for display immediately
     status = m_VdpPresentationQueueDisplay(m_PresentationQueue, chosenSurface, 0, 0, 0);
     if (status != VDP_STATUS_OK) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                     "VdpPresentationQueueDisplay() failed: %s",
-                     m_VdpGetErrorString(status));
+        RATE_LIMITED_LOG_ERROR(SDL_LOG_CATEGORY_APPLICATION,
+                               "VdpPresentationQueueDisplay() failed: %s",
+                               m_VdpGetErrorString(status));
         return;
     }
 }
@@ -9,6 +9,7 @@
 #include <Limelight.h>
 #include "streaming/session.h"
 #include "streaming/streamutils.h"
+#include "streaming/frametracer.h"
 #include "path.h"
 
 #import <Cocoa/Cocoa.h>
@@ -644,8 +645,10 @@ public:
         }
 
         // Flip to the newly rendered buffer
+        FRAME_TRACE_BEGIN("Present", -1);
         [commandBuffer presentDrawable:m_NextDrawable];
         [commandBuffer commit];
+        FRAME_TRACE_END("Present");
 
         // Wait for the command buffer to complete and free our CVMetalTextureCache references
         [commandBuffer waitUntilCompleted];
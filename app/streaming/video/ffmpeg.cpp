@@ -1,6 +1,10 @@
 #include <Limelight.h>
 #include "ffmpeg.h"
+#include "syntheticstream.h"
 #include "streaming/session.h"
+#include "streaming/frametracer.h"
+#include "streaming/metricsexporter.h"
+#include "streaming/ratelimitedlog.h"
 
 #include <h264_stream.h>
 
@@ -107,6 +111,195 @@ bool FFmpegVideoDecoder::notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info)
     return m_FrontendRenderer->notifyWindowChanged(info);
 }
 
+bool FFmpegVideoDecoder::startDecoding()
+{
+    if (m_DecoderThread != nullptr) {
+        return true;
+    }
+
+    m_DecoderThread = SDL_CreateThread(FFmpegVideoDecoder::decoderThreadProcThunk, "FFDecoder", (void*)this);
+    if (m_DecoderThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Failed to create decoder thread: %s", SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+void FFmpegVideoDecoder::flushDecoder()
+{
+    // The decoder thread must not be decoding, unless this is that thread
+    m_Pacer->flush();
+    avcodec_flush_buffers(m_VideoDecoderCtx);
+    m_FramesIn = m_FramesOut = 0;
+    m_FrameInfoQueue.clear();
+    m_ConsecutiveFailedDecodes = 0;
+}
+
+bool FFmpegVideoDecoder::recover(PRECOVERY_INFO info)
+{
+    // Whatever happens next, the decoder thread must not be running
+    stopDecoding();
+
+    // If we were already recovering, this continues that recovery
+    if (m_Recovering) {
+        info->startTime = m_RecoveryInfo.startTime;
+        info->lastFrameNumber = m_RecoveryInfo.lastFrameNumber;
+    }
+    else {
+        info->lastFrameNumber = m_LastDecodedFrameNumber;
+    }
+
+    switch (info->tier) {
+    case RECOVERY_TIER_FLUSH:
+        flushDecoder();
+        break;
+
+    case RECOVERY_TIER_FRONTEND:
+        // We can only rebuild a frontend that's separate from the decoder
+        if (m_FrontendRenderer == m_BackendRenderer) {
+            return false;
+        }
+
+        flushDecoder();
+
+        // Pacer and the overlay manager reference the old frontend
+        delete m_Pacer;
+        m_Pacer = nullptr;
+        Session::get()->getOverlayManager().setOverlayRenderer(nullptr);
+        delete m_FrontendRenderer;
+        m_FrontendRenderer = nullptr;
+
+        // If any of this fails, reset() will clean up what's left
+        if (!createFrontendRenderer(&m_DecoderParams, m_UseAlternateFrontend) ||
+                !createPacer(&m_DecoderParams)) {
+            return false;
+        }
+
+        Session::get()->getOverlayManager().setOverlayRenderer(m_FrontendRenderer);
+        m_FrontendRenderer->prepareToRender();
+        break;
+
+    default:
+        return false;
+    }
+
+    if (!startDecoding()) {
+        return false;
+    }
+
+    m_RecoveryInfo = *info;
+    m_Recovering = true;
+    return true;
+}
+
+void FFmpegVideoDecoder::continueRecovery(PRECOVERY_INFO info)
+{
+    // This happens before the IDR frame that will complete the recovery
+    // is requested, so we can't race with the decoder thread here.
+    m_RecoveryInfo = *info;
+    m_Recovering = true;
+}
+
+void FFmpegVideoDecoder::completeRecovery()
+{
+    static const char* const k_TierNames[] = {
+        "codec flush",
+        "frontend renderer rebuild",
+        "full decoder rebuild",
+    };
+
+    // Frames in between were never decoded
+    int droppedFrames = 0;
+    if (m_RecoveryInfo.lastFrameNumber != 0) {
+        droppedFrames = m_LastDecodedFrameNumber - m_RecoveryInfo.lastFrameNumber - 1;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Recovered by %s in %u ms (%d frames dropped)",
+                k_TierNames[m_RecoveryInfo.tier],
+                SDL_GetTicks() - m_RecoveryInfo.startTime,
+                droppedFrames);
+
+    m_Recovering = false;
+}
+
+void FFmpegVideoDecoder::handleFailedDecode()
+{
+    if (++m_ConsecutiveFailedDecodes != FAILED_DECODES_RESET_THRESHOLD) {
+        return;
+    }
+
+    if (!m_Recovering) {
+        // Start with the cheapest recovery. We're on the decoder thread,
+        // so we can flush the codec ourselves. The caller will request
+        // an IDR frame.
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Flushing decoder due to consistent failure");
+
+        m_RecoveryInfo.tier = RECOVERY_TIER_FLUSH;
+        m_RecoveryInfo.startTime = SDL_GetTicks();
+        m_RecoveryInfo.lastFrameNumber = m_LastDecodedFrameNumber;
+        m_Recovering = true;
+
+        flushDecoder();
+    }
+    else {
+        // We're still failing after recovering, so the decoder/renderer is
+        // clearly unhealthy. Generate a synthetic reset event to trigger the
+        // event loop to destroy and recreate the decoder.
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Resetting decoder due to consistent failure");
+
+        SDL_Event event;
+        event.type = SDL_RENDER_DEVICE_RESET;
+        SDL_PushEvent(&event);
+
+        // Don't consume any additional data
+        SDL_AtomicSet(&m_DecoderThreadShouldQuit, 1);
+    }
+}
+
+bool FFmpegVideoDecoder::detachFromSession()
+{
+    // The synthetic stream is tied to the session
+    if (m_TestOnly || m_SyntheticStream != nullptr) {
+        return false;
+    }
+
+    // The decoder thread pulls frames from the session's connection.
+    // The next session will start it again with startDecoding().
+    stopDecoding();
+
+    // Nothing will be rendered until the next session either
+    m_Pacer->suspend();
+
+    // Discard everything from the old stream. The next stream
+    // will start with an IDR frame.
+    flushDecoder();
+    m_LastFrameNumber = 0;
+    m_LastDecodedFrameNumber = 0;
+    m_Recovering = false;
+
+    // Video stats are reported per session
+    logVideoStats(m_GlobalVideoStats, "Global video stats");
+    SDL_zero(m_ActiveWndVideoStats);
+    SDL_zero(m_LastWndVideoStats);
+    SDL_zero(m_GlobalVideoStats);
+
+    Session::get()->getOverlayManager().setOverlayRenderer(nullptr);
+    m_DetachedFromSession = true;
+    return true;
+}
+
+void FFmpegVideoDecoder::attachToSession()
+{
+    m_Pacer->resume();
+    Session::get()->getOverlayManager().setOverlayRenderer(m_FrontendRenderer);
+    m_DetachedFromSession = false;
+}
+
 int FFmpegVideoDecoder::getDecoderCapabilities()
 {
     bool ok;
@@ -230,12 +423,19 @@ FFmpegVideoDecoder::FFmpegVideoDecoder(bool testOnly)
       m_FramesIn(0),
       m_FramesOut(0),
       m_LastFrameNumber(0),
+      m_LastDecodedFrameNumber(0),
       m_StreamFps(0),
       m_VideoFormat(0),
       m_NeedsSpsFixup(false),
       m_TestOnly(testOnly),
-      m_DecoderThread(nullptr)
+      m_DetachedFromSession(false),
+      m_DecoderThread(nullptr),
+      m_SyntheticStream(nullptr),
+      m_UseAlternateFrontend(false),
+      m_Recovering(false)
 {
+    SDL_zero(m_DecoderParams);
+    SDL_zero(m_RecoveryInfo);
     SDL_zero(m_ActiveWndVideoStats);
     SDL_zero(m_LastWndVideoStats);
     SDL_zero(m_GlobalVideoStats);
@@ -264,17 +464,22 @@ IFFmpegRenderer* FFmpegVideoDecoder::getBackendRenderer()
     return m_BackendRenderer;
 }
 
-void FFmpegVideoDecoder::reset()
+void FFmpegVideoDecoder::stopDecoding()
 {
-    // Terminate the decoder thread before doing anything else.
-    // It might be touching things we're about to free.
     if (m_DecoderThread != nullptr) {
         SDL_AtomicSet(&m_DecoderThreadShouldQuit, 1);
-        LiWakeWaitForVideoFrame();
+        wakeWaitForVideoFrame();
         SDL_WaitThread(m_DecoderThread, NULL);
         SDL_AtomicSet(&m_DecoderThreadShouldQuit, 0);
         m_DecoderThread = nullptr;
     }
+}
+
+void FFmpegVideoDecoder::reset()
+{
+    // Terminate the decoder thread before doing anything else.
+    // It might be touching things we're about to free.
+    stopDecoding();
 
     m_FramesIn = m_FramesOut = 0;
     m_FrameInfoQueue.clear();
@@ -289,7 +494,8 @@ void FFmpegVideoDecoder::reset()
     // need to delete in the renderer destructor.
     avcodec_free_context(&m_VideoDecoderCtx);
 
-    if (!m_TestOnly) {
+    // A detached decoder may outlive its session
+    if (!m_TestOnly && !m_DetachedFromSession) {
         Session::get()->getOverlayManager().setOverlayRenderer(nullptr);
     }
 
@@ -460,6 +666,13 @@ bool FFmpegVideoDecoder::createFrontendRenderer(PDECODER_PARAMETERS params, bool
     return true;
 }
 
+bool FFmpegVideoDecoder::createPacer(PDECODER_PARAMETERS params)
+{
+    m_Pacer = new Pacer(m_FrontendRenderer, &m_ActiveWndVideoStats);
+    return m_Pacer->initialize(params->window, params->frameRate,
+                               params->enableFramePacing || (params->enableVsync && (m_FrontendRenderer->getRendererAttributes() & RENDERER_ATTRIBUTE_FORCE_PACING)));
+}
+
 bool FFmpegVideoDecoder::completeInitialization(const AVCodec* decoder, enum AVPixelFormat requiredFormat, PDECODER_PARAMETERS params, bool testFrame, bool useAlternateFrontend)
 {
     // In test-only mode, we should only see test frames
@@ -476,11 +689,12 @@ bool FFmpegVideoDecoder::completeInitialization(const AVCodec* decoder, enum AVP
 
     // Don't bother initializing Pacer if we're not actually going to render
     if (!testFrame) {
-        m_Pacer = new Pacer(m_FrontendRenderer, &m_ActiveWndVideoStats);
-        if (!m_Pacer->initialize(params->window, params->frameRate,
-                                 params->enableFramePacing || (params->enableVsync && (m_FrontendRenderer->getRendererAttributes() & RENDERER_ATTRIBUTE_FORCE_PACING)))) {
+        if (!createPacer(params)) {
             return false;
         }
+
+        m_DecoderParams = *params;
+        m_UseAlternateFrontend = useAlternateFrontend;
     }
 
     m_VideoDecoderCtx = avcodec_alloc_context3(decoder);
@@ -670,12 +884,13 @@ bool FFmpegVideoDecoder::completeInitialization(const AVCodec* decoder, enum AVP
         // Allow the renderer to perform final preparations for rendering
         m_FrontendRenderer->prepareToRender();
 
+        // Consume frames from the synthetic stream instead of moonlight-common-c if one is active
+        m_SyntheticStream = Session::get()->getSyntheticVideoStream();
+
         // Only create the decoder thread when instantiating the decoder for real. It will use APIs from
-        // moonlight-common-c that can only be legally called with an established connection.
-        m_DecoderThread = SDL_CreateThread(FFmpegVideoDecoder::decoderThreadProcThunk, "FFDecoder", (void*)this);
-        if (m_DecoderThread == nullptr) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "Failed to create decoder thread: %s", SDL_GetError());
+        // moonlight-common-c that can only be legally called with an established connection, so decoders
+        // created before the connection is established start it later.
+        if (!params->deferDecoding && !startDecoding()) {
             return false;
         }
 
@@ -744,82 +959,73 @@ void FFmpegVideoDecoder::addVideoStats(VIDEO_STATS& src, VIDEO_STATS& dst)
     dst.renderedFps = (float)dst.renderedFrames / ((float)(now - dst.measurementStartTimestamp) / 1000);
 }
 
-void FFmpegVideoDecoder::stringifyVideoStats(VIDEO_STATS& stats, char* output, int length)
+const char* FFmpegVideoDecoder::getCodecString()
 {
-    int offset = 0;
-    const char* codecString;
-    int ret;
-
-    // Start with an empty string
-    output[offset] = 0;
-
     switch (m_VideoFormat)
     {
     case VIDEO_FORMAT_H264:
-        codecString = "H.264";
-        break;
+        return "H.264";
 
     case VIDEO_FORMAT_H264_HIGH8_444:
-        codecString = "H.264 4:4:4";
-        break;
+        return "H.264 4:4:4";
 
     case VIDEO_FORMAT_H265:
-        codecString = "HEVC";
-        break;
+        return "HEVC";
 
     case VIDEO_FORMAT_H265_REXT8_444:
-        codecString = "HEVC 4:4:4";
-        break;
+        return "HEVC 4:4:4";
 
     case VIDEO_FORMAT_H265_MAIN10:
         if (LiGetCurrentHostDisplayHdrMode()) {
-            codecString = "HEVC 10-bit HDR";
+            return "HEVC 10-bit HDR";
         }
         else {
-            codecString = "HEVC 10-bit SDR";
+            return "HEVC 10-bit SDR";
         }
-        break;
 
     case VIDEO_FORMAT_H265_REXT10_444:
         if (LiGetCurrentHostDisplayHdrMode()) {
-            codecString = "HEVC 10-bit HDR 4:4:4";
+            return "HEVC 10-bit HDR 4:4:4";
         }
         else {
-            codecString = "HEVC 10-bit SDR 4:4:4";
+            return "HEVC 10-bit SDR 4:4:4";
         }
-        break;
 
     case VIDEO_FORMAT_AV1_MAIN8:
-        codecString = "AV1";
-        break;
+        return "AV1";
 
     case VIDEO_FORMAT_AV1_HIGH8_444:
-        codecString = "AV1 4:4:4";
-        break;
+        return "AV1 4:4:4";
 
     case VIDEO_FORMAT_AV1_MAIN10:
         if (LiGetCurrentHostDisplayHdrMode()) {
-            codecString = "AV1 10-bit HDR";
+            return "AV1 10-bit HDR";
         }
         else {
-            codecString = "AV1 10-bit SDR";
+            return "AV1 10-bit SDR";
         }
-        break;
 
     case VIDEO_FORMAT_AV1_HIGH10_444:
         if (LiGetCurrentHostDisplayHdrMode()) {
-            codecString = "AV1 10-bit HDR 4:4:4";
+            return "AV1 10-bit HDR 4:4:4";
         }
         else {
-            codecString = "AV1 10-bit SDR 4:4:4";
+            return "AV1 10-bit SDR 4:4:4";
         }
-        break;
 
     default:
         SDL_assert(false);
-        codecString = "UNKNOWN";
-        break;
+        return "UNKNOWN";
     }
+}
+
+void FFmpegVideoDecoder::stringifyVideoStats(VIDEO_STATS& stats, char* output, int length)
+{
+    int offset = 0;
+    int ret;
+
+    // Start with an empty string
+    output[offset] = 0;
 
     if (stats.receivedFps > 0) {
         if (m_VideoDecoderCtx != nullptr) {
@@ -829,7 +1035,7 @@ void FFmpegVideoDecoder::stringifyVideoStats(VIDEO_STATS& stats, char* output, i
                            m_VideoDecoderCtx->width,
                            m_VideoDecoderCtx->height,
                            stats.totalFps,
-                           codecString);
+                           getCodecString());
             if (ret < 0 || ret >= length - offset) {
                 SDL_assert(false);
                 return;
@@ -1657,6 +1863,8 @@ int FFmpegVideoDecoder::decoderThreadProcThunk(void *context)
 
 void FFmpegVideoDecoder::decoderThreadProc()
 {
+    FRAME_TRACE_THREAD_NAME("FFDecoder");
+
     while (!SDL_AtomicGet(&m_DecoderThreadShouldQuit)) {
         if (m_FramesIn == m_FramesOut) {
             VIDEO_FRAME_HANDLE handle;
@@ -1664,12 +1872,12 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
             // Waiting for input. All output frames have been received.
             // Block until we receive a new frame from the host.
-            if (!LiWaitForNextVideoFrame(&handle, &du)) {
+            if (!waitForNextVideoFrame(&handle, &du)) {
                 // This might be a signal from the main thread to exit
                 continue;
             }
 
-            LiCompleteVideoFrame(handle, submitDecodeUnit(du));
+            completeVideoFrame(handle, submitDecodeUnit(du));
         }
 
         if (m_FramesIn != m_FramesOut) {
@@ -1688,6 +1896,7 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
             int err;
             do {
+                Uint64 receiveStartTime = FrameTracer::now();
                 err = avcodec_receive_frame(m_VideoDecoderCtx, frame);
                 if (err == 0) {
                     SDL_assert(m_FrameInfoQueue.size() == m_FramesIn - m_FramesOut);
@@ -1747,6 +1956,14 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
                         // Store the presentation time
                         frame->pts = du.presentationTimeMs;
+
+                        FRAME_TRACE_COMPLETE("avcodec_receive_frame", receiveStartTime, du.frameNumber);
+
+                        m_LastDecodedFrameNumber = du.frameNumber;
+                    }
+
+                    if (m_Recovering) {
+                        completeRecovery();
                     }
 
                     m_ActiveWndVideoStats.decodedFrames++;
@@ -1760,9 +1977,9 @@ void FFmpegVideoDecoder::decoderThreadProc()
 
                     // No output data, so let's try to submit more input data,
                     // while we're waiting for this to frame to come back.
-                    if (LiPollNextVideoFrame(&handle, &du)) {
+                    if (pollNextVideoFrame(&handle, &du)) {
                         // FIXME: Handle EAGAIN on avcodec_send_packet() properly?
-                        LiCompleteVideoFrame(handle, submitDecodeUnit(du));
+                        completeVideoFrame(handle, submitDecodeUnit(du));
                     }
                     else {
                         // No output data or input data. Let's wait a little bit.
@@ -1775,26 +1992,16 @@ void FFmpegVideoDecoder::decoderThreadProc()
                     // FIXME: Should we pop an entry off m_FrameInfoQueue here?
 
                     av_strerror(err, errorstring, sizeof(errorstring));
-                    SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                                "avcodec_receive_frame() failed: %s (frame %d)",
-                                errorstring,
-                                !m_FrameInfoQueue.isEmpty() ? m_FrameInfoQueue.head().frameNumber : -1);
+                    RATE_LIMITED_LOG_WARN(SDL_LOG_CATEGORY_APPLICATION,
+                                          "avcodec_receive_frame() failed: %s (frame %d)",
+                                          errorstring,
+                                          !m_FrameInfoQueue.isEmpty() ? m_FrameInfoQueue.head().frameNumber : -1);
 
-                    if (++m_ConsecutiveFailedDecodes == FAILED_DECODES_RESET_THRESHOLD) {
-                        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                                     "Resetting decoder due to consistent failure");
-
-                        SDL_Event event;
-                        event.type = SDL_RENDER_DEVICE_RESET;
-                        SDL_PushEvent(&event);
-
-                        // Don't consume any additional data
-                        SDL_AtomicSet(&m_DecoderThreadShouldQuit, 1);
-                    }
+                    handleFailedDecode();
 
                     // Just in case the error resulted in the loss of the frame,
                     // request an IDR frame to reset our decoder state.
-                    LiRequestIdrFrame();
+                    requestIdrFrame();
                 }
             } while (err == AVERROR(EAGAIN) && !SDL_AtomicGet(&m_DecoderThreadShouldQuit));
 
@@ -1806,6 +2013,54 @@ void FFmpegVideoDecoder::decoderThreadProc()
     }
 }
 
+bool FFmpegVideoDecoder::waitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit)
+{
+    if (m_SyntheticStream != nullptr) {
+        return m_SyntheticStream->waitForNextVideoFrame(frameHandle, decodeUnit);
+    }
+
+    return LiWaitForNextVideoFrame(frameHandle, decodeUnit);
+}
+
+bool FFmpegVideoDecoder::pollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit)
+{
+    if (m_SyntheticStream != nullptr) {
+        return m_SyntheticStream->pollNextVideoFrame(frameHandle, decodeUnit);
+    }
+
+    return LiPollNextVideoFrame(frameHandle, decodeUnit);
+}
+
+void FFmpegVideoDecoder::completeVideoFrame(VIDEO_FRAME_HANDLE frameHandle, int drStatus)
+{
+    if (m_SyntheticStream != nullptr) {
+        m_SyntheticStream->completeVideoFrame(frameHandle, drStatus);
+    }
+    else {
+        LiCompleteVideoFrame(frameHandle, drStatus);
+    }
+}
+
+void FFmpegVideoDecoder::wakeWaitForVideoFrame()
+{
+    if (m_SyntheticStream != nullptr) {
+        m_SyntheticStream->wakeWaitForVideoFrame();
+    }
+    else {
+        LiWakeWaitForVideoFrame();
+    }
+}
+
+void FFmpegVideoDecoder::requestIdrFrame()
+{
+    if (m_SyntheticStream != nullptr) {
+        m_SyntheticStream->requestIdrFrame();
+    }
+    else {
+        LiRequestIdrFrame();
+    }
+}
+
 int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
 {
     PLENTRY entry = du->bufferList;
@@ -1837,15 +2092,32 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
             addVideoStats(m_LastWndVideoStats, lastTwoWndStats);
             addVideoStats(m_ActiveWndVideoStats, lastTwoWndStats);
 
-            stringifyVideoStats(lastTwoWndStats,
-                                Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug),
-                                Session::get()->getOverlayManager().getOverlayMaxTextLength());
+            char* overlayText = Session::get()->getOverlayManager().getOverlayText(Overlay::OverlayDebug);
+            int overlayMaxLength = Session::get()->getOverlayManager().getOverlayMaxTextLength();
+            stringifyVideoStats(lastTwoWndStats, overlayText, overlayMaxLength);
+
+            int offset = (int)strlen(overlayText);
+            SdlInputHandler::stringifyInputStats(&overlayText[offset], overlayMaxLength - offset);
+
             Session::get()->getOverlayManager().setOverlayTextUpdated(Overlay::OverlayDebug);
         }
 
         // Accumulate these values into the global stats
         addVideoStats(m_ActiveWndVideoStats, m_GlobalVideoStats);
 
+        // Hand off a snapshot of this window to the metrics export thread
+        if (MetricsExporter::isEnabled()) {
+            VIDEO_STATS wndStats = {};
+            addVideoStats(m_ActiveWndVideoStats, wndStats);
+
+            MetricsExporter::updateVideoStats(wndStats, m_GlobalVideoStats,
+                                              getCodecString(),
+                                              m_VideoDecoderCtx != nullptr ? m_VideoDecoderCtx->width : 0,
+                                              m_VideoDecoderCtx != nullptr ? m_VideoDecoderCtx->height : 0,
+                                              m_VideoDecoderCtx != nullptr ? m_VideoDecoderCtx->codec->name : "",
+                                              m_FrontendRenderer->getRendererName());
+        }
+
         // Move this window into the last window slot and clear it for next window
         SDL_memcpy(&m_LastWndVideoStats, &m_ActiveWndVideoStats, sizeof(m_ActiveWndVideoStats));
         SDL_zero(m_ActiveWndVideoStats);
@@ -1894,29 +2166,22 @@ int FFmpegVideoDecoder::submitDecodeUnit(PDECODE_UNIT du)
 
     m_ActiveWndVideoStats.totalReassemblyTime += du->enqueueTimeMs - du->receiveTimeMs;
 
+    FRAME_TRACE_COMPLETE_MS("DecodeUnitReassembly", du->receiveTimeMs, du->enqueueTimeMs, du->frameNumber);
+    FRAME_TRACE_COMPLETE_MS("DecodeUnitQueue", du->enqueueTimeMs, LiGetMillis(), du->frameNumber);
+
+    FRAME_TRACE_BEGIN("avcodec_send_packet", du->frameNumber);
     err = avcodec_send_packet(m_VideoDecoderCtx, m_Pkt);
+    FRAME_TRACE_END("avcodec_send_packet");
     if (err < 0) {
         char errorstring[512];
         av_strerror(err, errorstring, sizeof(errorstring));
-        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
-                    "avcodec_send_packet() failed: %s (frame %d)",
-                    errorstring,
-                    du->frameNumber);
-
-        // If we've failed a bunch of decodes in a row, the decoder/renderer is
-        // clearly unhealthy, so let's generate a synthetic reset event to trigger
-        // the event loop to destroy and recreate the decoder.
-        if (++m_ConsecutiveFailedDecodes == FAILED_DECODES_RESET_THRESHOLD) {
-            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
-                         "Resetting decoder due to consistent failure");
+        RATE_LIMITED_LOG_WARN(SDL_LOG_CATEGORY_APPLICATION,
+                              "avcodec_send_packet() failed: %s (frame %d)",
+                              errorstring,
+                              du->frameNumber);
 
-            SDL_Event event;
-            event.type = SDL_RENDER_DEVICE_RESET;
-            SDL_PushEvent(&event);
-
-            // Don't consume any additional data
-            SDL_AtomicSet(&m_DecoderThreadShouldQuit, 1);
-        }
+        // If we've failed a bunch of decodes in a row, try to recover
+        handleFailedDecode();
 
         return DR_NEED_IDR;
     }
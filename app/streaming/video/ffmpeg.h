@@ -12,6 +12,8 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 }
 
+class SyntheticVideoStream;
+
 class FFmpegVideoDecoder : public IVideoDecoder {
 public:
     FFmpegVideoDecoder(bool testOnly);
@@ -28,6 +30,11 @@ public:
     virtual void renderFrameOnMainThread() override;
     virtual void setHdrMode(bool enabled) override;
     virtual bool notifyWindowChanged(PWINDOW_STATE_CHANGE_INFO info) override;
+    virtual bool startDecoding() override;
+    virtual bool recover(PRECOVERY_INFO info) override;
+    virtual void continueRecovery(PRECOVERY_INFO info) override;
+    virtual bool detachFromSession() override;
+    virtual void attachToSession() override;
 
     virtual IFFmpegRenderer* getBackendRenderer();
 
@@ -38,6 +45,8 @@ private:
                                 bool testFrame,
                                 bool useAlternateFrontend);
 
+    const char* getCodecString();
+
     void stringifyVideoStats(VIDEO_STATS& stats, char* output, int length);
 
     void logVideoStats(VIDEO_STATS& stats, const char* title);
@@ -46,6 +55,14 @@ private:
 
     bool createFrontendRenderer(PDECODER_PARAMETERS params, bool useAlternateFrontend);
 
+    bool createPacer(PDECODER_PARAMETERS params);
+
+    void flushDecoder();
+
+    void handleFailedDecode();
+
+    void completeRecovery();
+
     static
     bool isDecoderMatchForParams(const AVCodec *decoder, PDECODER_PARAMETERS params);
 
@@ -80,6 +97,8 @@ private:
 
     void reset();
 
+    void stopDecoding();
+
     void writeBuffer(PLENTRY entry, int& offset);
 
     static
@@ -90,6 +109,13 @@ private:
 
     static int decoderThreadProcThunk(void* context);
 
+    // These dispatch to moonlight-common-c or the synthetic stream
+    bool waitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
+    bool pollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
+    void completeVideoFrame(VIDEO_FRAME_HANDLE frameHandle, int drStatus);
+    void wakeWaitForVideoFrame();
+    void requestIdrFrame();
+
     AVPacket* m_Pkt;
     AVCodecContext* m_VideoDecoderCtx;
     enum AVPixelFormat m_RequiredPixelFormat;
@@ -108,12 +134,22 @@ private:
     int m_FramesOut;
 
     int m_LastFrameNumber;
+    int m_LastDecodedFrameNumber;
     int m_StreamFps;
     int m_VideoFormat;
     bool m_NeedsSpsFixup;
     bool m_TestOnly;
+    bool m_DetachedFromSession;
     SDL_Thread* m_DecoderThread;
     SDL_atomic_t m_DecoderThreadShouldQuit;
+    SyntheticVideoStream* m_SyntheticStream;
+
+    // Kept to rebuild the frontend renderer during recovery
+    DECODER_PARAMETERS m_DecoderParams;
+    bool m_UseAlternateFrontend;
+
+    bool m_Recovering;
+    RECOVERY_INFO m_RecoveryInfo;
 
     // Data buffers in the queued DU are not valid
     QQueue<DECODE_UNIT> m_FrameInfoQueue;
@@ -46,7 +46,8 @@ private:
         bool enabled;
         int fontSize;
         SDL_Color color;
-        char text[512];
+        // Large enough for the video stats plus a line for each input class
+        char text[1024];
 
         TTF_Font* font;
         SDL_Surface* surface;
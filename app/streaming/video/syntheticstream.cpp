@@ -0,0 +1,599 @@
+#include "syntheticstream.h"
+
+#include <Limelight.h>
+
+#include <QString>
+
+extern "C" {
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+}
+
+// Number of unique frames in the looping pattern. The first frame
+// is an IDR frame and the remaining frames are P-frames.
+#define PATTERN_CYCLE_FRAMES 120
+
+// Maximum number of decode units waiting for the decoder before
+// we drop the backlog and restart at an IDR frame
+#define MAX_QUEUED_FRAMES 16
+
+SyntheticVideoStream::SyntheticVideoStream(int videoFormat, int width, int height,
+                                           int frameRate, int bitrateKbps, int slicesPerFrame)
+    : m_VideoFormat(videoFormat),
+      m_Width(width),
+      m_Height(height),
+      m_FrameRate(frameRate),
+      m_BitrateKbps(bitrateKbps),
+      m_SlicesPerFrame(qMax(slicesPerFrame, 1)),
+      m_GeneratorThread(nullptr),
+      m_WakeRequested(false),
+      m_NextFrameNumber(0),
+      m_GeneratedFrames(0),
+      m_DroppedFrames(0),
+      m_IdrFrames(0)
+{
+    SDL_AtomicSet(&m_Stopping, 0);
+    SDL_AtomicSet(&m_IdrRequested, 0);
+}
+
+SyntheticVideoStream::~SyntheticVideoStream()
+{
+    stop();
+}
+
+bool SyntheticVideoStream::initialize()
+{
+    enum AVCodecID codecId;
+    if (m_VideoFormat & VIDEO_FORMAT_MASK_H264) {
+        codecId = AV_CODEC_ID_H264;
+    }
+    else if (m_VideoFormat & VIDEO_FORMAT_MASK_H265) {
+        codecId = AV_CODEC_ID_HEVC;
+    }
+    else if (m_VideoFormat & VIDEO_FORMAT_MASK_AV1) {
+        codecId = AV_CODEC_ID_AV1;
+    }
+    else {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unsupported synthetic video format: 0x%x",
+                     m_VideoFormat);
+        return false;
+    }
+
+    enum AVPixelFormat pixFmt;
+    if (m_VideoFormat & VIDEO_FORMAT_MASK_YUV444) {
+        pixFmt = (m_VideoFormat & VIDEO_FORMAT_MASK_10BIT) ? AV_PIX_FMT_YUV444P10 : AV_PIX_FMT_YUV444P;
+    }
+    else {
+        pixFmt = (m_VideoFormat & VIDEO_FORMAT_MASK_10BIT) ? AV_PIX_FMT_YUV420P10 : AV_PIX_FMT_YUV420P;
+    }
+
+    // Find a software encoder that can produce the requested format
+    const AVCodec* encoder = nullptr;
+    const AVCodec* codec;
+    void* codecIterator = nullptr;
+    while (encoder == nullptr && (codec = av_codec_iterate(&codecIterator))) {
+        if (!av_codec_is_encoder(codec) || codec->id != codecId) {
+            continue;
+        }
+
+        if (codec->capabilities & AV_CODEC_CAP_HARDWARE) {
+            continue;
+        }
+
+        const AVPixelFormat* encoder_pix_fmts;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+        if (avcodec_get_supported_config(nullptr, codec, AV_CODEC_CONFIG_PIX_FORMAT, 0,
+                                         (const void**)&encoder_pix_fmts, nullptr) < 0) {
+            encoder_pix_fmts = nullptr;
+        }
+#else
+        encoder_pix_fmts = codec->pix_fmts;
+#endif
+
+        for (int i = 0; encoder_pix_fmts && encoder_pix_fmts[i] != AV_PIX_FMT_NONE; i++) {
+            if (encoder_pix_fmts[i] == pixFmt) {
+                encoder = codec;
+                break;
+            }
+        }
+    }
+
+    if (encoder == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "No encoder available for %s (%s)",
+                     avcodec_get_name(codecId),
+                     av_get_pix_fmt_name(pixFmt));
+        return false;
+    }
+
+    AVCodecContext* encoderCtx = avcodec_alloc_context3(encoder);
+    if (encoderCtx == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to allocate encoder context");
+        return false;
+    }
+
+    encoderCtx->width = m_Width;
+    encoderCtx->height = m_Height;
+    encoderCtx->pix_fmt = pixFmt;
+    encoderCtx->time_base = av_make_q(1, m_FrameRate);
+    encoderCtx->framerate = av_make_q(m_FrameRate, 1);
+    encoderCtx->bit_rate = (int64_t)m_BitrateKbps * 1000;
+    encoderCtx->gop_size = PATTERN_CYCLE_FRAMES;
+    encoderCtx->max_b_frames = 0;
+    encoderCtx->refs = 1;
+    encoderCtx->slices = m_SlicesPerFrame;
+    encoderCtx->thread_count = 0;
+    encoderCtx->color_range = AVCOL_RANGE_MPEG;
+    encoderCtx->colorspace = (m_VideoFormat & VIDEO_FORMAT_MASK_10BIT) ? AVCOL_SPC_BT2020_NCL : AVCOL_SPC_BT709;
+
+    // Favor encoding speed since the pattern is encoded before streaming begins.
+    // Options not recognized by the chosen encoder are left in the dictionary.
+    AVDictionary* options = nullptr;
+    if (strcmp(encoder->name, "libx264") == 0) {
+        av_dict_set(&options, "preset", "ultrafast", 0);
+        av_dict_set(&options, "tune", "zerolatency", 0);
+    }
+    else if (strcmp(encoder->name, "libx265") == 0) {
+        av_dict_set(&options, "preset", "ultrafast", 0);
+        av_dict_set(&options, "tune", "zerolatency", 0);
+        av_dict_set(&options, "x265-params",
+                    QString("slices=%1:log-level=error").arg(m_SlicesPerFrame).toUtf8().constData(), 0);
+    }
+    else if (strcmp(encoder->name, "libsvtav1") == 0) {
+        av_dict_set(&options, "preset", "12", 0);
+    }
+    else if (strcmp(encoder->name, "libaom-av1") == 0) {
+        av_dict_set(&options, "usage", "realtime", 0);
+        av_dict_set(&options, "cpu-used", "8", 0);
+    }
+    else if (strcmp(encoder->name, "librav1e") == 0) {
+        av_dict_set(&options, "speed", "10", 0);
+    }
+
+    int err = avcodec_open2(encoderCtx, encoder, &options);
+    av_dict_free(&options);
+    if (err < 0) {
+        char errorstring[512];
+        av_strerror(err, errorstring, sizeof(errorstring));
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to open encoder %s: %s",
+                     encoder->name,
+                     errorstring);
+        avcodec_free_context(&encoderCtx);
+        return false;
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Encoding %d frame synthetic pattern with %s (%dx%d %s, %d slices)",
+                PATTERN_CYCLE_FRAMES,
+                encoder->name,
+                m_Width,
+                m_Height,
+                av_get_pix_fmt_name(pixFmt),
+                m_SlicesPerFrame);
+
+    Uint32 startTime = SDL_GetTicks();
+    bool ret = encodePatternCycle(encoderCtx);
+    avcodec_free_context(&encoderCtx);
+
+    if (!ret) {
+        return false;
+    }
+
+    if (m_Frames.isEmpty() || m_Frames.first().frameType != FRAME_TYPE_IDR) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Synthetic pattern does not begin with an IDR frame");
+        return false;
+    }
+
+    int totalBytes = 0;
+    for (const EncodedFrame& frame : m_Frames) {
+        totalBytes += frame.data.size();
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                "Encoded %d synthetic frames in %u ms (IDR: %d bytes, average: %d bytes)",
+                (int)m_Frames.size(),
+                SDL_GetTicks() - startTime,
+                (int)m_Frames.first().data.size(),
+                totalBytes / (int)m_Frames.size());
+
+    return true;
+}
+
+bool SyntheticVideoStream::encodePatternCycle(AVCodecContext* encoderCtx)
+{
+    AVFrame* frame = av_frame_alloc();
+    AVPacket* pkt = av_packet_alloc();
+    bool ret = false;
+    int err;
+
+    if (frame == nullptr || pkt == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to allocate encoder frame");
+        goto Exit;
+    }
+
+    frame->format = encoderCtx->pix_fmt;
+    frame->width = encoderCtx->width;
+    frame->height = encoderCtx->height;
+    err = av_frame_get_buffer(frame, 0);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "av_frame_get_buffer() failed: %d",
+                     err);
+        goto Exit;
+    }
+
+    for (int i = 0; i < PATTERN_CYCLE_FRAMES; i++) {
+        err = av_frame_make_writable(frame);
+        if (err < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "av_frame_make_writable() failed: %d",
+                         err);
+            goto Exit;
+        }
+
+        drawTestPattern(frame, i);
+        frame->pts = i;
+        frame->pict_type = i == 0 ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+
+        err = avcodec_send_frame(encoderCtx, frame);
+        if (err < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "avcodec_send_frame() failed: %d",
+                         err);
+            goto Exit;
+        }
+
+        if (!receivePackets(encoderCtx, pkt)) {
+            goto Exit;
+        }
+    }
+
+    // Drain any frames still held by the encoder
+    err = avcodec_send_frame(encoderCtx, nullptr);
+    if (err < 0) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "avcodec_send_frame() failed: %d",
+                     err);
+        goto Exit;
+    }
+
+    ret = receivePackets(encoderCtx, pkt);
+
+Exit:
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    return ret;
+}
+
+bool SyntheticVideoStream::receivePackets(AVCodecContext* encoderCtx, AVPacket* pkt)
+{
+    for (;;) {
+        int err = avcodec_receive_packet(encoderCtx, pkt);
+        if (err == AVERROR(EAGAIN) || err == AVERROR_EOF) {
+            return true;
+        }
+        else if (err < 0) {
+            SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                         "avcodec_receive_packet() failed: %d",
+                         err);
+            return false;
+        }
+
+        EncodedFrame frame;
+        frame.data = QByteArray((const char*)pkt->data, pkt->size);
+        frame.frameType = (pkt->flags & AV_PKT_FLAG_KEY) ? FRAME_TYPE_IDR : FRAME_TYPE_PFRAME;
+        splitFrame(frame);
+        m_Frames.append(frame);
+
+        av_packet_unref(pkt);
+    }
+}
+
+void SyntheticVideoStream::splitFrame(EncodedFrame& frame)
+{
+    const char* data = frame.data.constData();
+    int length = frame.data.size();
+
+    // AV1 frames are passed as a single buffer of OBUs
+    if (m_VideoFormat & VIDEO_FORMAT_MASK_AV1) {
+        frame.nals.append({ 0, length, BUFFER_TYPE_PICDATA });
+        return;
+    }
+
+    // Locate each Annex B start code. Like moonlight-common-c, each
+    // buffer begins with the start code of the NAL unit it contains.
+    QVector<int> nalStarts;
+    for (int i = 0; i + 3 <= length; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            nalStarts.append(i > 0 && data[i - 1] == 0 ? i - 1 : i);
+            i += 2;
+        }
+    }
+
+    if (nalStarts.isEmpty() || nalStarts.first() != 0) {
+        nalStarts.prepend(0);
+    }
+
+    for (int i = 0; i < nalStarts.size(); i++) {
+        int offset = nalStarts[i];
+        int end = i + 1 < nalStarts.size() ? nalStarts[i + 1] : length;
+        int headerOffset = offset + (data[offset + 2] == 1 ? 3 : 4);
+        int bufferType = BUFFER_TYPE_PICDATA;
+
+        if (headerOffset < end) {
+            if (m_VideoFormat & VIDEO_FORMAT_MASK_H264) {
+                switch (data[headerOffset] & 0x1F) {
+                case 7:
+                    bufferType = BUFFER_TYPE_SPS;
+                    break;
+                case 8:
+                    bufferType = BUFFER_TYPE_PPS;
+                    break;
+                }
+            }
+            else {
+                switch ((data[headerOffset] >> 1) & 0x3F) {
+                case 32:
+                    bufferType = BUFFER_TYPE_VPS;
+                    break;
+                case 33:
+                    bufferType = BUFFER_TYPE_SPS;
+                    break;
+                case 34:
+                    bufferType = BUFFER_TYPE_PPS;
+                    break;
+                }
+            }
+        }
+
+        // Coalesce adjacent picture data NALs into a single buffer
+        if (bufferType == BUFFER_TYPE_PICDATA &&
+                !frame.nals.isEmpty() &&
+                frame.nals.last().bufferType == BUFFER_TYPE_PICDATA) {
+            frame.nals.last().length += end - offset;
+        }
+        else {
+            frame.nals.append({ offset, end - offset, bufferType });
+        }
+    }
+}
+
+void SyntheticVideoStream::drawTestPattern(AVFrame* frame, int frameIndex)
+{
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+    int depthShift = desc->comp[0].depth - 8;
+
+    for (int plane = 0; plane < 3; plane++) {
+        int shiftW = plane != 0 ? desc->log2_chroma_w : 0;
+        int shiftH = plane != 0 ? desc->log2_chroma_h : 0;
+        int planeWidth = AV_CEIL_RSHIFT(frame->width, shiftW);
+        int planeHeight = AV_CEIL_RSHIFT(frame->height, shiftH);
+
+        // Scroll the pattern diagonally so every block changes each frame
+        int xOffset = (frameIndex * 256 / PATTERN_CYCLE_FRAMES) >> shiftW;
+        int yOffset = (frameIndex * 128 / PATTERN_CYCLE_FRAMES) >> shiftH;
+
+        for (int y = 0; y < planeHeight; y++) {
+            uint8_t* row = frame->data[plane] + (ptrdiff_t)y * frame->linesize[plane];
+
+            for (int x = 0; x < planeWidth; x++) {
+                int value;
+
+                if (plane == 0) {
+                    // Moving stripes over a fine gradient
+                    int stripe = (((x + xOffset) >> 5) & 1) ? 176 : 64;
+                    value = stripe + ((y + yOffset) & 63);
+                }
+                else {
+                    // Slowly varying chroma bars
+                    value = 64 + (((plane == 1 ? x + xOffset : y + yOffset) * 128) / (plane == 1 ? planeWidth : planeHeight)) % 128;
+                }
+
+                if (depthShift > 0) {
+                    ((uint16_t*)row)[x] = (uint16_t)(value << depthShift);
+                }
+                else {
+                    row[x] = (uint8_t)value;
+                }
+            }
+        }
+    }
+}
+
+bool SyntheticVideoStream::start()
+{
+    SDL_assert(m_GeneratorThread == nullptr);
+    SDL_assert(!m_Frames.isEmpty());
+
+    SDL_AtomicSet(&m_Stopping, 0);
+    m_GeneratorThread = SDL_CreateThread(SyntheticVideoStream::generatorThreadProcThunk,
+                                         "SyntheticVideo", (void*)this);
+    if (m_GeneratorThread == nullptr) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION,
+                     "Unable to create synthetic video thread: %s",
+                     SDL_GetError());
+        return false;
+    }
+
+    return true;
+}
+
+void SyntheticVideoStream::stop()
+{
+    if (m_GeneratorThread != nullptr) {
+        SDL_AtomicSet(&m_Stopping, 1);
+        SDL_WaitThread(m_GeneratorThread, nullptr);
+        m_GeneratorThread = nullptr;
+
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION,
+                    "Synthetic video stream: %d frames generated, %d frames dropped, %d IDR frames",
+                    m_GeneratedFrames,
+                    m_DroppedFrames,
+                    m_IdrFrames);
+    }
+
+    m_FrameQueueLock.lock();
+    while (!m_FrameQueue.isEmpty()) {
+        delete m_FrameQueue.dequeue();
+    }
+    m_FrameQueueLock.unlock();
+}
+
+SyntheticVideoStream::QueuedFrame* SyntheticVideoStream::createQueuedFrame(const EncodedFrame& frame)
+{
+    QueuedFrame* queuedFrame = new QueuedFrame();
+
+    // Entries point directly into the cached frame data, which lives
+    // until this object is destroyed.
+    queuedFrame->entries.resize(frame.nals.size());
+    for (int i = 0; i < frame.nals.size(); i++) {
+        LENTRY& entry = queuedFrame->entries[i];
+
+        entry.next = i + 1 < frame.nals.size() ? &queuedFrame->entries[i + 1] : nullptr;
+        entry.data = const_cast<char*>(frame.data.constData()) + frame.nals[i].offset;
+        entry.length = frame.nals[i].length;
+        entry.bufferType = frame.nals[i].bufferType;
+    }
+
+    DECODE_UNIT& du = queuedFrame->du;
+    SDL_zero(du);
+    du.frameNumber = ++m_NextFrameNumber;
+    du.frameType = frame.frameType;
+    du.receiveTimeMs = du.enqueueTimeMs = LiGetMillis();
+    du.presentationTimeMs = (unsigned int)du.receiveTimeMs;
+    du.fullLength = frame.data.size();
+    du.bufferList = queuedFrame->entries.data();
+
+    return queuedFrame;
+}
+
+int SyntheticVideoStream::generatorThreadProcThunk(void* context)
+{
+    ((SyntheticVideoStream*)context)->generatorThreadProc();
+    return 0;
+}
+
+void SyntheticVideoStream::generatorThreadProc()
+{
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH);
+
+    Uint64 perfFreq = SDL_GetPerformanceFrequency();
+    Uint64 startTime = SDL_GetPerformanceCounter();
+    Uint64 frameIndex = 0;
+    int cycleIndex = 0;
+
+    while (!SDL_AtomicGet(&m_Stopping)) {
+        Uint64 now = SDL_GetPerformanceCounter();
+        Uint64 nextFrameTime = startTime + (frameIndex * perfFreq) / m_FrameRate;
+
+        if (now < nextFrameTime) {
+            Uint32 waitMs = (Uint32)(((nextFrameTime - now) * 1000) / perfFreq);
+            SDL_Delay(waitMs);
+            continue;
+        }
+        else if (now - nextFrameTime > perfFreq) {
+            // If we've fallen more than a second behind (system suspend,
+            // debugger, etc.), restart pacing rather than bursting frames.
+            startTime = now;
+            frameIndex = 0;
+        }
+
+        frameIndex++;
+
+        if (SDL_AtomicSet(&m_IdrRequested, 0)) {
+            cycleIndex = 0;
+        }
+
+        m_FrameQueueLock.lock();
+
+        if (m_FrameQueue.size() >= MAX_QUEUED_FRAMES) {
+            // The decoder can't keep up. Like moonlight-common-c, drop
+            // the whole backlog and resume the stream with an IDR frame.
+            m_DroppedFrames += m_FrameQueue.size();
+            while (!m_FrameQueue.isEmpty()) {
+                delete m_FrameQueue.dequeue();
+            }
+
+            cycleIndex = 0;
+        }
+
+        const EncodedFrame& frame = m_Frames[cycleIndex];
+        if (frame.frameType == FRAME_TYPE_IDR) {
+            m_IdrFrames++;
+        }
+
+        m_FrameQueue.enqueue(createQueuedFrame(frame));
+        m_GeneratedFrames++;
+
+        m_FrameQueueLock.unlock();
+        m_FrameQueueNotEmpty.wakeOne();
+
+        cycleIndex = (cycleIndex + 1) % (int)m_Frames.size();
+    }
+}
+
+bool SyntheticVideoStream::waitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit)
+{
+    m_FrameQueueLock.lock();
+
+    while (m_FrameQueue.isEmpty() && !m_WakeRequested) {
+        m_FrameQueueNotEmpty.wait(&m_FrameQueueLock);
+    }
+
+    if (m_WakeRequested) {
+        m_WakeRequested = false;
+        m_FrameQueueLock.unlock();
+        return false;
+    }
+
+    QueuedFrame* queuedFrame = m_FrameQueue.dequeue();
+    m_FrameQueueLock.unlock();
+
+    *frameHandle = (VIDEO_FRAME_HANDLE)queuedFrame;
+    *decodeUnit = &queuedFrame->du;
+    return true;
+}
+
+bool SyntheticVideoStream::pollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit)
+{
+    m_FrameQueueLock.lock();
+
+    if (m_FrameQueue.isEmpty()) {
+        m_FrameQueueLock.unlock();
+        return false;
+    }
+
+    QueuedFrame* queuedFrame = m_FrameQueue.dequeue();
+    m_FrameQueueLock.unlock();
+
+    *frameHandle = (VIDEO_FRAME_HANDLE)queuedFrame;
+    *decodeUnit = &queuedFrame->du;
+    return true;
+}
+
+void SyntheticVideoStream::completeVideoFrame(VIDEO_FRAME_HANDLE frameHandle, int drStatus)
+{
+    if (drStatus == DR_NEED_IDR) {
+        requestIdrFrame();
+    }
+
+    delete (QueuedFrame*)frameHandle;
+}
+
+void SyntheticVideoStream::wakeWaitForVideoFrame()
+{
+    m_FrameQueueLock.lock();
+    m_WakeRequested = true;
+    m_FrameQueueLock.unlock();
+    m_FrameQueueNotEmpty.wakeAll();
+}
+
+void SyntheticVideoStream::requestIdrFrame()
+{
+    SDL_AtomicSet(&m_IdrRequested, 1);
+}
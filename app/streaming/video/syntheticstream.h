@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QQueue>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "decoder.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+// Produces a video stream from a looping moving test pattern encoded with
+// libavcodec. Encoded frames are split into DECODE_UNITs in the same form
+// that moonlight-common-c hands them to us, so the decoder and renderer can
+// be driven at arbitrary resolutions and frame rates without a host.
+class SyntheticVideoStream
+{
+public:
+    SyntheticVideoStream(int videoFormat, int width, int height,
+                         int frameRate, int bitrateKbps, int slicesPerFrame);
+    ~SyntheticVideoStream();
+
+    bool initialize();
+
+    bool start();
+
+    void stop();
+
+    // These behave like their moonlight-common-c counterparts
+    bool waitForNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
+    bool pollNextVideoFrame(VIDEO_FRAME_HANDLE* frameHandle, PDECODE_UNIT* decodeUnit);
+    void completeVideoFrame(VIDEO_FRAME_HANDLE frameHandle, int drStatus);
+    void wakeWaitForVideoFrame();
+    void requestIdrFrame();
+
+private:
+    struct EncodedNal {
+        int offset;
+        int length;
+        int bufferType;
+    };
+
+    struct EncodedFrame {
+        QByteArray data;
+        QVector<EncodedNal> nals;
+        int frameType;
+    };
+
+    struct QueuedFrame {
+        DECODE_UNIT du;
+        QVector<LENTRY> entries;
+    };
+
+    bool encodePatternCycle(AVCodecContext* encoderCtx);
+
+    bool receivePackets(AVCodecContext* encoderCtx, AVPacket* pkt);
+
+    void splitFrame(EncodedFrame& frame);
+
+    void drawTestPattern(AVFrame* frame, int frameIndex);
+
+    QueuedFrame* createQueuedFrame(const EncodedFrame& frame);
+
+    void generatorThreadProc();
+
+    static int generatorThreadProcThunk(void* context);
+
+    int m_VideoFormat;
+    int m_Width;
+    int m_Height;
+    int m_FrameRate;
+    int m_BitrateKbps;
+    int m_SlicesPerFrame;
+
+    QVector<EncodedFrame> m_Frames;
+
+    SDL_Thread* m_GeneratorThread;
+    SDL_atomic_t m_Stopping;
+    SDL_atomic_t m_IdrRequested;
+
+    QQueue<QueuedFrame*> m_FrameQueue;
+    QMutex m_FrameQueueLock;
+    QWaitCondition m_FrameQueueNotEmpty;
+    bool m_WakeRequested;
+
+    int m_NextFrameNumber;
+    int m_GeneratedFrames;
+    int m_DroppedFrames;
+    int m_IdrFrames;
+};
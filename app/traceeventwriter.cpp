@@ -0,0 +1,79 @@
+#include "traceeventwriter.h"
+
+// Flush the JSON output to disk in chunks of this size
+#define WRITE_CHUNK_SIZE (1024 * 1024)
+
+TraceEventWriter::TraceEventWriter(const QString& fileName)
+    : m_File(fileName)
+{
+}
+
+bool TraceEventWriter::open()
+{
+    if (!m_File.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION,
+                    "Unable to open trace file: %s",
+                    qPrintable(m_File.errorString()));
+        return false;
+    }
+
+    m_Output.reserve(WRITE_CHUNK_SIZE + 512);
+    m_Output.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    m_Output.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Moonlight\"}}");
+    return true;
+}
+
+void TraceEventWriter::writeThreadName(SDL_threadID threadId, const char* name)
+{
+    char entry[512];
+    int length = SDL_snprintf(entry, sizeof(entry),
+                              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%lu,\"args\":{\"name\":\"%s\"}}",
+                              (unsigned long)threadId, name);
+    m_Output.append(entry, length);
+    flushIfNeeded();
+}
+
+void TraceEventWriter::writeEvent(const char* name, char phase, double timestampUs, SDL_threadID threadId,
+                                  double durationUs, char scope, int arg)
+{
+    char entry[512];
+    int length = SDL_snprintf(entry, sizeof(entry),
+                              ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%lu",
+                              name, phase, timestampUs, (unsigned long)threadId);
+
+    if (phase == 'X') {
+        length += SDL_snprintf(entry + length, sizeof(entry) - length,
+                               ",\"dur\":%.3f", durationUs);
+    }
+    else if (phase == 'i') {
+        length += SDL_snprintf(entry + length, sizeof(entry) - length,
+                               ",\"s\":\"%c\"", scope);
+    }
+
+    if (arg >= 0) {
+        length += SDL_snprintf(entry + length, sizeof(entry) - length,
+                               ",\"args\":{\"value\":%d}", arg);
+    }
+
+    m_Output.append(entry, length);
+    m_Output.append('}');
+    flushIfNeeded();
+}
+
+bool TraceEventWriter::close()
+{
+    m_Output.append("\n]}\n");
+    m_File.write(m_Output);
+    m_Output.clear();
+    m_File.close();
+
+    return m_File.error() == QFileDevice::NoError;
+}
+
+void TraceEventWriter::flushIfNeeded()
+{
+    if (m_Output.size() >= WRITE_CHUNK_SIZE) {
+        m_File.write(m_Output);
+        m_Output.clear();
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+
+#include "SDL_compat.h"
+
+// Writes events in the Chrome trace event JSON format shared by
+// StartupTracer and FrameTracer. Output is buffered and flushed to the
+// file in chunks, so large traces don't need to be held in memory.
+class TraceEventWriter
+{
+public:
+    explicit TraceEventWriter(const QString& fileName);
+
+    // Logs a warning and returns false if the file can't be created
+    bool open();
+
+    void writeThreadName(SDL_threadID threadId, const char* name);
+
+    // Timestamps and durations are in microseconds. The duration is only
+    // written for complete ('X') events and the scope only for instant
+    // ('i') events. A negative arg is omitted.
+    void writeEvent(const char* name, char phase, double timestampUs, SDL_threadID threadId,
+                    double durationUs = 0, char scope = 't', int arg = -1);
+
+    // Returns false if any of the output failed to reach the file
+    bool close();
+
+private:
+    void flushIfNeeded();
+
+    QFile m_File;
+    QByteArray m_Output;
+};